@@ -1,12 +1,15 @@
 #version 330 core
 
 layout(location = 0) in vec3 aPos;
-layout(location = 1) in vec3 vertexColor;
+
+// x, y of the cell and 1 if alive, one per instance
+layout(location = 1) in vec3 cell;
 
 uniform mat4 m, v, p;
+uniform vec3 alive_color, dead_color;
 out vec3 fragmentColor;
 
 void main() {
-    gl_Position = p * v * m * vec4(aPos, 1.0);
-    fragmentColor = vertexColor;
+    gl_Position = p * v * m * vec4(aPos + vec3(cell.xy, 0.0), 1.0);
+    fragmentColor = mix(dead_color, alive_color, cell.z);
 }
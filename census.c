@@ -0,0 +1,632 @@
+#include "census.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Slots of a new tally and of the known objects table, powers of two. The
+// tally doubles past three quarters full, the known table is fixed.
+#define CENSUS_INITIAL_OBJECTS 1024
+#define CENSUS_KNOWN_OBJECTS 256
+
+// Known objects are stepped through their phases in a bounded world of
+// this size, with their first phase at (KNOWN_OFFSET, KNOWN_OFFSET).
+#define KNOWN_WORLD_SIZE 40
+#define KNOWN_OFFSET 12
+
+/// An object of B3/S23 in one phase, rows split by '/' with '1' for live
+/// cells, and the generations after which the phase comes back. Every
+/// phase must be one object at CENSUS_OBJECT_RADIUS, which leaves out the
+/// pentadecathlon since some of its phases are in two pieces.
+struct KnownObject {
+    const char *name;
+    const char *cells;
+    unsigned int period;
+};
+
+static const struct KnownObject known_objects[] = {
+    {"block", "11/11", 1},
+    {"beehive", ".11./1..1/.11.", 1},
+    {"loaf", ".11./1..1/.1.1/..1.", 1},
+    {"boat", "11./1.1/.1.", 1},
+    {"ship", "11./1.1/.11", 1},
+    {"tub", ".1./1.1/.1.", 1},
+    {"pond", ".11./1..1/1..1/.11.", 1},
+    {"long boat", "11../1.1./.1.1/..1.", 1},
+    {"barge", ".1../1.1./.1.1/..1.", 1},
+    {"mango", ".11../1..1./.1..1/..11.", 1},
+    {"eater 1", "11../1.1./..1./..11", 1},
+    {"aircraft carrier", "11../1..1/..11", 1},
+    {"snake", "11.1/1.11", 1},
+    {"blinker", "111", 2},
+    {"toad", ".111/111.", 2},
+    {"beacon", "11../11../..11/..11", 2},
+    {"pulsar", "..111...111../............./1....1.1....1/1....1.1....1/1....1.1....1/..111...111../"
+               "............./..111...111../1....1.1....1/1....1.1....1/1....1.1....1/"
+               "............./..111...111..", 3},
+    {"glider", ".1./..1/111", 4},
+    {"lightweight spaceship", ".1..1/1..../1...1/1111.", 4},
+    {"middleweight spaceship", "...1../.1...1/1...../1....1/11111.", 4},
+    {"heavyweight spaceship", "...11../.1....1/1....../1.....1/111111.", 4},
+};
+
+#define NUM_KNOWN_OBJECTS (sizeof(known_objects) / sizeof(known_objects[0]))
+
+/// Finaliser of splitmix64, spreads the bits of a cell position.
+static uint64_t mixPosition(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/// Key of the num_cells cells in the stack, the same for the shape in any
+/// position and under any of the 8 rotations and reflections of the
+/// square. The cells are hashed relative to their bounding box in each of
+/// the 8 orientations by an order independent sum, and the least of the 8
+/// sums is the key.
+static uint64_t shapeKey(const int *cells, size_t num_cells) {
+    int min_c = cells[0];
+    int min_r = cells[1];
+    int max_c = cells[0];
+    int max_r = cells[1];
+    for (size_t i = 1; i < num_cells; ++i) {
+        int c = cells[2 * i];
+        int r = cells[2 * i + 1];
+        min_c = c < min_c ? c : min_c;
+        max_c = c > max_c ? c : max_c;
+        min_r = r < min_r ? r : min_r;
+        max_r = r > max_r ? r : max_r;
+    }
+
+    uint64_t w = (uint64_t) (max_c - min_c);
+    uint64_t h = (uint64_t) (max_r - min_r);
+    uint64_t sums[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    for (size_t i = 0; i < num_cells; ++i) {
+        uint64_t x = (uint64_t) (cells[2 * i] - min_c);
+        uint64_t y = (uint64_t) (cells[2 * i + 1] - min_r);
+        sums[0] += mixPosition(x << 32 | y);
+        sums[1] += mixPosition((w - x) << 32 | y);
+        sums[2] += mixPosition(x << 32 | (h - y));
+        sums[3] += mixPosition((w - x) << 32 | (h - y));
+        sums[4] += mixPosition(y << 32 | x);
+        sums[5] += mixPosition((h - y) << 32 | x);
+        sums[6] += mixPosition(y << 32 | (w - x));
+        sums[7] += mixPosition((h - y) << 32 | (w - x));
+    }
+
+    uint64_t key = sums[0];
+    for (int i = 1; i < 8; ++i)
+        key = sums[i] < key ? sums[i] : key;
+    return key;
+}
+
+/// Makes room for num_cells cells in the stack.
+static int reserveStack(struct Census *self, size_t num_cells) {
+    if (num_cells <= self->stack_capacity)
+        return 1;
+
+    size_t capacity = self->stack_capacity ? self->stack_capacity : 256;
+    while (capacity < num_cells)
+        capacity *= 2;
+    int *stack = realloc(self->stack, sizeof(int) * 2 * capacity);
+    if (!stack) {
+        fprintf(stderr, "census::reserveStack: Error! Failed to allocate %lu cells.\n", (unsigned long) capacity);
+        return 0;
+    }
+    self->stack = stack;
+    self->stack_capacity = capacity;
+    return 1;
+}
+
+/// Slot of the object with this key and population in a table of capacity
+/// slots, or of the empty slot it would take.
+static struct CensusObject *findObject(struct CensusObject *objects, unsigned int capacity,
+                                       uint64_t key, unsigned int population) {
+    unsigned int i = (unsigned int) (key >> 32) & (capacity - 1);
+    while (objects[i].population && (objects[i].key != key || objects[i].population != population))
+        i = (i + 1) & (capacity - 1);
+    return &objects[i];
+}
+
+static int growObjects(struct Census *self) {
+    unsigned int capacity = self->objects_capacity * 2;
+    struct CensusObject *objects = calloc(capacity, sizeof(struct CensusObject));
+    if (!objects) {
+        fprintf(stderr, "census::growObjects: Error! Failed to allocate %u objects.\n", capacity);
+        return 0;
+    }
+
+    for (unsigned int i = 0; i < self->objects_capacity; ++i) {
+        if (self->objects[i].population)
+            *findObject(objects, capacity, self->objects[i].key, self->objects[i].population) = self->objects[i];
+    }
+    free(self->objects);
+    self->objects = objects;
+    self->objects_capacity = capacity;
+    return 1;
+}
+
+/// Adds count of an object to the tally.
+static int tallyObject(struct Census *self, uint64_t key, unsigned int population, const char *name, uint64_t count) {
+    struct CensusObject *object = findObject(self->objects, self->objects_capacity, key, population);
+    if (!object->population) {
+        if (self->num_objects + 1 > self->objects_capacity / 4 * 3) {
+            if (!growObjects(self))
+                return 0;
+            object = findObject(self->objects, self->objects_capacity, key, population);
+        }
+        object->key = key;
+        object->population = population;
+        object->name = name;
+        ++self->num_objects;
+    }
+    object->count += count;
+    return 1;
+}
+
+/// Slot of the phase with this key and population in the known table,
+/// or of the empty slot it would take.
+static struct CensusKnown *findKnown(const struct Census *self, uint64_t key, unsigned int population) {
+    unsigned int i = (unsigned int) (key >> 32) & (self->known_capacity - 1);
+    while (self->known[i].population && (self->known[i].key != key || self->known[i].population != population))
+        i = (i + 1) & (self->known_capacity - 1);
+    return &self->known[i];
+}
+
+/// Puts the live cells of a world with one object in the stack. The dense
+/// cells must be current, as they are after censusTake.
+static size_t stackWorldCells(struct Census *self, struct World *world) {
+    size_t num_cells = 0;
+    for (unsigned int r = 0; r < world->rows; ++r) {
+        for (unsigned int c = 0; c < world->cols; ++c) {
+            if (!world->cells[(size_t) r * world->stride + c])
+                continue;
+            if (!reserveStack(self, num_cells + 1))
+                return 0;
+            self->stack[2 * num_cells] = (int) c;
+            self->stack[2 * num_cells + 1] = (int) r;
+            ++num_cells;
+        }
+    }
+    return num_cells;
+}
+
+/// Steps each known object through its phases and stores the key of every
+/// phase. An object in several pieces or whose first phase does not come
+/// back after its period is a mistake in known_objects and fails the census.
+/// An object whose first phase comes back moved is a spaceship.
+static int buildKnownObjects(struct Census *self) {
+    struct World *world = self->known_world;
+    int built = 1;
+    for (size_t i = 0; built && i < NUM_KNOWN_OBJECTS; ++i) {
+        const struct KnownObject *object = &known_objects[i];
+        worldClear(world);
+        int c = 0;
+        int r = 0;
+        for (const char *ch = object->cells; *ch; ++ch) {
+            if (*ch == '/') {
+                c = 0;
+                ++r;
+                continue;
+            }
+            if (*ch == '1')
+                worldToggleCell(world, KNOWN_OFFSET + c, KNOWN_OFFSET + r);
+            ++c;
+        }
+
+        uint64_t first_key = 0;
+        unsigned int first_population = 0;
+        int first_x = 0, first_y = 0, min_x, min_y, max_x, max_y;
+        for (unsigned int phase = 0; phase <= object->period; ++phase) {
+            censusReset(self);
+            if (!censusTake(self, world) || self->num_objects != 1) {
+                fprintf(stderr, "census::buildKnownObjects: Error! The %s is not one object in phase %u.\n",
+                        object->name, phase);
+                built = 0;
+                break;
+            }
+
+            size_t num_cells = stackWorldCells(self, world);
+            if (!num_cells) {
+                built = 0;
+                break;
+            }
+
+            uint64_t key = shapeKey(self->stack, num_cells);
+            worldLiveBounds(world, &min_x, &min_y, &max_x, &max_y);
+            if (phase == 0) {
+                first_key = key;
+                first_population = (unsigned int) num_cells;
+                first_x = min_x;
+                first_y = min_y;
+            } else if (phase == object->period) {
+                if (key != first_key || num_cells != first_population) {
+                    fprintf(stderr, "census::buildKnownObjects: Error! The %s does not repeat after %u generations.\n",
+                            object->name, object->period);
+                    built = 0;
+                }
+                for (unsigned int k = 0; built && k < self->known_capacity; ++k) {
+                    if (self->known[k].name == object->name)
+                        self->known[k].spaceship = min_x != first_x || min_y != first_y;
+                }
+                break;
+            }
+
+            struct CensusKnown *known = findKnown(self, key, (unsigned int) num_cells);
+            if (!known->population) {
+                known->key = key;
+                known->population = (unsigned int) num_cells;
+                known->object_key = first_key;
+                known->object_population = first_population;
+                known->name = object->name;
+                known->period = object->period;
+            }
+            if (!worldStep(world, 1)) {
+                built = 0;
+                break;
+            }
+        }
+    }
+
+    censusReset(self);
+    return built;
+}
+
+struct Census *censusCreate() {
+
+    struct Census *self = calloc(1, sizeof(struct Census));
+    if (!self) {
+        fprintf(stderr, "Failed to allocate memory for the census.\n");
+        return NULL;
+    }
+
+    self->objects_capacity = CENSUS_INITIAL_OBJECTS;
+    self->objects = calloc(self->objects_capacity, sizeof(struct CensusObject));
+    self->known_capacity = CENSUS_KNOWN_OBJECTS;
+    self->known = calloc(self->known_capacity, sizeof(struct CensusKnown));
+    self->known_world = worldCreate();
+    if (!self->objects || !self->known || !self->known_world) {
+        fprintf(stderr, "Failed to allocate memory for the census.\n");
+        censusDestroy(self);
+        return NULL;
+    }
+    if (!worldSetTopology(self->known_world, TopologyBounded, KNOWN_WORLD_SIZE, KNOWN_WORLD_SIZE)) {
+        censusDestroy(self);
+        return NULL;
+    }
+
+    if (!buildKnownObjects(self)) {
+        censusDestroy(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+void censusDestroy(struct Census *self) {
+    if (!self)
+        return;
+
+    free(self->objects);
+    free(self->known);
+    free(self->visited);
+    free(self->stack);
+    free(self->bounds);
+    worldDestroy(self->known_world);
+    free(self);
+}
+
+/// Clears the tally, the known objects are kept.
+void censusReset(struct Census *self) {
+    memset(self->objects, 0, sizeof(struct CensusObject) * self->objects_capacity);
+    self->num_objects = 0;
+}
+
+/// Fills the object holding the live cell (c, r) into the stack, marking
+/// its cells visited. Returns the number of cells, 0 on failure.
+static size_t fillObject(struct Census *self, struct World *world, int c, int r) {
+    const size_t stride = world->stride;
+    size_t num_cells = 1;
+    self->stack[0] = c;
+    self->stack[1] = r;
+    self->visited[(size_t) r * stride + c] = 1;
+
+    // The stack doubles as the queue of cells whose neighbours are next
+    for (size_t i = 0; i < num_cells; ++i) {
+        int cell_c = self->stack[2 * i];
+        int cell_r = self->stack[2 * i + 1];
+        int r0 = cell_r > CENSUS_OBJECT_RADIUS ? cell_r - CENSUS_OBJECT_RADIUS : 0;
+        int r1 = cell_r + CENSUS_OBJECT_RADIUS < (int) world->rows - 1 ? cell_r + CENSUS_OBJECT_RADIUS : (int) world->rows - 1;
+        int c0 = cell_c > CENSUS_OBJECT_RADIUS ? cell_c - CENSUS_OBJECT_RADIUS : 0;
+        int c1 = cell_c + CENSUS_OBJECT_RADIUS < (int) world->cols - 1 ? cell_c + CENSUS_OBJECT_RADIUS : (int) world->cols - 1;
+        for (int nr = r0; nr <= r1; ++nr) {
+            for (int nc = c0; nc <= c1; ++nc) {
+                size_t j = (size_t) nr * stride + nc;
+                if (!world->cells[j] || self->visited[j])
+                    continue;
+                if (!reserveStack(self, num_cells + 1))
+                    return 0;
+                self->visited[j] = 1;
+                self->stack[2 * num_cells] = nc;
+                self->stack[2 * num_cells + 1] = nr;
+                ++num_cells;
+            }
+        }
+    }
+    return num_cells;
+}
+
+/// Calls visit with the cells of each object of the world in the stack.
+/// Live cells within CENSUS_OBJECT_RADIUS of each other are one object,
+/// found by a flood fill from each live cell not yet in an object, and only
+/// blocks with live cells are scanned, so this takes time linear in the
+/// live cells and blocks. Objects are not followed across the edges of a
+/// torus. The cells are read a byte per cell, see worldSyncCells.
+static int forEachObject(struct Census *self, struct World *world,
+                         int (*visit)(struct Census *self, struct World *world, size_t num_cells)) {
+    if (!worldSyncCells(world))
+        return 0;
+
+    size_t visited_size = (size_t) world->rows * world->stride;
+    if (visited_size > self->visited_size) {
+        free(self->visited);
+        self->visited = calloc(visited_size, 1);
+        if (!self->visited) {
+            fprintf(stderr, "census::forEachObject: Error! Failed to allocate memory for %lu cells.\n",
+                    (unsigned long) visited_size);
+            self->visited_size = 0;
+            return 0;
+        }
+        self->visited_size = visited_size;
+    }
+    if (!reserveStack(self, 1))
+        return 0;
+
+    const size_t stride = world->stride;
+    int taken = 1;
+    for (unsigned int br = 0; taken && br < world->block_grid_rows; ++br) {
+        for (unsigned int bc = 0; taken && bc < world->block_grid_cols; ++bc) {
+            if (!world->block_population[br * world->block_grid_cols + bc])
+                continue;
+
+            unsigned int r1 = (br + 1) * world->block_rows < world->rows ? (br + 1) * world->block_rows : world->rows;
+            unsigned int c1 = (bc + 1) * world->block_cols < world->cols ? (bc + 1) * world->block_cols : world->cols;
+            for (unsigned int r = br * world->block_rows; taken && r < r1; ++r) {
+                for (unsigned int c = bc * world->block_cols; c < c1; ++c) {
+                    size_t i = (size_t) r * stride + c;
+                    if (!world->cells[i] || self->visited[i])
+                        continue;
+
+                    size_t num_cells = fillObject(self, world, (int) c, (int) r);
+                    if (!num_cells || !visit(self, world, num_cells)) {
+                        taken = 0;
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    // Clear the marks of every object by scanning the blocks again
+    for (unsigned int br = 0; br < world->block_grid_rows; ++br) {
+        for (unsigned int bc = 0; bc < world->block_grid_cols; ++bc) {
+            if (!world->block_population[br * world->block_grid_cols + bc])
+                continue;
+            unsigned int r1 = (br + 1) * world->block_rows < world->rows ? (br + 1) * world->block_rows : world->rows;
+            unsigned int c0 = bc * world->block_cols;
+            unsigned int c1 = (bc + 1) * world->block_cols < world->cols ? (bc + 1) * world->block_cols : world->cols;
+            for (unsigned int r = br * world->block_rows; r < r1; ++r)
+                memset(&self->visited[(size_t) r * stride + c0], 0, c1 - c0);
+        }
+    }
+
+    return taken;
+}
+
+/// Known phase with this key and population, NULL if there is none or the
+/// world does not follow B3/S23.
+static const struct CensusKnown *knownObject(struct Census *self, struct World *world, uint64_t key,
+                                             size_t num_cells) {
+    if (!world->rule.is_conway)
+        return NULL;
+    const struct CensusKnown *known = findKnown(self, key, (unsigned int) num_cells);
+    return known->population ? known : NULL;
+}
+
+/// Tallies the object in the stack, under the first phase of a known object.
+static int tallyStackObject(struct Census *self, struct World *world, size_t num_cells) {
+    uint64_t key = shapeKey(self->stack, num_cells);
+    const struct CensusKnown *known = knownObject(self, world, key, num_cells);
+    if (known)
+        return tallyObject(self, known->object_key, known->object_population, known->name, 1);
+    return tallyObject(self, key, (unsigned int) num_cells, NULL, 1);
+}
+
+/// Adds the objects of the world to the tally, see forEachObject. Objects
+/// whose shape matches a phase of a known object are named and tallied
+/// under its first phase when the world follows B3/S23.
+int censusTake(struct Census *self, struct World *world) {
+    return forEachObject(self, world, tallyStackObject);
+}
+
+/// Places the num_cells cells in the stack in the cleared known world, with
+/// the top left of their bounds at (KNOWN_OFFSET, KNOWN_OFFSET).
+static void placeKnownCells(struct Census *self, size_t num_cells) {
+    int min_c = self->stack[0];
+    int min_r = self->stack[1];
+    for (size_t i = 1; i < num_cells; ++i) {
+        min_c = self->stack[2 * i] < min_c ? self->stack[2 * i] : min_c;
+        min_r = self->stack[2 * i + 1] < min_r ? self->stack[2 * i + 1] : min_r;
+    }
+
+    worldClear(self->known_world);
+    for (size_t i = 0; i < num_cells; ++i)
+        worldToggleCellAt(self->known_world, KNOWN_OFFSET + self->stack[2 * i] - min_c,
+                          KNOWN_OFFSET + self->stack[2 * i + 1] - min_r);
+}
+
+/// Keeps the bounds of the object in the stack, and for a known spaceship
+/// how far it flies each period, found by stepping it in the known world.
+static int boundObject(struct Census *self, struct World *world, size_t num_cells) {
+    if (self->num_bounds == self->bounds_capacity) {
+        unsigned int capacity = self->bounds_capacity ? self->bounds_capacity * 2 : 64;
+        struct CensusBounds *bounds = realloc(self->bounds, sizeof(struct CensusBounds) * capacity);
+        if (!bounds) {
+            fprintf(stderr, "census::boundObject: Error! Failed to allocate %u object bounds.\n", capacity);
+            return 0;
+        }
+        self->bounds = bounds;
+        self->bounds_capacity = capacity;
+    }
+
+    struct CensusBounds *bounds = &self->bounds[self->num_bounds++];
+    bounds->min_c = bounds->max_c = self->stack[0];
+    bounds->min_r = bounds->max_r = self->stack[1];
+    for (size_t i = 1; i < num_cells; ++i) {
+        int c = self->stack[2 * i];
+        int r = self->stack[2 * i + 1];
+        bounds->min_c = c < bounds->min_c ? c : bounds->min_c;
+        bounds->max_c = c > bounds->max_c ? c : bounds->max_c;
+        bounds->min_r = r < bounds->min_r ? r : bounds->min_r;
+        bounds->max_r = r > bounds->max_r ? r : bounds->max_r;
+    }
+    bounds->dx = 0;
+    bounds->dy = 0;
+    bounds->escaped = 0;
+
+    const struct CensusKnown *known = knownObject(self, world, shapeKey(self->stack, num_cells), num_cells);
+    bounds->ship = known && known->spaceship ? known : NULL;
+    if (!bounds->ship)
+        return 1;
+
+    int min_x, min_y, max_x, max_y;
+    placeKnownCells(self, num_cells);
+    if (!worldStep(self->known_world, known->period) ||
+        !worldLiveBounds(self->known_world, &min_x, &min_y, &max_x, &max_y))
+        return 0;
+    bounds->dx = min_x - KNOWN_OFFSET;
+    bounds->dy = min_y - KNOWN_OFFSET;
+    return 1;
+}
+
+/// True if the spaceship of bounds is CENSUS_ESCAPE_GAP cells past the
+/// other objects that have not escaped, on a side it flies away from.
+/// Spaceships flying the same way never catch up with it and are left out,
+/// so a stream of gliders escapes one glider at a time.
+static int hasEscaped(struct Census *self, const struct CensusBounds *ship) {
+    int found = 0;
+    int min_c = 0, min_r = 0, max_c = 0, max_r = 0;
+    for (unsigned int i = 0; i < self->num_bounds; ++i) {
+        const struct CensusBounds *other = &self->bounds[i];
+        if (other == ship || other->escaped || (other->ship && other->dx == ship->dx && other->dy == ship->dy))
+            continue;
+        min_c = !found || other->min_c < min_c ? other->min_c : min_c;
+        min_r = !found || other->min_r < min_r ? other->min_r : min_r;
+        max_c = !found || other->max_c > max_c ? other->max_c : max_c;
+        max_r = !found || other->max_r > max_r ? other->max_r : max_r;
+        found = 1;
+    }
+
+    return !found || (ship->dx > 0 && ship->min_c > max_c + CENSUS_ESCAPE_GAP) ||
+           (ship->dx < 0 && ship->max_c < min_c - CENSUS_ESCAPE_GAP) ||
+           (ship->dy > 0 && ship->min_r > max_r + CENSUS_ESCAPE_GAP) ||
+           (ship->dy < 0 && ship->max_r < min_r - CENSUS_ESCAPE_GAP);
+}
+
+/// Removes the known spaceships that have escaped the rest of the world
+/// and adds them to the tally. A spaceship has escaped once it flies away
+/// from the bounds of every other object and is CENSUS_ESCAPE_GAP cells
+/// past them, so it will not meet them again. Spaceships that fly away
+/// from each other escape one by one. Removing them lets a soup that
+/// sends out spaceships settle, and counts them before they fly out of
+/// a bounded world or its hash.
+int censusTakeEscaped(struct Census *self, struct World *world) {
+    self->num_bounds = 0;
+    if (!forEachObject(self, world, boundObject))
+        return 0;
+
+    int escaping = 1;
+    while (escaping) {
+        escaping = 0;
+        for (unsigned int i = 0; i < self->num_bounds; ++i) {
+            struct CensusBounds *ship = &self->bounds[i];
+            if (ship->ship && !ship->escaped && hasEscaped(self, ship)) {
+                ship->escaped = 1;
+                escaping = 1;
+            }
+        }
+    }
+
+    for (unsigned int i = 0; i < self->num_bounds; ++i) {
+        const struct CensusBounds *ship = &self->bounds[i];
+        if (!ship->escaped)
+            continue;
+        if (!tallyObject(self, ship->ship->object_key, ship->ship->object_population, ship->ship->name, 1) ||
+            !worldClearRegion(world, world->tl_cell_pos_x + ship->min_c, world->tl_cell_pos_y + ship->min_r,
+                              (unsigned int) (ship->max_c - ship->min_c + 1),
+                              (unsigned int) (ship->max_r - ship->min_r + 1)))
+            return 0;
+    }
+    return 1;
+}
+
+/// Adds the tally of other to the tally of self.
+int censusMerge(struct Census *self, const struct Census *other) {
+    for (unsigned int i = 0; i < other->objects_capacity; ++i) {
+        const struct CensusObject *object = &other->objects[i];
+        if (object->population && !tallyObject(self, object->key, object->population, object->name, object->count))
+            return 0;
+    }
+    return 1;
+}
+
+/// Number of known objects of this name counted.
+uint64_t censusCount(struct Census *self, const char *name) {
+    uint64_t count = 0;
+    for (unsigned int i = 0; i < self->objects_capacity; ++i) {
+        if (self->objects[i].population && self->objects[i].name && strcmp(self->objects[i].name, name) == 0)
+            count += self->objects[i].count;
+    }
+    return count;
+}
+
+static int compareObjects(const void *a, const void *b) {
+    const struct CensusObject *object_a = a;
+    const struct CensusObject *object_b = b;
+    if (object_a->count != object_b->count)
+        return object_a->count < object_b->count ? 1 : -1;
+    if (object_a->population != object_b->population)
+        return object_a->population < object_b->population ? -1 : 1;
+    return object_a->key < object_b->key ? -1 : object_a->key > object_b->key;
+}
+
+/// Prints the max_objects most common objects, unknown objects by key.
+int censusPrint(struct Census *self, unsigned int max_objects) {
+    struct CensusObject *sorted = malloc(sizeof(struct CensusObject) * (self->num_objects + 1));
+    if (!sorted) {
+        fprintf(stderr, "census::censusPrint: Error! Failed to allocate memory for the objects.\n");
+        return 0;
+    }
+
+    unsigned int n = 0;
+    uint64_t total = 0;
+    for (unsigned int i = 0; i < self->objects_capacity; ++i) {
+        if (self->objects[i].population) {
+            sorted[n++] = self->objects[i];
+            total += self->objects[i].count;
+        }
+    }
+    qsort(sorted, n, sizeof(struct CensusObject), compareObjects);
+
+    fprintf(stdout, "%" PRIu64 " objects of %u kinds\n\n%10s %10s  %s\n", total, n, "count", "population", "object");
+    for (unsigned int i = 0; i < n && i < max_objects; ++i) {
+        if (sorted[i].name)
+            fprintf(stdout, "%10" PRIu64 " %10u  %s\n", sorted[i].count, sorted[i].population, sorted[i].name);
+        else
+            fprintf(stdout, "%10" PRIu64 " %10u  %016" PRIx64 "\n", sorted[i].count, sorted[i].population, sorted[i].key);
+    }
+
+    free(sorted);
+    return 1;
+}
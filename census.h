@@ -0,0 +1,97 @@
+#ifndef __GAME_OF_LIFE_CENSUS_H__
+#define __GAME_OF_LIFE_CENSUS_H__
+
+#include "world.h"
+
+#include <stdint.h>
+
+// Live cells at most this far apart, in either direction, belong to the
+// same object. Two rather than one keeps the phases of oscillators such
+// as the beacon, whose halves only touch in some phases, in one piece.
+#define CENSUS_OBJECT_RADIUS 2
+
+// A spaceship has escaped once it is this many cells past the bounds of
+// every other object on a side it flies away from, see censusTakeEscaped.
+#define CENSUS_ESCAPE_GAP 16
+
+/// Tally of one object, keyed by its shape under the 8 symmetries of the
+/// square. Every phase of a known object has its own key but shares its
+/// name. An empty slot has a population of zero.
+struct CensusObject {
+    uint64_t key;
+    uint64_t count;
+    unsigned int population;
+
+    // Name of a known object, NULL otherwise
+    const char *name;
+};
+
+/// One phase of a known object and the first phase it is tallied under.
+/// An empty slot has a population of zero.
+struct CensusKnown {
+    uint64_t key;
+    unsigned int population;
+    uint64_t object_key;
+    unsigned int object_population;
+    const char *name;
+
+    // Generations after which the phase comes back, moved if it is a
+    // spaceship
+    unsigned int period;
+    int spaceship;
+};
+
+/// Bounds of an object found by censusTakeEscaped, in cells of the world,
+/// and for a spaceship how far it flies each period.
+struct CensusBounds {
+    int min_c;
+    int min_r;
+    int max_c;
+    int max_r;
+    const struct CensusKnown *ship;
+    int dx;
+    int dy;
+    int escaped;
+};
+
+/// Counts the objects left in worlds, such as the ash of settled soups.
+/// Scratch buffers are kept between censuses, so a census of a world of a
+/// size seen before does not allocate.
+struct Census {
+    struct CensusObject *objects;
+    unsigned int objects_capacity;
+    unsigned int num_objects;
+
+    // Every phase of the known objects, see censusCreate
+    struct CensusKnown *known;
+    unsigned int known_capacity;
+
+    // Marks of the cells already put in an object, indexed by the cell
+    // offset in the world, and the cells of the object being filled as
+    // col, row pairs.
+    unsigned char *visited;
+    size_t visited_size;
+    int *stack;
+    size_t stack_capacity;
+
+    // Bounds of the objects of the world being searched for escaped
+    // spaceships
+    struct CensusBounds *bounds;
+    unsigned int bounds_capacity;
+    unsigned int num_bounds;
+
+    // Bounded world the known objects are stepped through their phases
+    // in, and each spaceship is stepped in to find which way it flies
+    struct World *known_world;
+};
+
+struct Census *censusCreate();
+void censusDestroy(struct Census *self);
+void censusReset(struct Census *self);
+int censusTake(struct Census *self, struct World *world);
+int censusTakeEscaped(struct Census *self, struct World *world);
+int censusMerge(struct Census *self, const struct Census *other);
+uint64_t censusCount(struct Census *self, const char *name);
+int censusPrint(struct Census *self, unsigned int max_objects);
+
+#endif // __GAME_OF_LIFE_CENSUS_H__
@@ -0,0 +1,353 @@
+#include "checkpoint.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char checkpoint_magic[8] = {'G', 'O', 'L', 'C', 'K', 'P', 'T', '1'};
+
+static uint32_t crc_table[256];
+static pthread_once_t crc_table_once = PTHREAD_ONCE_INIT;
+
+static void buildCrcTable(void) {
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit)
+            crc = crc & 1 ? (crc >> 1) ^ 0xEDB88320u : crc >> 1;
+        crc_table[i] = crc;
+    }
+}
+
+/// CRC-32 of the bytes, the same as zlib's.
+static uint32_t crcBytes(const unsigned char *bytes, size_t size) {
+    pthread_once(&crc_table_once, buildCrcTable);
+    uint32_t crc = 0xFFFFFFFFu;
+    for (size_t i = 0; i < size; ++i)
+        crc = crc_table[(crc ^ bytes[i]) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+static uint32_t headerCrc(const struct CheckpointHeader *header) {
+    return crcBytes((const unsigned char *) header, offsetof(struct CheckpointHeader, header_crc));
+}
+
+/// Flushes the directory of the file, so a rename in it survives a crash.
+static void syncDirectory(const char *file_name) {
+    char directory[CHECKPOINT_MAX_PATH] = ".";
+    const char *slash = strrchr(file_name, '/');
+    if (slash && slash - file_name < CHECKPOINT_MAX_PATH) {
+        size_t length = slash == file_name ? 1 : (size_t) (slash - file_name);
+        memcpy(directory, file_name, length);
+        directory[length] = '\0';
+    }
+
+    int fd = open(directory, O_RDONLY);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+void checkpointInit(struct Checkpoint *self) {
+    memset(&self->header, 0, sizeof(self->header));
+    self->cells = NULL;
+    self->capacity = 0;
+}
+
+void checkpointFree(struct Checkpoint *self) {
+    free(self->cells);
+    self->cells = NULL;
+    self->capacity = 0;
+}
+
+static int reserveCells(struct Checkpoint *self, size_t size) {
+    if (size <= self->capacity)
+        return 1;
+
+    unsigned char *cells = realloc(self->cells, size);
+    if (!cells) {
+        fprintf(stderr, "checkpoint::reserveCells: Error! Failed to allocate memory for %zu bytes of cells.\n", size);
+        return 0;
+    }
+    self->cells = cells;
+    self->capacity = size;
+    return 1;
+}
+
+/// Copies the state of the world, its live cells packed 8 to a byte. The
+/// CRCs are left to checkpointWrite.
+int checkpointCapture(struct Checkpoint *self, struct World *world) {
+    struct CheckpointHeader *header = &self->header;
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, checkpoint_magic, sizeof(checkpoint_magic));
+    header->topology = (uint32_t) world->topology;
+    header->birth = world->rule.birth;
+    header->survival = world->rule.survival;
+    header->generation = world->generation;
+    header->tl_x = world->tl_cell_pos_x;
+    header->tl_y = world->tl_cell_pos_y;
+    header->cols = world->cols;
+    header->rows = world->rows;
+    header->population = worldPopulation(world);
+
+    int min_x, min_y, max_x, max_y;
+    if (!worldLiveBounds(world, &min_x, &min_y, &max_x, &max_y))
+        return 1;
+
+    unsigned int cols = (unsigned int) (max_x - min_x + 1);
+    unsigned int rows = (unsigned int) (max_y - min_y + 1);
+    size_t row_bytes = (cols + 7) / 8;
+    if (!reserveCells(self, row_bytes * rows))
+        return 0;
+
+    for (unsigned int r = 0; r < rows; ++r) {
+        unsigned char *dst = &self->cells[r * row_bytes];
+        memset(dst, 0, row_bytes);
+        for (unsigned int c = 0; c < cols; ++c)
+            dst[c >> 3] |= (unsigned char) (worldCellAlive(world, min_x + (int) c, min_y + (int) r) << (c & 7));
+    }
+
+    header->min_x = min_x;
+    header->min_y = min_y;
+    header->live_cols = cols;
+    header->live_rows = rows;
+    header->payload_bytes = row_bytes * rows;
+    return 1;
+}
+
+/// Writes the checkpoint to file_name.tmp, flushes it to disk and renames it
+/// over file_name. The file it replaces is renamed to file_name.prev.
+int checkpointWrite(struct Checkpoint *self, const char *file_name) {
+    char temp_name[CHECKPOINT_MAX_PATH + 8];
+    char prev_name[CHECKPOINT_MAX_PATH + 8];
+    snprintf(temp_name, sizeof(temp_name), "%s.tmp", file_name);
+    snprintf(prev_name, sizeof(prev_name), "%s.prev", file_name);
+
+    self->header.payload_crc = crcBytes(self->cells, self->header.payload_bytes);
+    self->header.header_crc = headerCrc(&self->header);
+
+    FILE *file = fopen(temp_name, "wb");
+    if (!file) {
+        fprintf(stderr, "checkpoint::checkpointWrite: Error! Failed to open %s.\n", temp_name);
+        return 0;
+    }
+    int written = fwrite(&self->header, sizeof(self->header), 1, file) == 1 &&
+                  (self->header.payload_bytes == 0 ||
+                   fwrite(self->cells, self->header.payload_bytes, 1, file) == 1) &&
+                  fflush(file) == 0 && fsync(fileno(file)) == 0;
+    written = fclose(file) == 0 && written;
+    if (!written) {
+        fprintf(stderr, "checkpoint::checkpointWrite: Error! Failed to write %s.\n", temp_name);
+        unlink(temp_name);
+        return 0;
+    }
+
+    if ((rename(file_name, prev_name) != 0 && errno != ENOENT) || rename(temp_name, file_name) != 0) {
+        fprintf(stderr, "checkpoint::checkpointWrite: Error! Failed to rename %s to %s.\n", temp_name, file_name);
+        return 0;
+    }
+    syncDirectory(file_name);
+    return 1;
+}
+
+/// Reads a checkpoint file. Returns 0 if it is missing, truncated or its
+/// CRCs do not match, without printing, as a crash may leave such files.
+int checkpointRead(struct Checkpoint *self, const char *file_name) {
+    FILE *file = fopen(file_name, "rb");
+    if (!file)
+        return 0;
+
+    struct CheckpointHeader *header = &self->header;
+    int valid = fread(header, sizeof(*header), 1, file) == 1 &&
+                memcmp(header->magic, checkpoint_magic, sizeof(checkpoint_magic)) == 0 &&
+                header->header_crc == headerCrc(header) && header->topology <= TopologyBounded &&
+                header->payload_bytes == ((uint64_t) header->live_cols + 7) / 8 * header->live_rows &&
+                header->payload_bytes <= SIZE_MAX && reserveCells(self, (size_t) header->payload_bytes) &&
+                (header->payload_bytes == 0 || fread(self->cells, (size_t) header->payload_bytes, 1, file) == 1) &&
+                header->payload_crc == crcBytes(self->cells, (size_t) header->payload_bytes);
+    fclose(file);
+    return valid;
+}
+
+/// Replaces the world with the checkpoint: its cells, where they are,
+/// the topology, rule and generation. The engine and threads are kept.
+int checkpointRestore(const struct Checkpoint *self, struct World *world) {
+    const struct CheckpointHeader *header = &self->header;
+
+    struct LifeRule rule = {0};
+    rule.birth = header->birth;
+    rule.survival = header->survival;
+    char rule_string[LIFE_RULE_MAX_CHARS];
+    lifeRuleToString(&rule, rule_string);
+    if (!worldSetRule(world, rule_string))
+        return 0;
+
+    // The world is cleared first so resizing it copies no cells
+    worldClear(world);
+    world->tl_cell_pos_x = header->tl_x;
+    world->tl_cell_pos_y = header->tl_y;
+    if (!worldSetTopology(world, (enum WorldTopology) header->topology, header->cols, header->rows))
+        return 0;
+
+    size_t row_bytes = (header->live_cols + 7) / 8;
+    unsigned char *cells = malloc((size_t) header->live_cols * header->live_rows);
+    if (header->live_cols && !cells) {
+        fprintf(stderr, "checkpoint::checkpointRestore: Error! Failed to allocate memory for %u x %u cells.\n",
+                header->live_cols, header->live_rows);
+        return 0;
+    }
+    for (unsigned int r = 0; r < header->live_rows; ++r) {
+        for (unsigned int c = 0; c < header->live_cols; ++c)
+            cells[(size_t) r * header->live_cols + c] = (self->cells[r * row_bytes + (c >> 3)] >> (c & 7)) & 1;
+    }
+    int stamped = worldStampAt(world, header->min_x, header->min_y, header->live_cols, header->live_rows, cells);
+    free(cells);
+    if (!stamped)
+        return 0;
+
+    world->generation = header->generation;
+    if (worldPopulation(world) != header->population) {
+        fprintf(stderr, "checkpoint::checkpointRestore: Error! Restored %llu cells, the checkpoint has %llu.\n",
+                (unsigned long long) worldPopulation(world), (unsigned long long) header->population);
+        return 0;
+    }
+    return 1;
+}
+
+/// Restores the world from the newest valid checkpoint of file_name. A
+/// whole file_name.tmp was written after file_name, which was written
+/// after file_name.prev, whatever their generations. Returns 0 if none is
+/// valid.
+int checkpointResume(struct World *world, const char *file_name) {
+    char names[3][CHECKPOINT_MAX_PATH + 8];
+    snprintf(names[0], sizeof(names[0]), "%s.tmp", file_name);
+    snprintf(names[1], sizeof(names[1]), "%s", file_name);
+    snprintf(names[2], sizeof(names[2]), "%s.prev", file_name);
+
+    struct Checkpoint checkpoint;
+    checkpointInit(&checkpoint);
+    int found = 0;
+    while (found < 3 && !checkpointRead(&checkpoint, names[found]))
+        ++found;
+
+    int restored = found < 3 && checkpointRestore(&checkpoint, world);
+    if (restored)
+        fprintf(stderr, "Resumed from %s at generation %llu\n", names[found],
+                (unsigned long long) checkpoint.header.generation);
+    checkpointFree(&checkpoint);
+    return restored;
+}
+
+static void *checkpointerMain(void *arg) {
+    struct Checkpointer *self = arg;
+
+    pthread_mutex_lock(&self->lock);
+    while (1) {
+        while (self->pending < 0 && !self->stop)
+            pthread_cond_wait(&self->wake, &self->lock);
+        if (self->pending < 0)
+            break;
+
+        self->writing = self->pending;
+        self->pending = -1;
+        struct Checkpoint *checkpoint = &self->checkpoints[self->writing];
+        pthread_mutex_unlock(&self->lock);
+
+        int written = checkpointWrite(checkpoint, self->file_name);
+
+        pthread_mutex_lock(&self->lock);
+        if (written) {
+            ++self->written;
+            self->written_generation = checkpoint->header.generation;
+        } else {
+            ++self->failed;
+        }
+        self->writing = -1;
+        pthread_cond_broadcast(&self->wake);
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    return NULL;
+}
+
+struct Checkpointer *checkpointerCreate(const char *file_name) {
+
+    if (strlen(file_name) >= CHECKPOINT_MAX_PATH) {
+        fprintf(stderr, "checkpoint::checkpointerCreate: Error! Checkpoint file name %s is too long.\n", file_name);
+        return NULL;
+    }
+
+    struct Checkpointer *self = malloc(sizeof(struct Checkpointer));
+    if (!self) {
+        fprintf(stderr, "Failed to allocate memory for the checkpointer.\n");
+        return NULL;
+    }
+
+    strcpy(self->file_name, file_name);
+    checkpointInit(&self->checkpoints[0]);
+    checkpointInit(&self->checkpoints[1]);
+    self->writing = -1;
+    self->pending = -1;
+    self->stop = 0;
+    self->written = 0;
+    self->replaced = 0;
+    self->failed = 0;
+    self->written_generation = 0;
+    pthread_mutex_init(&self->lock, NULL);
+    pthread_cond_init(&self->wake, NULL);
+
+    if (pthread_create(&self->thread, NULL, checkpointerMain, self) != 0) {
+        fprintf(stderr, "checkpoint::checkpointerCreate: Error! Failed to create the checkpoint thread.\n");
+        pthread_cond_destroy(&self->wake);
+        pthread_mutex_destroy(&self->lock);
+        free(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+/// Writes the checkpoint still waiting, if any, and stops the thread.
+void checkpointerDestroy(struct Checkpointer *self) {
+    if (!self)
+        return;
+
+    pthread_mutex_lock(&self->lock);
+    self->stop = 1;
+    pthread_cond_broadcast(&self->wake);
+    pthread_mutex_unlock(&self->lock);
+    pthread_join(self->thread, NULL);
+
+    pthread_cond_destroy(&self->wake);
+    pthread_mutex_destroy(&self->lock);
+    checkpointFree(&self->checkpoints[0]);
+    checkpointFree(&self->checkpoints[1]);
+    free(self);
+}
+
+/// Copies the world to be written as the next checkpoint. Never waits for
+/// a checkpoint being written: a copy still waiting for the thread is
+/// replaced by this one. Only one thread may submit.
+int checkpointerSubmit(struct Checkpointer *self, struct World *world) {
+    pthread_mutex_lock(&self->lock);
+    int index = self->writing == 0 ? 1 : 0;
+    if (self->pending >= 0) {
+        index = self->pending;
+        self->pending = -1;
+        ++self->replaced;
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    // The copy is not touched by the thread until it is pending
+    if (!checkpointCapture(&self->checkpoints[index], world))
+        return 0;
+
+    pthread_mutex_lock(&self->lock);
+    self->pending = index;
+    pthread_cond_broadcast(&self->wake);
+    pthread_mutex_unlock(&self->lock);
+    return 1;
+}
@@ -0,0 +1,90 @@
+#ifndef __GAME_OF_LIFE_CHECKPOINT_H__
+#define __GAME_OF_LIFE_CHECKPOINT_H__
+
+#include "world.h"
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CHECKPOINT_MAX_PATH 256
+
+/// Header of a checkpoint file, followed by payload_bytes of live cells.
+/// Fields are in the byte order of the machine that wrote them.
+struct CheckpointHeader {
+    char magic[8];
+    uint32_t topology;
+    uint16_t birth;
+    uint16_t survival;
+    uint64_t generation;
+
+    // Cells of the world, top left cell in world coords
+    int32_t tl_x;
+    int32_t tl_y;
+    uint32_t cols;
+    uint32_t rows;
+
+    // Box of the live cells, packed 8 cells per byte in row order, each
+    // row starting on a new byte
+    int32_t min_x;
+    int32_t min_y;
+    uint32_t live_cols;
+    uint32_t live_rows;
+    uint64_t population;
+
+    uint64_t payload_bytes;
+    uint32_t payload_crc;
+
+    // CRC-32 of the header up to here
+    uint32_t header_crc;
+};
+
+/// Copy of the state of a world, taken between generations so the world
+/// can carry on while it is written.
+struct Checkpoint {
+    struct CheckpointHeader header;
+    unsigned char *cells;
+    size_t capacity;
+};
+
+/// Writes checkpoints on a thread of its own. checkpointerSubmit copies the
+/// world and returns without waiting for the disk. Each file is written to
+/// file_name.tmp and renamed over file_name, the one it replaces is kept as
+/// file_name.prev, so a crash at any point leaves a whole checkpoint.
+struct Checkpointer {
+    pthread_t thread;
+    char file_name[CHECKPOINT_MAX_PATH];
+
+    // A copy being written and a copy waiting for it, or being filled
+    struct Checkpoint checkpoints[2];
+
+    // Guards the fields below
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+
+    // Index of the checkpoint being written and waiting, or -1
+    int writing;
+    int pending;
+    int stop;
+
+    // Checkpoints written, replaced by a newer one before they were
+    // written, and failed to write
+    uint64_t written;
+    uint64_t replaced;
+    uint64_t failed;
+    uint64_t written_generation;
+};
+
+void checkpointInit(struct Checkpoint *self);
+void checkpointFree(struct Checkpoint *self);
+int checkpointCapture(struct Checkpoint *self, struct World *world);
+int checkpointWrite(struct Checkpoint *self, const char *file_name);
+int checkpointRead(struct Checkpoint *self, const char *file_name);
+int checkpointRestore(const struct Checkpoint *self, struct World *world);
+int checkpointResume(struct World *world, const char *file_name);
+
+struct Checkpointer *checkpointerCreate(const char *file_name);
+void checkpointerDestroy(struct Checkpointer *self);
+int checkpointerSubmit(struct Checkpointer *self, struct World *world);
+
+#endif // __GAME_OF_LIFE_CHECKPOINT_H__
@@ -0,0 +1,172 @@
+#include "edit_queue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/// Creates a queue of capacity edits, rounded up to a power of two.
+struct EditQueue *editQueueCreate(unsigned int capacity) {
+
+    struct EditQueue *self = aligned_alloc(64, (sizeof(struct EditQueue) + 63) / 64 * 64);
+    if (!self) {
+        fprintf(stderr, "Failed to allocate memory for the edit queue.\n");
+        return NULL;
+    }
+
+    uint64_t size = 2;
+    while (size < capacity)
+        size *= 2;
+
+    self->slots = malloc(sizeof(struct EditQueueSlot) * size);
+    if (!self->slots) {
+        fprintf(stderr, "edit_queue::editQueueCreate: Error! Failed to allocate memory for %u edits.\n", capacity);
+        free(self);
+        return NULL;
+    }
+    for (uint64_t i = 0; i < size; ++i)
+        self->slots[i].sequence = i;
+    self->mask = size - 1;
+    self->push_pos = 0;
+    self->pop_pos = 0;
+    self->pending = NULL;
+    self->num_pending = 0;
+    self->pending_capacity = 0;
+    return self;
+}
+
+/// Frees the queue and the stamps of edits never applied. No thread may
+/// still push.
+void editQueueDestroy(struct EditQueue *self) {
+    if (!self)
+        return;
+
+    struct WorldEdit edit;
+    while (editQueuePop(self, &edit)) {
+        if (edit.owns_cells)
+            free(edit.cells);
+    }
+    for (unsigned int i = 0; i < self->num_pending; ++i) {
+        if (self->pending[i].owns_cells)
+            free(self->pending[i].cells);
+    }
+    free(self->pending);
+    free(self->slots);
+    free(self);
+}
+
+/// Adds an edit to the queue from any thread. Returns 0 without waiting if
+/// the queue is full, the edit is then not queued and any cells it owns
+/// are still the caller's.
+int editQueuePush(struct EditQueue *self, const struct WorldEdit *edit) {
+    uint64_t pos = __atomic_load_n(&self->push_pos, __ATOMIC_RELAXED);
+    struct EditQueueSlot *slot;
+    while (1) {
+        slot = &self->slots[pos & self->mask];
+        uint64_t sequence = __atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t) (sequence - pos);
+        if (diff == 0) {
+            // Free to write at pos, if no other producer claims it first
+            if (__atomic_compare_exchange_n(&self->push_pos, &pos, pos + 1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                break;
+        } else if (diff < 0) {
+            // Still holds the edit pushed a lap ago
+            return 0;
+        } else {
+            pos = __atomic_load_n(&self->push_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->edit = *edit;
+    __atomic_store_n(&slot->sequence, pos + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/// Takes the oldest edit off the queue. Returns 0 if there is none. Only
+/// the consumer may pop.
+int editQueuePop(struct EditQueue *self, struct WorldEdit *edit) {
+    uint64_t pos = self->pop_pos;
+    struct EditQueueSlot *slot = &self->slots[pos & self->mask];
+    if (__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) != pos + 1)
+        return 0;
+
+    *edit = slot->edit;
+    __atomic_store_n(&slot->sequence, pos + self->mask + 1, __ATOMIC_RELEASE);
+    self->pop_pos = pos + 1;
+    return 1;
+}
+
+/// Applies an edit to the world.
+int editApply(const struct WorldEdit *edit, struct World *world) {
+    switch (edit->kind) {
+        case EditToggle:
+            return worldToggleCellAt(world, edit->x, edit->y);
+        case EditSet:
+            return worldSetCellAt(world, edit->x, edit->y, edit->alive);
+        case EditClearRegion:
+            return worldClearRegion(world, edit->x, edit->y, edit->cols, edit->rows);
+        case EditStamp:
+            return worldStampAt(world, edit->x, edit->y, edit->cols, edit->rows, edit->cells);
+        default:
+            fprintf(stderr, "edit_queue::editApply: Error! Unknown edit kind %d.\n", (int) edit->kind);
+            return 0;
+    }
+}
+
+/// Applies and frees an edit.
+static int applyEdit(struct WorldEdit *edit, struct World *world) {
+    int ok = editApply(edit, world);
+    if (edit->owns_cells)
+        free(edit->cells);
+    if (!ok)
+        fprintf(stderr, "edit_queue::editQueueDrain: Error! Failed to apply an edit at (%d, %d).\n",
+                edit->x, edit->y);
+    return ok;
+}
+
+/// Applies every edit due at the world's current generation, in the order
+/// they were pushed, and keeps the later ones pending. Called by the thread
+/// that updates the world, between generations. applied, if given, is set
+/// to the number of edits applied. An edit that fails to apply is dropped
+/// and 0 returned once the others are applied.
+int editQueueDrain(struct EditQueue *self, struct World *world, unsigned int *applied) {
+    int ok = 1;
+    unsigned int count = 0;
+
+    unsigned int kept = 0;
+    for (unsigned int i = 0; i < self->num_pending; ++i) {
+        if (self->pending[i].at_generation > world->generation) {
+            self->pending[kept++] = self->pending[i];
+            continue;
+        }
+        ok = applyEdit(&self->pending[i], world) && ok;
+        ++count;
+    }
+    self->num_pending = kept;
+
+    struct WorldEdit edit;
+    while (editQueuePop(self, &edit)) {
+        if (edit.at_generation <= world->generation) {
+            ok = applyEdit(&edit, world) && ok;
+            ++count;
+            continue;
+        }
+
+        if (self->num_pending == self->pending_capacity) {
+            unsigned int capacity = self->pending_capacity ? 2 * self->pending_capacity : 16;
+            struct WorldEdit *pending = realloc(self->pending, sizeof(struct WorldEdit) * capacity);
+            if (!pending) {
+                fprintf(stderr, "edit_queue::editQueueDrain: Error! Failed to allocate memory for pending edits.\n");
+                if (edit.owns_cells)
+                    free(edit.cells);
+                ok = 0;
+                continue;
+            }
+            self->pending = pending;
+            self->pending_capacity = capacity;
+        }
+        self->pending[self->num_pending++] = edit;
+    }
+
+    if (applied)
+        *applied = count;
+    return ok;
+}
@@ -0,0 +1,69 @@
+#ifndef __GAME_OF_LIFE_EDIT_QUEUE_H__
+#define __GAME_OF_LIFE_EDIT_QUEUE_H__
+
+#include "world.h"
+
+#include <stdint.h>
+
+/// Change made to the cells by a WorldEdit.
+enum WorldEditKind {
+    EditToggle = 0,     // Toggles the cell at (x, y).
+    EditSet,            // Sets the cell at (x, y) alive or dead, see alive.
+    EditClearRegion,    // Kills the cols x rows cells from (x, y).
+    EditStamp           // Copies cells, cols x rows, over the cells from (x, y).
+};
+
+/// Edit of the cells in world coords, applied between generations.
+struct WorldEdit {
+    enum WorldEditKind kind;
+    int x;
+    int y;
+    unsigned int cols;
+    unsigned int rows;
+    int alive;
+
+    // Pattern of an EditStamp, one byte per cell. Freed once applied if
+    // owns_cells is set, otherwise it must outlive the edit.
+    unsigned char *cells;
+    int owns_cells;
+
+    // The edit is applied to the cells of the first generation at or past
+    // at_generation, before that generation is updated. 0 applies it at
+    // the next boundary between generations.
+    uint64_t at_generation;
+};
+
+/// Slot of the queue. sequence is the position the slot is free to be
+/// written at, plus one once written.
+struct EditQueueSlot {
+    uint64_t sequence;
+    struct WorldEdit edit;
+};
+
+/// Bounded queue of edits, pushed by any number of threads without locks
+/// and drained by the one thread that updates the world. Pushing never
+/// waits, it fails if the queue is full.
+struct EditQueue {
+    struct EditQueueSlot *slots;
+    uint64_t mask;
+
+    // Next position to push at, claimed by producers with a compare and swap.
+    // Kept on its own cache line, apart from the consumer's position.
+    uint64_t push_pos __attribute__((aligned(64)));
+    uint64_t pop_pos __attribute__((aligned(64)));
+
+    // Edits popped before their at_generation, in the order pushed. Only
+    // touched by the consumer.
+    struct WorldEdit *pending;
+    unsigned int num_pending;
+    unsigned int pending_capacity;
+};
+
+struct EditQueue *editQueueCreate(unsigned int capacity);
+void editQueueDestroy(struct EditQueue *self);
+int editQueuePush(struct EditQueue *self, const struct WorldEdit *edit);
+int editQueuePop(struct EditQueue *self, struct WorldEdit *edit);
+int editQueueDrain(struct EditQueue *self, struct World *world, unsigned int *applied);
+int editApply(const struct WorldEdit *edit, struct World *world);
+
+#endif // __GAME_OF_LIFE_EDIT_QUEUE_H__
@@ -46,5 +46,5 @@ int saveFile(const char *path, unsigned int size_in_bytes, char *contents) {
     fprintf(fp, "%s", contents);
 
     fclose(fp);
-    return 0;
+    return 1;
 }
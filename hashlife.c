@@ -0,0 +1,635 @@
+#include "hashlife.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define HASHLIFE_BLOCK_NODES 65536
+#define HASHLIFE_INITIAL_BUCKETS 65536
+#define HASHLIFE_MAX_LEVEL 60
+
+static struct HashLifeNode *allocNode(struct HashLife *self) {
+    if (!self->blocks || self->blocks->used == HASHLIFE_BLOCK_NODES) {
+        struct HashLifeBlock *block = malloc(sizeof(struct HashLifeBlock));
+        if (!block) {
+            fprintf(stderr, "hashlife::allocNode: Error! Failed to allocate a node block.\n");
+            return NULL;
+        }
+        block->nodes = malloc(sizeof(struct HashLifeNode) * HASHLIFE_BLOCK_NODES);
+        if (!block->nodes) {
+            fprintf(stderr, "hashlife::allocNode: Error! Failed to allocate a node block.\n");
+            free(block);
+            return NULL;
+        }
+        block->used = 0;
+        block->next = self->blocks;
+        self->blocks = block;
+    }
+
+    struct HashLifeNode *node = &self->blocks->nodes[self->blocks->used];
+    ++self->blocks->used;
+    return node;
+}
+
+static uint64_t hashChildren(const struct HashLifeNode *nw, const struct HashLifeNode *ne,
+                             const struct HashLifeNode *sw, const struct HashLifeNode *se) {
+    uint64_t h = (uint64_t) (uintptr_t) nw;
+    h = h * 0x9E3779B97F4A7C15ull + (uint64_t) (uintptr_t) ne;
+    h = h * 0x9E3779B97F4A7C15ull + (uint64_t) (uintptr_t) sw;
+    h = h * 0x9E3779B97F4A7C15ull + (uint64_t) (uintptr_t) se;
+    return h ^ (h >> 29);
+}
+
+/// Doubles the number of hash buckets.
+static int growBuckets(struct HashLife *self) {
+    uint64_t num_buckets = self->num_buckets * 2;
+    struct HashLifeNode **buckets = calloc(num_buckets, sizeof(struct HashLifeNode *));
+    if (!buckets) {
+        fprintf(stderr, "hashlife::growBuckets: Error! Failed to allocate %lu buckets.\n", (unsigned long) num_buckets);
+        return 0;
+    }
+
+    for (uint64_t i = 0; i < self->num_buckets; ++i) {
+        struct HashLifeNode *node = self->buckets[i];
+        while (node) {
+            struct HashLifeNode *next = node->next;
+            uint64_t b = hashChildren(node->nw, node->ne, node->sw, node->se) & (num_buckets - 1);
+            node->next = buckets[b];
+            buckets[b] = node;
+            node = next;
+        }
+    }
+
+    free(self->buckets);
+    self->buckets = buckets;
+    self->num_buckets = num_buckets;
+    return 1;
+}
+
+/// Returns the unique node with the given children, creating it if needed.
+static struct HashLifeNode *findNode(struct HashLife *self, struct HashLifeNode *nw, struct HashLifeNode *ne,
+                                     struct HashLifeNode *sw, struct HashLifeNode *se) {
+    if (!nw || !ne || !sw || !se)
+        return NULL;
+
+    uint64_t b = hashChildren(nw, ne, sw, se) & (self->num_buckets - 1);
+    for (struct HashLifeNode *node = self->buckets[b]; node; node = node->next) {
+        if (node->nw == nw && node->ne == ne && node->sw == sw && node->se == se)
+            return node;
+    }
+
+    struct HashLifeNode *node = allocNode(self);
+    if (!node)
+        return NULL;
+
+    node->nw = nw;
+    node->ne = ne;
+    node->sw = sw;
+    node->se = se;
+    node->result = NULL;
+    node->result_step = 0;
+    node->level = nw->level + 1;
+    node->population = nw->population + ne->population + sw->population + se->population;
+    uint64_t power_x = self->hash_x[nw->level];
+    uint64_t power_y = self->hash_y[nw->level];
+    node->hash = nw->hash + power_x * ne->hash + power_y * (sw->hash + power_x * se->hash);
+    node->next = self->buckets[b];
+    self->buckets[b] = node;
+    ++self->num_nodes;
+
+    if (self->num_nodes > self->num_buckets - self->num_buckets / 4)
+        growBuckets(self);
+
+    return node;
+}
+
+static struct HashLifeNode *emptyNode(struct HashLife *self, unsigned int level) {
+    if (level == 0)
+        return self->dead;
+
+    if (!self->empty[level]) {
+        struct HashLifeNode *e = emptyNode(self, level - 1);
+        self->empty[level] = findNode(self, e, e, e, e);
+    }
+    return self->empty[level];
+}
+
+static struct HashLifeNode *createLeaf(int alive) {
+    struct HashLifeNode *leaf = malloc(sizeof(struct HashLifeNode));
+    if (!leaf) {
+        fprintf(stderr, "hashlife::createLeaf: Error! Failed to allocate a leaf.\n");
+        return NULL;
+    }
+    leaf->nw = NULL;
+    leaf->ne = NULL;
+    leaf->sw = NULL;
+    leaf->se = NULL;
+    leaf->result = NULL;
+    leaf->result_step = 0;
+    leaf->level = 0;
+    leaf->population = alive ? 1 : 0;
+    leaf->hash = leaf->population;
+    leaf->next = NULL;
+    return leaf;
+}
+
+struct HashLife *hashLifeCreate() {
+
+    struct HashLife *self = calloc(1, sizeof(struct HashLife));
+    if (!self) {
+        fprintf(stderr, "Failed to allocate memory for the HashLife universe.\n");
+        return NULL;
+    }
+
+    self->num_buckets = HASHLIFE_INITIAL_BUCKETS;
+    self->buckets = calloc(self->num_buckets, sizeof(struct HashLifeNode *));
+    self->dead = createLeaf(0);
+    self->alive = createLeaf(1);
+    if (!self->buckets || !self->dead || !self->alive) {
+        fprintf(stderr, "Failed to allocate memory for the HashLife universe.\n");
+        hashLifeDestroy(self);
+        return NULL;
+    }
+
+    self->hash_x[0] = HASHLIFE_HASH_P;
+    self->hash_y[0] = HASHLIFE_HASH_Q;
+    for (int level = 1; level < 64; ++level) {
+        self->hash_x[level] = self->hash_x[level - 1] * self->hash_x[level - 1];
+        self->hash_y[level] = self->hash_y[level - 1] * self->hash_y[level - 1];
+    }
+
+    lifeRuleConway(&self->rule);
+    self->root = emptyNode(self, 3);
+    if (!self->root) {
+        hashLifeDestroy(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+void hashLifeDestroy(struct HashLife *self) {
+    if (!self)
+        return;
+
+    struct HashLifeBlock *block = self->blocks;
+    while (block) {
+        struct HashLifeBlock *next = block->next;
+        free(block->nodes);
+        free(block);
+        block = next;
+    }
+
+    free(self->buckets);
+    free(self->dead);
+    free(self->alive);
+    free(self);
+}
+
+/// Sets the rule, forgetting every result memoised under the previous rule.
+void hashLifeSetRule(struct HashLife *self, const struct LifeRule *rule) {
+    if (lifeRuleEqual(&self->rule, rule))
+        return;
+
+    self->rule = *rule;
+    for (uint64_t b = 0; b < self->num_buckets; ++b) {
+        for (struct HashLifeNode *node = self->buckets[b]; node; node = node->next)
+            node->result = NULL;
+    }
+}
+
+/// Centre 2x2 of a 4x4 node after one generation, by brute force.
+static struct HashLifeNode *baseResult(struct HashLife *self, struct HashLifeNode *node) {
+    int grid[4][4];
+    struct HashLifeNode *quads[4] = {node->nw, node->ne, node->sw, node->se};
+    for (int q = 0; q < 4; ++q) {
+        int r0 = (q / 2) * 2;
+        int c0 = (q % 2) * 2;
+        grid[r0][c0] = quads[q]->nw->population;
+        grid[r0][c0 + 1] = quads[q]->ne->population;
+        grid[r0 + 1][c0] = quads[q]->sw->population;
+        grid[r0 + 1][c0 + 1] = quads[q]->se->population;
+    }
+
+    struct HashLifeNode *out[4];
+    for (int i = 0; i < 4; ++i) {
+        int r = 1 + i / 2;
+        int c = 1 + i % 2;
+        int live_neighbours = 0;
+        for (int dr = -1; dr <= 1; ++dr) {
+            for (int dc = -1; dc <= 1; ++dc) {
+                if (dr != 0 || dc != 0)
+                    live_neighbours += grid[r + dr][c + dc];
+            }
+        }
+        out[i] = self->rule.table[9 * grid[r][c] + live_neighbours] ? self->alive : self->dead;
+    }
+
+    return findNode(self, out[0], out[1], out[2], out[3]);
+}
+
+/// The centre square of half the size, no time passes.
+static struct HashLifeNode *centre(struct HashLife *self, struct HashLifeNode *node) {
+    return findNode(self, node->nw->se, node->ne->sw, node->sw->ne, node->se->nw);
+}
+
+static struct HashLifeNode *centreHorizontal(struct HashLife *self, struct HashLifeNode *w, struct HashLifeNode *e) {
+    return findNode(self, w->ne, e->nw, w->se, e->sw);
+}
+
+static struct HashLifeNode *centreVertical(struct HashLife *self, struct HashLifeNode *n, struct HashLifeNode *s) {
+    return findNode(self, n->sw, n->se, s->nw, s->ne);
+}
+
+/// Returns the centre square of a level L node after 2^step generations,
+/// where step <= L - 2. Results are memoised on the node.
+static struct HashLifeNode *nodeResult(struct HashLife *self, struct HashLifeNode *node, unsigned int step) {
+    if (node->population == 0)
+        return emptyNode(self, node->level - 1);
+
+    if (node->result && node->result_step == step)
+        return node->result;
+
+    struct HashLifeNode *result;
+    if (node->level == 2) {
+        result = baseResult(self, node);
+    } else {
+        // Nine overlapping squares of half the size tile the node.
+        struct HashLifeNode *n[9];
+        n[0] = node->nw;
+        n[1] = centreHorizontal(self, node->nw, node->ne);
+        n[2] = node->ne;
+        n[3] = centreVertical(self, node->nw, node->sw);
+        n[4] = centre(self, node);
+        n[5] = centreVertical(self, node->ne, node->se);
+        n[6] = node->sw;
+        n[7] = centreHorizontal(self, node->sw, node->se);
+        n[8] = node->se;
+
+        // At full speed both halves of the recursion advance time, otherwise
+        // only the second half does.
+        int full_speed = step == node->level - 2;
+        unsigned int sub_step = full_speed ? step - 1 : step;
+        struct HashLifeNode *r[9];
+        for (int i = 0; i < 9; ++i) {
+            if (!n[i])
+                return NULL;
+            r[i] = full_speed ? nodeResult(self, n[i], sub_step) : centre(self, n[i]);
+        }
+
+        struct HashLifeNode *a = findNode(self, r[0], r[1], r[3], r[4]);
+        struct HashLifeNode *b = findNode(self, r[1], r[2], r[4], r[5]);
+        struct HashLifeNode *c = findNode(self, r[3], r[4], r[6], r[7]);
+        struct HashLifeNode *d = findNode(self, r[4], r[5], r[7], r[8]);
+        if (!a || !b || !c || !d)
+            return NULL;
+
+        result = findNode(self, nodeResult(self, a, sub_step), nodeResult(self, b, sub_step),
+                          nodeResult(self, c, sub_step), nodeResult(self, d, sub_step));
+    }
+
+    if (!result)
+        return NULL;
+
+    node->result = result;
+    node->result_step = step;
+    return result;
+}
+
+/// Doubles the size of the root, keeping the pattern in the centre.
+static int expandRoot(struct HashLife *self) {
+    struct HashLifeNode *root = self->root;
+    if (root->level >= HASHLIFE_MAX_LEVEL) {
+        fprintf(stderr, "hashlife::expandRoot: Error! Pattern exceeds the maximum universe size.\n");
+        return 0;
+    }
+
+    struct HashLifeNode *e = emptyNode(self, root->level - 1);
+    struct HashLifeNode *expanded = findNode(self,
+        findNode(self, e, e, e, root->nw),
+        findNode(self, e, e, root->ne, e),
+        findNode(self, e, root->sw, e, e),
+        findNode(self, root->se, e, e, e));
+    if (!expanded)
+        return 0;
+
+    int64_t half = (int64_t) 1 << (root->level - 1);
+    self->origin_x -= half;
+    self->origin_y -= half;
+    self->root = expanded;
+    return 1;
+}
+
+/// True when every live cell is in the centre quarter of the root.
+static int isPadded(struct HashLifeNode *root) {
+    if (root->level < 3)
+        return 0;
+
+    return root->population == root->nw->se->se->population + root->ne->sw->sw->population +
+                               root->sw->ne->ne->population + root->se->nw->nw->population;
+}
+
+static struct HashLifeNode *buildNode(struct HashLife *self, const unsigned char *cells, unsigned int rows,
+                                      unsigned int cols, unsigned int stride, uint64_t x, uint64_t y,
+                                      unsigned int level) {
+    if (x >= cols || y >= rows)
+        return emptyNode(self, level);
+
+    if (level == 0)
+        return cells[y * stride + x] ? self->alive : self->dead;
+
+    uint64_t half = (uint64_t) 1 << (level - 1);
+    return findNode(self,
+        buildNode(self, cells, rows, cols, stride, x, y, level - 1),
+        buildNode(self, cells, rows, cols, stride, x + half, y, level - 1),
+        buildNode(self, cells, rows, cols, stride, x, y + half, level - 1),
+        buildNode(self, cells, rows, cols, stride, x + half, y + half, level - 1));
+}
+
+/// Replaces the pattern with rows x cols cells, one byte per cell and stride
+/// bytes per row, whose top left cell is at (tl_x, tl_y) in world coords.
+int hashLifeSetCells(struct HashLife *self, const unsigned char *cells, unsigned int rows, unsigned int cols,
+                     unsigned int stride, int64_t tl_x, int64_t tl_y) {
+    unsigned int level = 3;
+    while (((uint64_t) 1 << level) < rows || ((uint64_t) 1 << level) < cols)
+        ++level;
+
+    struct HashLifeNode *root = buildNode(self, cells, rows, cols, stride, 0, 0, level);
+    if (!root) {
+        fprintf(stderr, "hashlife::hashLifeSetCells: Error! Failed to build the quadtree.\n");
+        return 0;
+    }
+
+    self->root = root;
+    self->origin_x = tl_x;
+    self->origin_y = tl_y;
+    return 1;
+}
+
+static void writeNode(struct HashLifeNode *node, int64_t x, int64_t y, unsigned char *cells,
+                      unsigned int rows, unsigned int cols, unsigned int stride, int64_t tl_x, int64_t tl_y) {
+    if (node->population == 0)
+        return;
+
+    int64_t size = (int64_t) 1 << node->level;
+    if (x + size <= tl_x || y + size <= tl_y || x >= tl_x + cols || y >= tl_y + rows)
+        return;
+
+    if (node->level == 0) {
+        cells[(y - tl_y) * stride + (x - tl_x)] = 1;
+        return;
+    }
+
+    int64_t half = size / 2;
+    writeNode(node->nw, x, y, cells, rows, cols, stride, tl_x, tl_y);
+    writeNode(node->ne, x + half, y, cells, rows, cols, stride, tl_x, tl_y);
+    writeNode(node->sw, x, y + half, cells, rows, cols, stride, tl_x, tl_y);
+    writeNode(node->se, x + half, y + half, cells, rows, cols, stride, tl_x, tl_y);
+}
+
+/// Writes the rows x cols cells whose top left cell is at (tl_x, tl_y) in
+/// world coords, one byte per cell and stride bytes per row.
+int hashLifeGetCells(struct HashLife *self, unsigned char *cells, unsigned int rows, unsigned int cols,
+                     unsigned int stride, int64_t tl_x, int64_t tl_y) {
+    for (uint64_t r = 0; r < rows; ++r) {
+        for (uint64_t c = 0; c < cols; ++c)
+            cells[r * stride + c] = 0;
+    }
+
+    writeNode(self->root, self->origin_x, self->origin_y, cells, rows, cols, stride, tl_x, tl_y);
+    return 1;
+}
+
+/// Offset of the first live row (vertical) or col of the node.
+static int64_t firstLive(struct HashLifeNode *node, int vertical) {
+    if (node->level == 0)
+        return 0;
+
+    int64_t half = (int64_t) 1 << (node->level - 1);
+    struct HashLifeNode *near_a = node->nw;
+    struct HashLifeNode *near_b = vertical ? node->ne : node->sw;
+    struct HashLifeNode *far_a = vertical ? node->sw : node->ne;
+    struct HashLifeNode *far_b = node->se;
+
+    if (near_a->population || near_b->population) {
+        int64_t best = INT64_MAX;
+        if (near_a->population)
+            best = firstLive(near_a, vertical);
+        if (near_b->population) {
+            int64_t b = firstLive(near_b, vertical);
+            best = b < best ? b : best;
+        }
+        return best;
+    }
+
+    int64_t best = INT64_MAX;
+    if (far_a->population)
+        best = firstLive(far_a, vertical);
+    if (far_b->population) {
+        int64_t b = firstLive(far_b, vertical);
+        best = b < best ? b : best;
+    }
+    return half + best;
+}
+
+/// Offset of the last live row (vertical) or col of the node.
+static int64_t lastLive(struct HashLifeNode *node, int vertical) {
+    if (node->level == 0)
+        return 0;
+
+    int64_t half = (int64_t) 1 << (node->level - 1);
+    struct HashLifeNode *near_a = node->se;
+    struct HashLifeNode *near_b = vertical ? node->sw : node->ne;
+    struct HashLifeNode *far_a = vertical ? node->ne : node->sw;
+    struct HashLifeNode *far_b = node->nw;
+
+    if (near_a->population || near_b->population) {
+        int64_t best = INT64_MIN;
+        if (near_a->population)
+            best = lastLive(near_a, vertical);
+        if (near_b->population) {
+            int64_t b = lastLive(near_b, vertical);
+            best = b > best ? b : best;
+        }
+        return half + best;
+    }
+
+    int64_t best = INT64_MIN;
+    if (far_a->population)
+        best = lastLive(far_a, vertical);
+    if (far_b->population) {
+        int64_t b = lastLive(far_b, vertical);
+        best = b > best ? b : best;
+    }
+    return best;
+}
+
+/// Bounding box of the live cells in world coords, inclusive. Returns 0 if
+/// there are no live cells.
+int hashLifeBounds(struct HashLife *self, int64_t *min_x, int64_t *min_y, int64_t *max_x, int64_t *max_y) {
+    if (self->root->population == 0)
+        return 0;
+
+    *min_x = self->origin_x + firstLive(self->root, 0);
+    *min_y = self->origin_y + firstLive(self->root, 1);
+    *max_x = self->origin_x + lastLive(self->root, 0);
+    *max_y = self->origin_y + lastLive(self->root, 1);
+    return 1;
+}
+
+/// True if the cell at world coords (x, y) is alive.
+int hashLifeCell(struct HashLife *self, int64_t x, int64_t y) {
+    uint64_t size = (uint64_t) 1 << self->root->level;
+    if (x < self->origin_x || y < self->origin_y ||
+        (uint64_t) (x - self->origin_x) >= size || (uint64_t) (y - self->origin_y) >= size)
+        return 0;
+
+    struct HashLifeNode *node = self->root;
+    uint64_t cx = (uint64_t) (x - self->origin_x);
+    uint64_t cy = (uint64_t) (y - self->origin_y);
+    while (node->level > 0 && node->population) {
+        uint64_t half = (uint64_t) 1 << (node->level - 1);
+        if (cy < half)
+            node = cx < half ? node->nw : node->ne;
+        else
+            node = cx < half ? node->sw : node->se;
+        cx &= half - 1;
+        cy &= half - 1;
+    }
+    return node->population != 0;
+}
+
+/// The node with the cell (x, y) from its top left cell set alive or dead.
+static struct HashLifeNode *setNode(struct HashLife *self, struct HashLifeNode *node, uint64_t x, uint64_t y,
+                                    int alive) {
+    if (node->level == 0)
+        return alive ? self->alive : self->dead;
+
+    uint64_t half = (uint64_t) 1 << (node->level - 1);
+    struct HashLifeNode *quads[4] = {node->nw, node->ne, node->sw, node->se};
+    int q = (y >= half) * 2 + (x >= half);
+    quads[q] = setNode(self, quads[q], x & (half - 1), y & (half - 1), alive);
+    return findNode(self, quads[0], quads[1], quads[2], quads[3]);
+}
+
+/// Sets the cell at world coords (x, y) alive or dead, growing the root to
+/// hold it.
+int hashLifeSetCell(struct HashLife *self, int64_t x, int64_t y, int alive) {
+    while (x < self->origin_x || y < self->origin_y ||
+           (uint64_t) (x - self->origin_x) >= (uint64_t) 1 << self->root->level ||
+           (uint64_t) (y - self->origin_y) >= (uint64_t) 1 << self->root->level) {
+        if (!expandRoot(self))
+            return 0;
+    }
+
+    struct HashLifeNode *root = setNode(self, self->root, (uint64_t) (x - self->origin_x),
+                                        (uint64_t) (y - self->origin_y), alive);
+    if (!root) {
+        fprintf(stderr, "hashlife::hashLifeSetCell: Error! Ran out of memory for nodes.\n");
+        return 0;
+    }
+    self->root = root;
+    return 1;
+}
+
+/// Kills every cell. The memoised results are kept.
+void hashLifeClear(struct HashLife *self) {
+    self->root = emptyNode(self, 3);
+}
+
+/// Copy of node in the universe into, see hashLifeCollect. While copying,
+/// the result of each node copied holds its copy.
+static struct HashLifeNode *copyNode(struct HashLife *into, struct HashLifeNode *node) {
+    if (node->level == 0)
+        return node->population ? into->alive : into->dead;
+    if (node->result)
+        return node->result;
+
+    node->result = findNode(into, copyNode(into, node->nw), copyNode(into, node->ne),
+                            copyNode(into, node->sw), copyNode(into, node->se));
+    return node->result;
+}
+
+/// Frees every node the root does not use, by copying the root into new
+/// blocks. The memoised results are forgotten. Returns 0 if the new blocks
+/// cannot be allocated, leaving the pattern as it was.
+int hashLifeCollect(struct HashLife *self) {
+    struct HashLife *collected = hashLifeCreate();
+    if (!collected)
+        return 0;
+
+    for (uint64_t b = 0; b < self->num_buckets; ++b) {
+        for (struct HashLifeNode *node = self->buckets[b]; node; node = node->next)
+            node->result = NULL;
+    }
+    struct HashLifeNode *root = copyNode(collected, self->root);
+    for (uint64_t b = 0; b < self->num_buckets; ++b) {
+        for (struct HashLifeNode *node = self->buckets[b]; node; node = node->next)
+            node->result = NULL;
+    }
+    if (!root) {
+        fprintf(stderr, "hashlife::hashLifeCollect: Error! Ran out of memory for nodes.\n");
+        hashLifeDestroy(collected);
+        return 0;
+    }
+
+    collected->rule = self->rule;
+    collected->root = root;
+    collected->origin_x = self->origin_x;
+    collected->origin_y = self->origin_y;
+    collected->generation = self->generation;
+
+    // The universe takes the new nodes and the old ones are freed with the
+    // copy of the universe they are swapped into
+    struct HashLife old = *self;
+    *self = *collected;
+    *collected = old;
+    hashLifeDestroy(collected);
+    return 1;
+}
+
+/// Advances the pattern by 2^log2_generations generations.
+int hashLifeStep(struct HashLife *self, unsigned int log2_generations) {
+    if (log2_generations > HASHLIFE_MAX_LEVEL - 3) {
+        fprintf(stderr, "hashlife::hashLifeStep: Error! Step of 2^%u generations is too large.\n", log2_generations);
+        return 0;
+    }
+
+    if (self->root->population != 0) {
+        // The result is the centre half of the root, so the pattern needs
+        // 2^log2_generations of empty space around it to grow into.
+        while (self->root->level < log2_generations + 3 || !isPadded(self->root)) {
+            if (!expandRoot(self))
+                return 0;
+        }
+
+        struct HashLifeNode *result = nodeResult(self, self->root, log2_generations);
+        if (!result) {
+            fprintf(stderr, "hashlife::hashLifeStep: Error! Ran out of memory for nodes.\n");
+            return 0;
+        }
+
+        int64_t quarter = (int64_t) 1 << (self->root->level - 2);
+        self->origin_x += quarter;
+        self->origin_y += quarter;
+        self->root = result;
+    }
+
+    self->generation += (uint64_t) 1 << log2_generations;
+    return 1;
+}
+
+/// Advances the pattern by any number of generations, one power of two at a time.
+int hashLifeAdvance(struct HashLife *self, uint64_t generations) {
+    for (unsigned int k = 0; k < 64 && generations; ++k) {
+        if (generations & ((uint64_t) 1 << k)) {
+            if (!hashLifeStep(self, k))
+                return 0;
+            generations &= ~((uint64_t) 1 << k);
+        }
+    }
+    return 1;
+}
+
+uint64_t hashLifePopulation(struct HashLife *self) {
+    return self->root->population;
+}
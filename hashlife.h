@@ -0,0 +1,90 @@
+#ifndef __GAME_OF_LIFE_HASHLIFE_H__
+#define __GAME_OF_LIFE_HASHLIFE_H__
+
+#include "life_rule.h"
+
+#include <stdint.h>
+
+// Odd multipliers of the hash of the live cells of a node, the sum of
+// P^x * Q^y over its live cells at (x, y) from its top left cell. The same
+// as those of the World hash, so a world can take its hash from the root.
+#define HASHLIFE_HASH_P 0x9E3779B97F4A7C15ull
+#define HASHLIFE_HASH_Q 0xC2B2AE3D27D4EB4Full
+
+/// Square of 2^level cells. Nodes are hash consed, so two identical squares
+/// are always the same node and can be compared by pointer. Level 0 nodes
+/// are single cells and have no children.
+struct HashLifeNode {
+    struct HashLifeNode *nw;
+    struct HashLifeNode *ne;
+    struct HashLifeNode *sw;
+    struct HashLifeNode *se;
+
+    // Memoised centre square of half the size, 2^result_step generations
+    // in the future.
+    struct HashLifeNode *result;
+    unsigned int result_step;
+
+    unsigned int level;
+    uint64_t population;
+    uint64_t hash;
+
+    // Next node in the same hash bucket
+    struct HashLifeNode *next;
+};
+
+/// Nodes are allocated from blocks that are only freed with the universe,
+/// or when hashLifeCollect moves the live nodes into new blocks.
+struct HashLifeBlock {
+    struct HashLifeNode *nodes;
+    unsigned int used;
+    struct HashLifeBlock *next;
+};
+
+/// A HashLife universe. Advances the pattern in root by powers of two
+/// generations at a time, reusing the result of every square it has seen.
+struct HashLife {
+
+    struct HashLifeNode **buckets;
+    uint64_t num_buckets;
+    uint64_t num_nodes;
+    struct HashLifeBlock *blocks;
+
+    // Empty node of each level, built on demand
+    struct HashLifeNode *empty[64];
+    struct HashLifeNode *dead;
+    struct HashLifeNode *alive;
+
+    // HASHLIFE_HASH_P and HASHLIFE_HASH_Q to the power 2^level, the hash
+    // multipliers of the quadrants of a node of level + 1
+    uint64_t hash_x[64];
+    uint64_t hash_y[64];
+
+    // The pattern and the world coords of its top left cell
+    struct HashLifeNode *root;
+    int64_t origin_x;
+    int64_t origin_y;
+
+    uint64_t generation;
+
+    // Rule the memoised results were computed with
+    struct LifeRule rule;
+};
+
+struct HashLife *hashLifeCreate();
+void hashLifeDestroy(struct HashLife *self);
+void hashLifeSetRule(struct HashLife *self, const struct LifeRule *rule);
+int hashLifeSetCells(struct HashLife *self, const unsigned char *cells, unsigned int rows, unsigned int cols,
+                     unsigned int stride, int64_t tl_x, int64_t tl_y);
+int hashLifeGetCells(struct HashLife *self, unsigned char *cells, unsigned int rows, unsigned int cols,
+                     unsigned int stride, int64_t tl_x, int64_t tl_y);
+int hashLifeBounds(struct HashLife *self, int64_t *min_x, int64_t *min_y, int64_t *max_x, int64_t *max_y);
+int hashLifeCell(struct HashLife *self, int64_t x, int64_t y);
+int hashLifeSetCell(struct HashLife *self, int64_t x, int64_t y, int alive);
+void hashLifeClear(struct HashLife *self);
+int hashLifeCollect(struct HashLife *self);
+int hashLifeStep(struct HashLife *self, unsigned int log2_generations);
+int hashLifeAdvance(struct HashLife *self, uint64_t generations);
+uint64_t hashLifePopulation(struct HashLife *self);
+
+#endif // __GAME_OF_LIFE_HASHLIFE_H__
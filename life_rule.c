@@ -0,0 +1,84 @@
+#include "life_rule.h"
+
+#include <stdio.h>
+#include <ctype.h>
+
+#define CONWAY_BIRTH (1 << 3)
+#define CONWAY_SURVIVAL ((1 << 2) | (1 << 3))
+
+/// Fills the transition table from the birth and survival masks.
+static void buildTable(struct LifeRule *self) {
+    for (int n = 0; n <= 8; ++n) {
+        self->table[n] = (self->birth >> n) & 1;
+        self->table[9 + n] = (self->survival >> n) & 1;
+    }
+    self->is_conway = self->birth == CONWAY_BIRTH && self->survival == CONWAY_SURVIVAL;
+}
+
+void lifeRuleConway(struct LifeRule *self) {
+    self->birth = CONWAY_BIRTH;
+    self->survival = CONWAY_SURVIVAL;
+    buildTable(self);
+}
+
+/// Parses a rule such as "B3/S23", in either order and either case. The
+/// rule is left unchanged if the string is invalid. Rules with B0 are
+/// rejected, since every dead cell of an infinite world would be born.
+int lifeRuleParse(struct LifeRule *self, const char *str) {
+    uint16_t birth = 0;
+    uint16_t survival = 0;
+    uint16_t *counts = NULL;
+    int has_birth = 0;
+    int has_survival = 0;
+
+    for (const char *ch = str; *ch && *ch != '\n' && *ch != '\r'; ++ch) {
+        char upper = (char) toupper((unsigned char) *ch);
+        if (upper == 'B') {
+            counts = &birth;
+            has_birth = 1;
+        } else if (upper == 'S') {
+            counts = &survival;
+            has_survival = 1;
+        } else if (*ch >= '0' && *ch <= '8' && counts) {
+            *counts |= (uint16_t) (1 << (*ch - '0'));
+        } else if (*ch != '/' && *ch != ' ') {
+            fprintf(stderr, "life_rule::lifeRuleParse: Error! Invalid rule %s, expected B/S notation such as B3/S23\n", str);
+            return 0;
+        }
+    }
+
+    if (!has_birth || !has_survival) {
+        fprintf(stderr, "life_rule::lifeRuleParse: Error! Invalid rule %s, expected B/S notation such as B3/S23\n", str);
+        return 0;
+    }
+
+    if (birth & 1) {
+        fprintf(stderr, "life_rule::lifeRuleParse: Error! Rules with B0 are not supported.\n");
+        return 0;
+    }
+
+    self->birth = birth;
+    self->survival = survival;
+    buildTable(self);
+    return 1;
+}
+
+void lifeRuleToString(const struct LifeRule *self, char str[LIFE_RULE_MAX_CHARS]) {
+    int i = 0;
+    str[i++] = 'B';
+    for (int n = 0; n <= 8; ++n) {
+        if ((self->birth >> n) & 1)
+            str[i++] = (char) ('0' + n);
+    }
+    str[i++] = '/';
+    str[i++] = 'S';
+    for (int n = 0; n <= 8; ++n) {
+        if ((self->survival >> n) & 1)
+            str[i++] = (char) ('0' + n);
+    }
+    str[i] = '\0';
+}
+
+int lifeRuleEqual(const struct LifeRule *a, const struct LifeRule *b) {
+    return a->birth == b->birth && a->survival == b->survival;
+}
@@ -0,0 +1,29 @@
+#ifndef __GAME_OF_LIFE_LIFE_RULE_H__
+#define __GAME_OF_LIFE_LIFE_RULE_H__
+
+#include <stdint.h>
+
+#define LIFE_RULE_MAX_CHARS 24
+
+/// Outer totalistic Life-like rule in B/S notation, such as B3/S23 for
+/// Conway's Game of Life or B36/S23 for HighLife.
+struct LifeRule {
+
+    // Bit n is set if a dead cell with n live neighbours is born, and if a
+    // live cell with n live neighbours survives.
+    uint16_t birth;
+    uint16_t survival;
+
+    // Next state of a cell, indexed by 9 * alive + live neighbours
+    unsigned char table[18];
+
+    // Set for B3/S23, which the word kernels evaluate with a fixed fast path
+    int is_conway;
+};
+
+void lifeRuleConway(struct LifeRule *self);
+int lifeRuleParse(struct LifeRule *self, const char *str);
+void lifeRuleToString(const struct LifeRule *self, char str[LIFE_RULE_MAX_CHARS]);
+int lifeRuleEqual(const struct LifeRule *a, const struct LifeRule *b);
+
+#endif // __GAME_OF_LIFE_LIFE_RULE_H__
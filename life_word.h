@@ -0,0 +1,93 @@
+#ifndef __GAME_OF_LIFE_LIFE_WORD_H__
+#define __GAME_OF_LIFE_LIFE_WORD_H__
+
+#include "life_rule.h"
+
+#include <stdint.h>
+
+// Word parallel Game of Life kernel shared by the bit packed engines.
+// Bit i of a word is the cell at col i of a 64 cell row segment.
+
+/// Adds three bit planes, one cell per bit.
+static inline void fullAdd(uint64_t a, uint64_t b, uint64_t c, uint64_t *sum, uint64_t *carry) {
+    uint64_t u = a ^ b;
+    *sum = u ^ c;
+    *carry = (a & b) | (u & c);
+}
+
+/// Word with its cells moved one col right, so bit i holds col i - 1.
+/// prev is the word to the left, whose last cell moves into bit 0.
+static inline uint64_t shiftInLeft(uint64_t word, uint64_t prev) {
+    return (word << 1) | (prev >> 63);
+}
+
+/// Word with its cells moved one col left, so bit i holds col i + 1.
+/// next is the word to the right, whose first cell moves into bit 63.
+static inline uint64_t shiftInRight(uint64_t word, uint64_t next) {
+    return (word >> 1) | (next << 63);
+}
+
+/// Neighbour counts of the 64 cells in m, as the bit planes of a 4 bit
+/// count per cell. a and b are the rows above and below, and the *l / *r
+/// words are the same rows shifted by shiftInLeft and shiftInRight.
+static inline void lifeWordCount(uint64_t al, uint64_t a, uint64_t ar,
+                                 uint64_t ml, uint64_t mr,
+                                 uint64_t bl, uint64_t b, uint64_t br,
+                                 uint64_t *ones, uint64_t *twos, uint64_t *fours, uint64_t *eights) {
+
+    // The eight neighbour bit planes are summed with full adders
+    uint64_t s_above, c_above, s_below, c_below;
+    fullAdd(al, a, ar, &s_above, &c_above);
+    fullAdd(bl, b, br, &s_below, &c_below);
+    uint64_t s_mid = ml ^ mr;
+    uint64_t c_mid = ml & mr;
+
+    uint64_t carry_ones;
+    fullAdd(s_above, s_below, s_mid, ones, &carry_ones);
+
+    uint64_t twos_partial, carry_twos;
+    fullAdd(c_above, c_below, c_mid, &twos_partial, &carry_twos);
+    *twos = twos_partial ^ carry_ones;
+    uint64_t carry_fours = twos_partial & carry_ones;
+    *fours = carry_twos ^ carry_fours;
+    *eights = carry_twos & carry_fours;
+}
+
+/// Next generation of the 64 cells in m under B3/S23.
+static inline uint64_t lifeWordNext(uint64_t al, uint64_t a, uint64_t ar,
+                                    uint64_t ml, uint64_t m, uint64_t mr,
+                                    uint64_t bl, uint64_t b, uint64_t br) {
+    uint64_t ones, twos, fours, eights;
+    lifeWordCount(al, a, ar, ml, mr, bl, b, br, &ones, &twos, &fours, &eights);
+
+    // Born with 3, survives with 2 or 3
+    return twos & ~fours & ~eights & (ones | m);
+}
+
+/// Next generation of the 64 cells in m under any rule. Conway's rule
+/// takes the fixed path of lifeWordNext, other rules select the cells whose
+/// count is in the birth or survival set of the rule, one count at a time.
+static inline uint64_t lifeWordNextRule(uint64_t al, uint64_t a, uint64_t ar,
+                                        uint64_t ml, uint64_t m, uint64_t mr,
+                                        uint64_t bl, uint64_t b, uint64_t br,
+                                        const struct LifeRule *rule) {
+    if (rule->is_conway)
+        return lifeWordNext(al, a, ar, ml, m, mr, bl, b, br);
+
+    uint64_t ones, twos, fours, eights;
+    lifeWordCount(al, a, ar, ml, mr, bl, b, br, &ones, &twos, &fours, &eights);
+
+    uint64_t planes[4] = {ones, twos, fours, eights};
+    uint64_t next = 0;
+    for (int n = 0; n <= 8; ++n) {
+        uint64_t cells = (rule->birth >> n & 1 ? ~m : 0) | (rule->survival >> n & 1 ? m : 0);
+        if (!cells)
+            continue;
+        for (int bit = 0; bit < 4; ++bit)
+            cells &= (n >> bit) & 1 ? planes[bit] : ~planes[bit];
+        next |= cells;
+    }
+    return next;
+}
+
+#endif // __GAME_OF_LIFE_LIFE_WORD_H__
@@ -1,12 +1,19 @@
 #include "renderer.h"
 #include "world.h"
 #include "window.h"
+#include "checkpoint.h"
 
+#include <getopt.h>
+#include <inttypes.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
 
-int init(struct Renderer **renderer, struct World **world, enum ColorScheme cs);
+int init(struct Renderer **renderer, struct World **world, enum ColorScheme cs, int headless);
+int runHeadless(struct World *world, uint64_t generations, struct Checkpointer *checkpointer,
+                uint64_t checkpoint_generations);
+int runMapped(struct World *world, const char *tile_file_path, int load_file, int set_rule, uint64_t generations);
 void cleanup(struct Renderer *renderer, struct World *world);
 void printUsage();
 void printControls();
@@ -14,6 +21,22 @@ void printControls();
 // Global GLFW window
 extern struct Window window;
 
+#define DEFAULT_CHECKPOINT_GENERATIONS 10000
+
+// Long options have no short form, their values follow the chars
+enum LongOption {
+    OptionCheckpoint = 256,
+    OptionCheckpointEvery,
+    OptionResume
+};
+
+static const struct option long_options[] = {
+    {"checkpoint", required_argument, NULL, OptionCheckpoint},
+    {"checkpoint-every", required_argument, NULL, OptionCheckpointEvery},
+    {"resume", no_argument, NULL, OptionResume},
+    {NULL, 0, NULL, 0}
+};
+
 int main(int argc, char *argv[]) {
 
     int load_file = 0;
@@ -21,9 +44,26 @@ int main(int argc, char *argv[]) {
     int save_file = 0;
     char save_file_path[256];
     enum ColorScheme color_scheme = Terminal;
+    enum WorldEngine engine = EngineDense;
+    int num_threads = 0; // 0 = one per processor
+    int pin_threads = 0;
+    const char *rule = NULL;
+    enum WorldTopology topology = TopologyUnbounded;
+    unsigned int topology_cols = 0; // 0 = size of the loaded world
+    unsigned int topology_rows = 0;
+    int headless = 0;
+    uint64_t generations = 0;
+    int stop_on_period = 0;
+    int tile_generations = -1; // -1 = world default
+    int tile_file = 0;
+    char tile_file_path[256];
+    int rewind_generations = -1; // -1 = world default
+    const char *checkpoint_file_path = NULL;
+    uint64_t checkpoint_generations = DEFAULT_CHECKPOINT_GENERATIONS;
+    int resume = 0;
 
     int opt;
-    while ((opt = getopt(argc, argv, "l:s:c:")) != -1) {
+    while ((opt = getopt_long(argc, argv, "l:s:c:e:t:ar:b:n:pk:m:w:", long_options, NULL)) != -1) {
         switch (opt) {
             case 'l':
                 load_file = 1;
@@ -41,6 +81,105 @@ int main(int argc, char *argv[]) {
                 else if (strcmp(optarg, "grayscale") == 0)
                     color_scheme = Grayscale;
 
+                break;
+            case 'e':
+                if (strcmp(optarg, "dense") == 0) {
+                    engine = EngineDense;
+                } else if (strcmp(optarg, "bitpacked") == 0) {
+                    engine = EngineBitPacked;
+                } else if (strcmp(optarg, "hashlife") == 0) {
+                    engine = EngineHashLife;
+                } else if (strcmp(optarg, "sparse") == 0) {
+                    engine = EngineSparse;
+                } else if (strcmp(optarg, "lookup") == 0) {
+                    engine = EngineLookupTable;
+                } else {
+                    fprintf(stderr, "Unrecognised engine %s\n", optarg);
+                    printUsage();
+                    return 1;
+                }
+                break;
+            case 't':
+                num_threads = atoi(optarg);
+                if (num_threads < 1) {
+                    fprintf(stderr, "Thread count must be at least 1\n");
+                    printUsage();
+                    return 1;
+                }
+                break;
+            case 'a':
+                pin_threads = 1;
+                break;
+            case 'r':
+                rule = optarg;
+                break;
+            case 'b':
+                if (strncmp(optarg, "torus", 5) == 0 && (optarg[5] == '\0' || optarg[5] == ':')) {
+                    topology = TopologyTorus;
+                } else if (strncmp(optarg, "bounded", 7) == 0 && (optarg[7] == '\0' || optarg[7] == ':')) {
+                    topology = TopologyBounded;
+                } else if (strcmp(optarg, "unbounded") != 0) {
+                    fprintf(stderr, "Unrecognised topology %s\n", optarg);
+                    printUsage();
+                    return 1;
+                }
+
+                // Optional size, e.g. torus:256x128
+                const char *size = strchr(optarg, ':');
+                if (size && sscanf(size + 1, "%ux%u", &topology_cols, &topology_rows) != 2) {
+                    fprintf(stderr, "Expected a size of COLSxROWS in %s\n", optarg);
+                    printUsage();
+                    return 1;
+                }
+                break;
+            case 'n':
+                headless = 1;
+                if (sscanf(optarg, "%" SCNu64, &generations) != 1) {
+                    fprintf(stderr, "Expected a generation count, got %s\n", optarg);
+                    printUsage();
+                    return 1;
+                }
+                break;
+            case 'p':
+                stop_on_period = 1;
+                break;
+            case 'k':
+                tile_generations = atoi(optarg);
+                if (tile_generations < 1) {
+                    fprintf(stderr, "Generations per tile must be at least 1\n");
+                    printUsage();
+                    return 1;
+                }
+                break;
+            case 'm':
+                tile_file = 1;
+                headless = 1;
+                strcpy(tile_file_path, optarg);
+                break;
+            case 'w':
+                rewind_generations = atoi(optarg);
+                if (rewind_generations < 0) {
+                    fprintf(stderr, "Generations to rewind must be at least 0\n");
+                    printUsage();
+                    return 1;
+                }
+                break;
+            case OptionCheckpoint:
+                if (strlen(optarg) >= CHECKPOINT_MAX_PATH) {
+                    fprintf(stderr, "Checkpoint file path is too long\n");
+                    return 1;
+                }
+                checkpoint_file_path = optarg;
+                break;
+            case OptionCheckpointEvery:
+                if (sscanf(optarg, "%" SCNu64, &checkpoint_generations) != 1 || checkpoint_generations < 1) {
+                    fprintf(stderr, "Expected a generation count of at least 1, got %s\n", optarg);
+                    printUsage();
+                    return 1;
+                }
+                break;
+            case OptionResume:
+                resume = 1;
                 break;
             case ':':
                 fprintf(stderr, "Option needs a value\n");
@@ -54,28 +193,99 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // Checkpoints are for long runs without a window, the tile file of -m
+    // already holds the state of the run
+    if (checkpoint_file_path && (!headless || tile_file)) {
+        fprintf(stderr, "Checkpoints are written by headless runs with -n and without -m\n");
+        printUsage();
+        return 1;
+    }
+    if (resume && !checkpoint_file_path) {
+        fprintf(stderr, "--resume needs the --checkpoint file to resume from\n");
+        printUsage();
+        return 1;
+    }
+
     struct Renderer *renderer = NULL;
     struct World *world = NULL;
-    if (!init(&renderer, &world, color_scheme)) {
+    if (!init(&renderer, &world, color_scheme, headless)) {
+        cleanup(renderer, world);
+        return 1;
+    }
+    world->engine = engine;
+    world->detect_period = stop_on_period;
+    if (tile_generations > 0)
+        world->tile_generations = tile_generations;
+    if (rewind_generations >= 0)
+        world->rewind_generations = rewind_generations;
+    if (num_threads == 0)
+        num_threads = (int) threadPoolDefaultThreads();
+    if (!worldSetThreads(world, num_threads)) {
+        cleanup(renderer, world);
+        return 1;
+    }
+    if (pin_threads && !worldSetPlacement(world, 1, 1)) {
         cleanup(renderer, world);
         return 1;
     }
-    
 
-    if (load_file && !worldLoadFromFile(world, load_file_path)) {
+    // A resumed run carries on from its checkpoint, with the rule and
+    // topology it was started with. Without a valid checkpoint it starts
+    // from the world file, as on the first run.
+    int resumed = resume && checkpointResume(world, checkpoint_file_path);
+    if (resume && !resumed) {
+        fprintf(stderr, "No valid checkpoint in %s, ", checkpoint_file_path);
+        if (!load_file) {
+            fprintf(stderr, "and no world file to start from\n");
+            cleanup(renderer, world);
+            return 1;
+        }
+        fprintf(stderr, "starting from %s\n", load_file_path);
+    }
+
+    if (!resumed && load_file && !worldLoadFromFile(world, load_file_path)) {
         fprintf(stderr, "Failed to load world file %s\n", load_file_path);
         cleanup(renderer, world);
         return 1;
     }
-    rendererRecenter(renderer, world);
-    if (!rendererGrowWorldToFillView(renderer, world)) {
+    // The rule given on the command line overrides the rule in the file
+    if (!resumed && rule && !worldSetRule(world, rule)) {
+        cleanup(renderer, world);
+        return 1;
+    }
+    if (!resumed && topology != TopologyUnbounded &&
+        !worldSetTopology(world, topology, topology_cols, topology_rows)) {
         cleanup(renderer, world);
         return 1;
     }
-    printControls();
 
-    // Main Loop
-    windowLoop(renderer, world);
+    if (tile_file) {
+        int ran = runMapped(world, tile_file_path, load_file, rule != NULL, generations);
+        cleanup(renderer, world);
+        return ran ? 0 : 1;
+    } else if (headless) {
+        struct Checkpointer *checkpointer = NULL;
+        if (checkpoint_file_path) {
+            checkpointer = checkpointerCreate(checkpoint_file_path);
+            if (!checkpointer) {
+                cleanup(renderer, world);
+                return 1;
+            }
+        }
+
+        int ran = runHeadless(world, generations, checkpointer, checkpoint_generations);
+        checkpointerDestroy(checkpointer);
+        if (!ran) {
+            cleanup(renderer, world);
+            return 1;
+        }
+    } else {
+        rendererRecenter(renderer, world);
+        printControls();
+
+        // Main Loop
+        windowLoop(renderer, world);
+    }
 
     if (save_file)
         worldSaveToFile(world, save_file_path);
@@ -85,17 +295,20 @@ int main(int argc, char *argv[]) {
     return 0;
 }
 
-int init(struct Renderer **renderer, struct World **world, enum ColorScheme color_scheme) {
+int init(struct Renderer **renderer, struct World **world, enum ColorScheme color_scheme, int headless) {
 
-    if (!windowInit()) {
-        fprintf(stderr, "Failed to setup window.\n");
-        return 0;
-    }
+    // Headless runs only need the world
+    if (!headless) {
+        if (!windowInit()) {
+            fprintf(stderr, "Failed to setup window.\n");
+            return 0;
+        }
 
-    *renderer = rendererCreate(color_scheme);
-    if (!(*renderer)) {
-        fprintf(stderr, "Failed to create the renderer.\n");
-        return 0;
+        *renderer = rendererCreate(color_scheme);
+        if (!(*renderer)) {
+            fprintf(stderr, "Failed to create the renderer.\n");
+            return 0;
+        }
     }
 
     *world = worldCreate(color_scheme);
@@ -107,6 +320,96 @@ int init(struct Renderer **renderer, struct World **world, enum ColorScheme colo
     return 1;
 }
 
+/// Runs the world without a window up to the given generation, stopping
+/// early at the first repeat when -p is given, and reports the final state.
+/// With a checkpointer the world is checkpointed every
+/// checkpoint_generations generations and at the end, written in the
+/// background while the run carries on.
+int runHeadless(struct World *world, uint64_t generations, struct Checkpointer *checkpointer,
+                uint64_t checkpoint_generations) {
+    while (world->generation < generations) {
+        uint64_t batch = generations - world->generation;
+        uint64_t to_checkpoint = checkpoint_generations - world->generation % checkpoint_generations;
+        if (checkpointer && batch > to_checkpoint)
+            batch = to_checkpoint;
+
+        if (!worldStep(world, batch)) {
+            fprintf(stderr, "Failed to advance the world.\n");
+            return 0;
+        }
+        if (checkpointer && !checkpointerSubmit(checkpointer, world))
+            fprintf(stderr, "Failed to copy the world for a checkpoint, the run carries on.\n");
+
+        // With -p the world stops at the first repeat
+        struct WorldPeriod period;
+        if (worldPeriod(world, &period))
+            break;
+    }
+
+    fprintf(stderr, "Generation %" PRIu64 ", population %" PRIu64 "\n",
+            world->generation, worldPopulation(world));
+
+    int min_x, min_y, max_x, max_y;
+    if (worldLiveBounds(world, &min_x, &min_y, &max_x, &max_y))
+        fprintf(stderr, "Live cells from (%d, %d) to (%d, %d)\n", min_x, min_y, max_x, max_y);
+
+    struct WorldPeriod period;
+    if (worldPeriod(world, &period))
+        fprintf(stderr, "Period %" PRIu64 " moving (%d, %d) since generation %" PRIu64 "\n",
+                period.period, period.dx, period.dy, period.since);
+
+    // Shows whether the bands ended up on the nodes of their threads
+    struct NumaPages pages;
+    int banded = world->engine != EngineHashLife && world->engine != EngineSparse;
+    if (banded && world->first_touch && worldCountPages(world, &pages))
+        numaPrintPages(&pages, "Cells");
+
+    return 1;
+}
+
+/// Runs the given number of generations on sparse tiles kept in a memory
+/// mapped tile file, for worlds too large for memory. The loaded world, if
+/// any, replaces the tiles in the file, otherwise the run carries on from
+/// the generation the file was left at. The file is the saved state.
+int runMapped(struct World *world, const char *tile_file_path, int load_file, int set_rule, uint64_t generations) {
+    struct TileMap *tiles = tileMapCreateMapped(tile_file_path);
+    if (!tiles) {
+        fprintf(stderr, "Failed to open tile file %s\n", tile_file_path);
+        return 0;
+    }
+
+    if (load_file) {
+        if (!worldSyncCells(world) || !tileMapSetCells(tiles, world->cells, world->rows, world->cols, world->stride,
+                             world->tl_cell_pos_x, world->tl_cell_pos_y)) {
+            tileMapDestroy(tiles);
+            return 0;
+        }
+        tiles->generation = 0;
+    }
+    if (load_file || set_rule)
+        tiles->rule = world->rule;
+
+    for (uint64_t i = 0; i < generations; ++i) {
+        if (!tileMapStep(tiles, world->pool)) {
+            fprintf(stderr, "Failed to advance the tiles.\n");
+            tileMapDestroy(tiles);
+            return 0;
+        }
+    }
+
+    fprintf(stderr, "Generation %" PRIu64 ", population %" PRIu64 " in %u tiles\n",
+            tiles->generation, tileMapPopulation(tiles), tiles->num_tiles);
+
+    int64_t min_x, min_y, max_x, max_y;
+    if (tileMapBounds(tiles, &min_x, &min_y, &max_x, &max_y))
+        fprintf(stderr, "Live cells from (%" PRId64 ", %" PRId64 ") to (%" PRId64 ", %" PRId64 ")\n",
+                min_x, min_y, max_x, max_y);
+
+    int synced = tileMapSync(tiles);
+    tileMapDestroy(tiles);
+    return synced;
+}
+
 void cleanup(struct Renderer *renderer, struct World *world) {
     worldDestroy(world);
     rendererDestroy(renderer);
@@ -114,7 +417,7 @@ void cleanup(struct Renderer *renderer, struct World *world) {
 }
 
 void printUsage() {
-    fprintf(stderr, "./game_of_life -l load_file_path -s save_file_path -c [terminal, light, grayscale]");
+    fprintf(stderr, "./game_of_life -l load_file_path -s save_file_path -c [terminal, light, grayscale] -e [dense, bitpacked, hashlife, sparse, lookup] -t threads -a -r rule -b [unbounded, torus[:COLSxROWS], bounded[:COLSxROWS]] -n generations -p -k tile_generations -m tile_file -w rewind_generations --checkpoint checkpoint_file --checkpoint-every generations --resume\n");
 }
 
 void printControls() {
@@ -124,4 +427,5 @@ void printControls() {
     fprintf(stderr, "  Edit cell = left mouse when in edit mode\n");
     fprintf(stderr, "  Speed up  = shift + w or shift + up arrow\n");
     fprintf(stderr, "  Slow down = shift + s or shift + down arrow\n");
+    fprintf(stderr, "  Rewind    = r, or shift + r for 64 generations\n");
 }
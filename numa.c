@@ -0,0 +1,80 @@
+#include "numa.h"
+
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Pages asked about per move_pages call
+#define NUMA_QUERY_PAGES 1024
+
+/// Number of NUMA nodes, one more than the highest online node, or 1 if it
+/// cannot be determined.
+unsigned int numaNodeCount() {
+    FILE *file = fopen("/sys/devices/system/node/online", "r");
+    if (!file)
+        return 1;
+
+    // A list of ranges such as 0-1,4
+    unsigned int num_nodes = 1;
+    unsigned int node;
+    while (fscanf(file, "%u", &node) == 1) {
+        if (node + 1 > num_nodes)
+            num_nodes = node + 1;
+        if (fgetc(file) == EOF)
+            break;
+    }
+    fclose(file);
+    return num_nodes < NUMA_MAX_NODES ? num_nodes : NUMA_MAX_NODES;
+}
+
+void numaResetPages(struct NumaPages *self) {
+    memset(self->pages, 0, sizeof(self->pages));
+    self->num_nodes = numaNodeCount();
+    self->untouched = 0;
+}
+
+/// Adds the pages of [addr, addr + bytes) to the count of the node each is
+/// on, asking the kernel with move_pages without moving them. Returns 0 if
+/// the kernel cannot say.
+int numaCountPages(struct NumaPages *self, const void *addr, size_t bytes) {
+    if (!addr || bytes == 0)
+        return 1;
+
+    size_t page_size = (size_t) sysconf(_SC_PAGESIZE);
+    uintptr_t begin = (uintptr_t) addr / page_size * page_size;
+    uintptr_t end = (uintptr_t) addr + bytes;
+
+    void *pages[NUMA_QUERY_PAGES];
+    int status[NUMA_QUERY_PAGES];
+    while (begin < end) {
+        unsigned long count = 0;
+        for (; count < NUMA_QUERY_PAGES && begin < end; ++count, begin += page_size)
+            pages[count] = (void *) begin;
+
+        if (syscall(SYS_move_pages, 0, count, pages, NULL, status, 0) != 0) {
+            fprintf(stderr, "numa::numaCountPages: Error! Failed to find the nodes of pages, %s.\n",
+                    strerror(errno));
+            return 0;
+        }
+
+        for (unsigned long i = 0; i < count; ++i) {
+            if (status[i] >= 0 && status[i] < (int) self->num_nodes)
+                ++self->pages[status[i]];
+            else
+                ++self->untouched;
+        }
+    }
+    return 1;
+}
+
+/// Prints the memory on each node, e.g. for the cells of a world.
+void numaPrintPages(const struct NumaPages *self, const char *name) {
+    double page_mb = (double) sysconf(_SC_PAGESIZE) / (1024.0 * 1024.0);
+    fprintf(stderr, "%s:", name);
+    for (unsigned int i = 0; i < self->num_nodes; ++i)
+        fprintf(stderr, "%s node %u %.1f MB", i ? "," : "", i, self->pages[i] * page_mb);
+    fprintf(stderr, ", not touched %.1f MB\n", self->untouched * page_mb);
+}
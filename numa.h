@@ -0,0 +1,23 @@
+#ifndef __GAME_OF_LIFE_NUMA_H__
+#define __GAME_OF_LIFE_NUMA_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define NUMA_MAX_NODES 64
+
+/// Pages of a range of memory counted by the NUMA node they are on.
+struct NumaPages {
+    uint64_t pages[NUMA_MAX_NODES];
+    unsigned int num_nodes;
+
+    // Pages not touched yet, so not on any node
+    uint64_t untouched;
+};
+
+unsigned int numaNodeCount();
+void numaResetPages(struct NumaPages *self);
+int numaCountPages(struct NumaPages *self, const void *addr, size_t bytes);
+void numaPrintPages(const struct NumaPages *self, const char *name);
+
+#endif // __GAME_OF_LIFE_NUMA_H__
@@ -0,0 +1,115 @@
+#include "render_thread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static void *renderThreadMain(void *arg) {
+    struct RenderThread *self = arg;
+    glfwMakeContextCurrent(self->handle);
+
+    pthread_mutex_lock(&self->lock);
+    while (1) {
+        int ready = self->states[0] == FrameReady ? 0 : self->states[1] == FrameReady ? 1 : -1;
+        if (self->stop)
+            break;
+        if (ready < 0) {
+            pthread_cond_wait(&self->frame_ready, &self->lock);
+            continue;
+        }
+
+        self->states[ready] = FrameDrawing;
+        pthread_mutex_unlock(&self->lock);
+
+        rendererDrawFrame(self->renderer, &self->frames[ready]);
+        glfwSwapBuffers(self->handle);
+
+        pthread_mutex_lock(&self->lock);
+        self->states[ready] = FrameFree;
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    // The context goes back to the thread that created the renderer
+    glfwMakeContextCurrent(NULL);
+    return NULL;
+}
+
+/// Moves the GL context, which must be current on the calling thread, to a
+/// new render thread.
+struct RenderThread *renderThreadCreate(struct Renderer *renderer, GLFWwindow *handle) {
+
+    struct RenderThread *self = malloc(sizeof(struct RenderThread));
+    if (!self) {
+        fprintf(stderr, "Failed to allocate memory for the render thread.\n");
+        return NULL;
+    }
+
+    self->renderer = renderer;
+    self->handle = handle;
+    for (int i = 0; i < 2; ++i) {
+        self->frames[i].cells = NULL;
+        self->frames[i].num_cells = 0;
+        self->frames[i].capacity = 0;
+        self->states[i] = FrameFree;
+    }
+    self->stop = 0;
+    pthread_mutex_init(&self->lock, NULL);
+    pthread_cond_init(&self->frame_ready, NULL);
+
+    glfwMakeContextCurrent(NULL);
+    if (pthread_create(&self->thread, NULL, renderThreadMain, self) != 0) {
+        fprintf(stderr, "render_thread::renderThreadCreate: Error! Failed to create the render thread.\n");
+        glfwMakeContextCurrent(handle);
+        pthread_cond_destroy(&self->frame_ready);
+        pthread_mutex_destroy(&self->lock);
+        free(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+/// Stops the thread once the frame it is drawing is presented, and makes
+/// the GL context current on the calling thread again.
+void renderThreadDestroy(struct RenderThread *self) {
+    if (!self)
+        return;
+
+    pthread_mutex_lock(&self->lock);
+    self->stop = 1;
+    pthread_cond_broadcast(&self->frame_ready);
+    pthread_mutex_unlock(&self->lock);
+    pthread_join(self->thread, NULL);
+    glfwMakeContextCurrent(self->handle);
+
+    pthread_cond_destroy(&self->frame_ready);
+    pthread_mutex_destroy(&self->lock);
+    free(self->frames[0].cells);
+    free(self->frames[1].cells);
+    free(self);
+}
+
+/// Returns a frame to build the next frame in, or NULL if the render
+/// thread is drawing one frame and the other is still waiting to be drawn.
+/// Never waits for the render thread.
+struct RenderFrame *renderThreadBeginFrame(struct RenderThread *self) {
+    struct RenderFrame *frame = NULL;
+    pthread_mutex_lock(&self->lock);
+    for (int i = 0; i < 2 && !frame; ++i) {
+        if (self->states[i] == FrameFree)
+            frame = &self->frames[i];
+    }
+    pthread_mutex_unlock(&self->lock);
+    return frame;
+}
+
+/// Hands a built frame to the render thread. A frame built before it and
+/// not yet drawn is dropped.
+void renderThreadSubmitFrame(struct RenderThread *self, struct RenderFrame *frame) {
+    int index = frame == &self->frames[0] ? 0 : 1;
+    pthread_mutex_lock(&self->lock);
+    if (self->states[1 - index] == FrameReady)
+        self->states[1 - index] = FrameFree;
+    self->states[index] = FrameReady;
+    pthread_cond_signal(&self->frame_ready);
+    pthread_mutex_unlock(&self->lock);
+}
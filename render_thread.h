@@ -0,0 +1,38 @@
+#ifndef __GAME_OF_LIFE_RENDER_THREAD_H__
+#define __GAME_OF_LIFE_RENDER_THREAD_H__
+
+#include "renderer.h"
+
+#include <pthread.h>
+
+/// State of one of the two frames of a RenderThread.
+enum RenderFrameState {
+    FrameFree = 0,  // May be built by the thread handling input.
+    FrameReady,     // Built and waiting to be drawn.
+    FrameDrawing    // Being drawn by the render thread.
+};
+
+/// Thread that owns the GL context and draws the frames built by another
+/// thread. The two frames are used in turn, so the next frame is built
+/// while the render thread uploads, draws and presents the last one.
+struct RenderThread {
+
+    struct Renderer *renderer;
+    GLFWwindow *handle;
+    pthread_t thread;
+
+    // Guards the frame states and stop
+    pthread_mutex_t lock;
+    pthread_cond_t frame_ready;
+
+    struct RenderFrame frames[2];
+    enum RenderFrameState states[2];
+    int stop;
+};
+
+struct RenderThread *renderThreadCreate(struct Renderer *renderer, GLFWwindow *handle);
+void renderThreadDestroy(struct RenderThread *self);
+struct RenderFrame *renderThreadBeginFrame(struct RenderThread *self);
+void renderThreadSubmitFrame(struct RenderThread *self, struct RenderFrame *frame);
+
+#endif // __GAME_OF_LIFE_RENDER_THREAD_H__
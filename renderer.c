@@ -10,6 +10,9 @@
 #define MAX_SHADER_LEN 4096
 #define CELL_SPACING 1.0f
 
+// Generations shift + r rewinds
+#define REWIND_LONG_STEP 64
+
 // Global GLFW window
 extern struct Window window;
 
@@ -39,6 +42,8 @@ static int createTransforms(struct Renderer *self) {
     self->model_matrix_id = glGetUniformLocation(self->program_id, "m");
     self->view_matrix_id = glGetUniformLocation(self->program_id, "v");
     self->projection_matrix_id = glGetUniformLocation(self->program_id, "p");
+    self->alive_color_id = glGetUniformLocation(self->program_id, "alive_color");
+    self->dead_color_id = glGetUniformLocation(self->program_id, "dead_color");
 
     float model_matrix[16];
     identityMatrix(model_matrix);
@@ -126,25 +131,19 @@ static void createVertices(struct Renderer *self, enum ColorScheme cs) {
     float alive_g[] = {0.510f, 0.004f, 0.7};
     float alive_b[] = {0.000f, 0.882f, 0.7};
 
-
-    // One color per vertex.
-    float alive_cell_color[] = {
-        alive_r[cs], alive_g[cs], alive_b[cs],
-        alive_r[cs], alive_g[cs], alive_b[cs],
-        alive_r[cs], alive_g[cs], alive_b[cs],
-        alive_r[cs], alive_g[cs], alive_b[cs]
-    };
-
     float dead_r[] = {0.200f, 0.941f, 0.180f};
     float dead_g[] = {0.200f, 0.914f, 0.180f};
     float dead_b[] = {0.200f, 0.867f, 0.180f};
 
-    float dead_cell_color[] = {
-        dead_r[cs], dead_g[cs], dead_b[cs],
-        dead_r[cs], dead_g[cs], dead_b[cs],
-        dead_r[cs], dead_g[cs], dead_b[cs],
-        dead_r[cs], dead_g[cs], dead_b[cs]
-    };
+    // The cells pick their color from these by state
+    self->alive_color[0] = alive_r[cs];
+    self->alive_color[1] = alive_g[cs];
+    self->alive_color[2] = alive_b[cs];
+    self->dead_color[0] = dead_r[cs];
+    self->dead_color[1] = dead_g[cs];
+    self->dead_color[2] = dead_b[cs];
+    glUniform3fv(self->alive_color_id, 1, self->alive_color);
+    glUniform3fv(self->dead_color_id, 1, self->dead_color);
 
     // A little unecessary for a 2D cell since no vertices are shared.
     unsigned int cell_indices[] = {
@@ -152,7 +151,7 @@ static void createVertices(struct Renderer *self, enum ColorScheme cs) {
         1, 3, 2,
     };
 
-    self->num_vertices = sizeof(cell_vertices) / sizeof(float);
+    self->num_indices = sizeof(cell_indices) / sizeof(unsigned int);
 
     glGenVertexArrays(1, &self->vao);
     glBindVertexArray(self->vao);
@@ -160,18 +159,20 @@ static void createVertices(struct Renderer *self, enum ColorScheme cs) {
     glGenBuffers(1, &self->vbo); 
     glBindBuffer(GL_ARRAY_BUFFER, self->vbo); 
     glBufferData(GL_ARRAY_BUFFER, sizeof(cell_vertices), cell_vertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
     glGenBuffers(1, &self->ibo);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self->ibo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cell_indices), cell_indices, GL_STATIC_DRAW); 
 
-    glGenBuffers(1, &self->cbo_alive);
-    glBindBuffer(GL_ARRAY_BUFFER, self->cbo_alive);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(alive_cell_color), alive_cell_color, GL_STATIC_DRAW); // could make this a dynamic draw if I want to change the color of the cells??
-    
-    glGenBuffers(1, &self->cbo_dead);
-    glBindBuffer(GL_ARRAY_BUFFER, self->cbo_dead);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(dead_cell_color), dead_cell_color, GL_STATIC_DRAW);
+    // Every visible cell is an instance of the square, placed and colored
+    // by its x, y and state
+    glGenBuffers(1, &self->cells_bo);
+    glBindBuffer(GL_ARRAY_BUFFER, self->cells_bo);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+    glVertexAttribDivisor(1, 1);
 }
 
 struct Renderer *rendererCreate(enum ColorScheme cs) {
@@ -204,6 +205,8 @@ struct Renderer *rendererCreate(enum ColorScheme cs) {
     }
 
     createVertices(self, cs);
+    self->viewport_x = window.size_x;
+    self->viewport_y = window.size_y;
 
     return self;
 }
@@ -241,42 +244,17 @@ void rendererRecenter(struct Renderer *self, struct World *world) {
     if (!self || !world)
         return;
 
-    // Init min and max to their opposites.
-    float cell_spacing = CELL_SPACING;
-    float max_x = (world->tl_cell_pos_x - 0.5f) * cell_spacing;
-    float max_y = (-world->tl_cell_pos_y - 0.5f) * cell_spacing;
-    float min_x = (world->cols + world->tl_cell_pos_x + 0.5f) * cell_spacing;
-    float min_y = (-world->rows - world->tl_cell_pos_y + 0.5f) * cell_spacing;
-
-    int no_cells_are_live = 1;
-    for (int r = 0; r < world->rows; ++r) {
-        for (int c = 0; c < world->cols; ++c) {
-            unsigned char *cell = worldCell(world, c, r);
-            if (!cell) {
-                fprintf(stderr, "renderer::rendererRecenter: Cell c=%d, r=%d invalid.\n", c, r);
-                continue;
-            }
-
-            if (*cell) {
-                no_cells_are_live = 0;
-
-                float x = ((int) c + world->tl_cell_pos_x) * cell_spacing;
-                float y = -((int) r + world->tl_cell_pos_y) * cell_spacing;
-                if (x - 0.5f*cell_spacing < min_x)
-                    min_x = x - 0.5f*cell_spacing;
-                if (x + 0.5f*cell_spacing > max_x)
-                    max_x = x + 0.5f*cell_spacing;
-                if (y - 0.5f*cell_spacing < min_y)
-                    min_y = y - 0.5f*cell_spacing;
-                if (y + 0.5f*cell_spacing > max_y)
-                    max_y = y + 0.5f*cell_spacing;
-            }
-        }
-    }
-
-    if (no_cells_are_live)
+    int min_c, min_r, max_c, max_r;
+    if (!worldLiveBounds(world, &min_c, &min_r, &max_c, &max_r))
         return;
 
+    // Edges of the squares of the live cells, world rows run down the view
+    float cell_spacing = CELL_SPACING;
+    float min_x = (min_c - 0.5f) * cell_spacing;
+    float max_x = (max_c + 0.5f) * cell_spacing;
+    float min_y = (-max_r - 0.5f) * cell_spacing;
+    float max_y = (-min_r + 0.5f) * cell_spacing;
+
     // Set the zoom and eye position so that all occupied squares are visible
     self->eye[0] = (max_x + min_x) * 0.5f;
     self->eye[1] = (max_y + min_y) * 0.5f;
@@ -289,7 +267,8 @@ void rendererRecenter(struct Renderer *self, struct World *world) {
     setWindowZoom(0.5f*zoom);
 }
 
-int rendererGrowWorldToFillView(struct Renderer *self, struct World *world) {
+/// Range of cells, in world coords, that may be visible in the view.
+static void visibleCells(struct Renderer *self, int *min_c, int *min_r, int *max_c, int *max_r) {
 
     float aspect = ((float) window.size_x) / window.size_y;
     float top = 2.0f * windowZoom();
@@ -301,94 +280,10 @@ int rendererGrowWorldToFillView(struct Renderer *self, struct World *world) {
     float min_y = self->eye[1] - top;
 
     float cell_spacing_inv = 1.0f / CELL_SPACING;
-    int visible_tl_cell_pos_x = min_x * cell_spacing_inv;
-    int visible_tl_cell_pos_y = -max_y * cell_spacing_inv;
-    int visible_br_cell_pos_x = (int) max_x * cell_spacing_inv + 1;
-    int visible_br_cell_pos_y = (int) -min_y * cell_spacing_inv + 1;
-
-    float block_cols_inv = 1.0f / world->block_cols;
-    float block_rows_inv = 1.0f / world->block_rows;
-    float grow_left = ((float) world->tl_cell_pos_x - visible_tl_cell_pos_x) * block_cols_inv;
-    float grow_right = ((float) visible_br_cell_pos_x - world->tl_cell_pos_x - world->cols) * block_cols_inv;
-    float grow_top = ((float) world->tl_cell_pos_y - visible_tl_cell_pos_y) * block_rows_inv;
-    float grow_bottom = ((float) visible_br_cell_pos_y - world->tl_cell_pos_y - world->rows) * block_rows_inv;
-
-
-    grow_left = ceil(grow_left);
-    grow_right = ceil(grow_right);
-    grow_top = ceil(grow_top);
-    grow_bottom = ceil(grow_bottom);
-    
-    grow_left = max(grow_left, 0.0f);
-    grow_right = max(grow_right, 0.0f);
-    grow_top = max(grow_top, 0.0f);
-    grow_bottom = max(grow_bottom, 0.0f);
-
-    if (grow_left > 0 || grow_right > 0 || grow_top > 0 || grow_bottom > 0) {
-
-        int prev_tl_cell_pos_x = world->tl_cell_pos_x;
-        int prev_tl_cell_pos_y = world->tl_cell_pos_y;
-        
-        // Backup the existing state of the cells
-        for (int r = 0; r < world->cn_rows; ++r) {
-            for (int c = 0; c < world->cn_cols; ++c) {
-                unsigned char *cell = worldCell(world, c, r);
-                unsigned char *cell_next = worldCellNext(world, c, r);
-                *cell_next = *cell;
-                *cell = 0;
-            }
-        }
-
-        if (!worldIncreaseCells(world, grow_top, grow_bottom, grow_left, grow_right))
-            return 0;
-
-        // TODO: reduce code repeition with world update
-        // Copy the next cells to the current cells
-        int col_offset = prev_tl_cell_pos_x - world->tl_cell_pos_x;
-        int row_offset = prev_tl_cell_pos_y - world->tl_cell_pos_y;
-
-        for (int r = 0; r < world->cn_rows; ++r) {
-            for (int c = 0; c < world->cn_cols; ++c) {
-                unsigned char *cell = worldCell(world, c + col_offset, r + row_offset);
-                unsigned char *cell_next = worldCellNext(world, c, r);
-                *cell = *cell_next;
-                *cell_next = 0;
-            }
-        }
-
-        if (!worldIncreaseCellsNext(world))
-            return 0;
-    }
-
-    return 1;
-}
-
-// is_alive = when true, cells are rendered solid.
-static void renderCell(struct Renderer *self, float pos[3], int is_alive) {
-    float model_matrix[16];
-    translation(pos[0], pos[1], pos[2], model_matrix);
-    transpose(model_matrix);
-
-    glUniformMatrix4fv(self->model_matrix_id, 1, GL_FALSE, model_matrix);
-
-    GLuint vs_layout_specifier = 0;
-    glEnableVertexAttribArray(vs_layout_specifier);
-    glBindBuffer(GL_ARRAY_BUFFER, self->vbo);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self->ibo);
-    glVertexAttribPointer(vs_layout_specifier, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-
-    vs_layout_specifier = 1;
-    glEnableVertexAttribArray(vs_layout_specifier);
-    if (is_alive)
-        glBindBuffer(GL_ARRAY_BUFFER, self->cbo_alive);
-    else
-        glBindBuffer(GL_ARRAY_BUFFER, self->cbo_dead);
-    glVertexAttribPointer(vs_layout_specifier, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
-    glDrawElements(GL_TRIANGLES, self->num_vertices, GL_UNSIGNED_INT, (void*)0);
-
-    glDisableVertexAttribArray(1);
-    glDisableVertexAttribArray(0);
-
+    *min_c = (int) floor(min_x * cell_spacing_inv);
+    *min_r = (int) floor(-max_y * cell_spacing_inv);
+    *max_c = (int) ceil(max_x * cell_spacing_inv);
+    *max_r = (int) ceil(-min_y * cell_spacing_inv);
 }
 
 static void handleMoveCommands(struct Renderer *self) {
@@ -419,7 +314,7 @@ static void handleMoveCommands(struct Renderer *self) {
     }
 }
 
-static void handleWorldCommands(struct World *world) {
+static int handleWorldCommands(struct World *world, struct RewindRing *rewind) {
 
     // Speedup/slowdown world updates
     if ((window.keyboard.keys[GLFW_KEY_LEFT_SHIFT].pressed || window.keyboard.keys[GLFW_KEY_RIGHT_SHIFT].pressed)) {
@@ -452,82 +347,155 @@ static void handleWorldCommands(struct World *world) {
         window.keyboard.keys[GLFW_KEY_E].held = 1;
     }
 
+    // Rewind, and pause in edit mode so the world stays at the generation
+    // rewound to
+    int rewound = 0;
+    if (rewind && window.keyboard.keys[GLFW_KEY_R].pressed && !window.keyboard.keys[GLFW_KEY_R].held) {
+        uint64_t back = window.keyboard.keys[GLFW_KEY_LEFT_SHIFT].pressed ||
+                        window.keyboard.keys[GLFW_KEY_RIGHT_SHIFT].pressed ? REWIND_LONG_STEP : 1;
+        if (world->generation > 0 &&
+            rewindRingSeek(rewind, world, world->generation > back ? world->generation - back : 0)) {
+            world->updates_paused = 1;
+            world->edit_mode = 1;
+            rewound = 1;
+        }
 
+        window.keyboard.keys[GLFW_KEY_R].held = 1;
+    }
+
+    return rewound;
 }
 
-static void handleEditCommands(struct World *world, float left, float right, 
+static void handleEditCommands(struct World *world, struct EditQueue *edits, float left, float right,
                                float bottom, float top, const float eye[3],
-                               float cell_spacing, const float top_left_cell[3]) {
+                               float cell_spacing) {
     
     // Edit world commands
     if (world->edit_mode && window.mouse.buttons[GLFW_MOUSE_BUTTON_LEFT].pressed &&
         !window.mouse.buttons[GLFW_MOUSE_BUTTON_LEFT].held) {
         
-        window.mouse.buttons[GLFW_MOUSE_BUTTON_LEFT].held = 1;
-
         float x = window.mouse.pos_x;
         float y = window.mouse.pos_y;
         float world_x = eye[0] + 2*(right - left)*(x/window.size_x - 0.5f);
         float world_y = eye[1] + 2*(bottom - top)*(y/window.size_y - 0.5f);
 
-        int c = round(((float) round(world_x) -     top_left_cell[0]) / cell_spacing);
-        int r = round((top_left_cell[1] - (float) round(world_y)) / cell_spacing);
+        int c = round((float) round(world_x) / cell_spacing);
+        int r = round(-(float) round(world_y) / cell_spacing);
 
-        worldToggleCell(world, c, r);        
+        // Queued for the simulation thread, a full queue is tried again
+        // next frame
+        struct WorldEdit edit = {EditToggle, c, r, 1, 1, 1, NULL, 0, 0};
+        if (editQueuePush(edits, &edit))
+            window.mouse.buttons[GLFW_MOUSE_BUTTON_LEFT].held = 1;
     }
 }
 
-void renderWorld(struct Renderer *self, struct World *world) {
-    handleMoveCommands(self);
-    handleWorldCommands(world);
-
-    // Is is possible to avoid doing this every loop, and do only when the
-    // aspect ratio changes?
-    float orthographic_matrix[16];
+/// Edges of the view around the eye.
+static void viewEdges(float *left, float *right, float *bottom, float *top) {
     float aspect = (float) window.size_x / window.size_y;
-    float aspect_inv = 1.0f / aspect;
     float zoom = windowZoom();
-    float right = aspect*zoom;
-    float left = -right;
-    float top = zoom;
-    float bottom = -top;
-    orthographicProjection(left, right, bottom, top, 0.0f, 1000.0f, orthographic_matrix);
-    glUniformMatrix4fv(self->projection_matrix_id, 1, GL_FALSE, orthographic_matrix);
+    *right = aspect*zoom;
+    *left = -*right;
+    *top = zoom;
+    *bottom = -*top;
+}
+
+/// Applies the input that changes the update rate and edit mode, or
+/// rewinds the world. The caller holds the world, see
+/// rendererWorldInputPending. Returns 1 if the world was rewound, and is to
+/// be published again.
+int rendererHandleWorldInput(struct Renderer *self, struct World *world, struct RewindRing *rewind) {
+    return handleWorldCommands(world, rewind);
+}
+
+/// Pushes the cells clicked in edit mode to the edit queue. Only reads
+/// edit_mode, which only the thread handling input changes, so the caller
+/// need not hold the world.
+void rendererHandleEditInput(struct Renderer *self, struct World *world, struct EditQueue *edits) {
+    float left, right, bottom, top;
+    viewEdges(&left, &right, &bottom, &top);
+    handleEditCommands(world, edits, left, right, bottom, top, self->eye, CELL_SPACING);
+}
+
+/// True if input is waiting that rendererHandleWorldInput would apply.
+int rendererWorldInputPending() {
+    int shift = window.keyboard.keys[GLFW_KEY_LEFT_SHIFT].pressed || window.keyboard.keys[GLFW_KEY_RIGHT_SHIFT].pressed;
+    int faster = window.keyboard.keys[GLFW_KEY_W].pressed || window.keyboard.keys[GLFW_KEY_UP].pressed;
+    int slower = window.keyboard.keys[GLFW_KEY_S].pressed || window.keyboard.keys[GLFW_KEY_DOWN].pressed;
+    int toggle_edit = (window.keyboard.keys[GLFW_KEY_E].pressed && !window.keyboard.keys[GLFW_KEY_E].held) ||
+                      (window.keyboard.keys[GLFW_KEY_SPACE].pressed && !window.keyboard.keys[GLFW_KEY_SPACE].held);
+    int rewind = window.keyboard.keys[GLFW_KEY_R].pressed && !window.keyboard.keys[GLFW_KEY_R].held;
+    return (shift && (faster || slower)) || toggle_edit || rewind;
+}
+
+/// Moves the view for the arrow keys.
+void rendererHandleViewInput(struct Renderer *self) {
+    handleMoveCommands(self);
+}
+
+/// Fills the frame with the cells of a snapshot in view, all dead if there
+/// is none yet. Makes no GL calls and reads no world state, so it runs
+/// while the world is updated and the previous frame is drawn. Returns 0 if
+/// memory for the cells ran out.
+int rendererBuildFrame(struct Renderer *self, const struct WorldSnapshot *snapshot, struct RenderFrame *frame) {
+    float left, right, bottom, top;
+    viewEdges(&left, &right, &bottom, &top);
+    orthographicProjection(left, right, bottom, top, 0.0f, 1000.0f, frame->projection_matrix);
 
-    
-    float view_matrix[16];
     float target[] = {self->eye[0], self->eye[1], 0.0f};
     float up[] = {0.0f, 1.0f, 0.0f};
-    lookDir(self->eye, target, up, view_matrix);
-    glUniformMatrix4fv(self->view_matrix_id, 1, GL_FALSE, view_matrix);
+    lookDir(self->eye, target, up, frame->view_matrix);
+    frame->size_x = window.size_x;
+    frame->size_y = window.size_y;
+
+    // Cells outside the world are dead, so the view is drawn in world coords
+    // rather than growing the world to cover it.
+    int min_c, min_r, max_c, max_r;
+    visibleCells(self, &min_c, &min_r, &max_c, &max_r);
+    size_t count = (size_t) (max_c - min_c + 1) * (max_r - min_r + 1);
+    if (count > frame->capacity) {
+        float *cells = realloc(frame->cells, sizeof(float) * 3 * count);
+        if (!cells) {
+            fprintf(stderr, "renderer::rendererBuildFrame: Error! Failed to allocate memory for %zu cells.\n", count);
+            return 0;
+        }
+        frame->cells = cells;
+        frame->capacity = (unsigned int) count;
+    }
 
     float cell_spacing = CELL_SPACING;
-    float top_left[] = {cell_spacing * (float)world->tl_cell_pos_x, 
-                        -cell_spacing * (float)world->tl_cell_pos_y, 
-                        0.0f};
-    float cell_pos[] = {0.0f, 0.0f, 0.0f};
-    handleEditCommands(world, left, right, bottom, top, self->eye, cell_spacing, top_left);
-
-    for (int r = 0; r < world->rows; ++r) {
-        for (int c = 0; c < world->cols; ++c) {
-            unsigned char *cell = worldCell(world, c, r);
-            if (!cell) {
-                fprintf(stderr, "renderer::renderWorld: No value at cell (col = %d, row = %d)\n", c, r);
-                fprintf(stderr, "    tl_cell_pos_x = %d\n", world->tl_cell_pos_x);
-                fprintf(stderr, "    tl_cell_pos_y = %d\n", world->tl_cell_pos_y);
-                fprintf(stderr, "    total rows    = %d\n", world->rows);
-                fprintf(stderr, "    total cols    = %d\n", world->cols);
-
-                return;
-            }
-            cell_pos[0] = top_left[0] + cell_spacing * c;
-            cell_pos[1] = top_left[1] - cell_spacing * r;
-            renderCell(self, cell_pos, *cell);
+    float *cell = frame->cells;
+    for (int r = min_r; r <= max_r; ++r) {
+        for (int c = min_c; c <= max_c; ++c) {
+            cell[0] = cell_spacing * c;
+            cell[1] = -cell_spacing * r;
+            cell[2] = snapshot && snapshotCellAlive(snapshot, c, r) ? 1.0f : 0.0f;
+            cell += 3;
         }
     }
+    frame->num_cells = (unsigned int) count;
+    return 1;
 }
 
-void renderClear(struct Renderer *self) {
+/// Draws a frame built by rendererBuildFrame with one instanced draw call.
+/// Must be called on the thread the GL context is current on.
+void rendererDrawFrame(struct Renderer *self, const struct RenderFrame *frame) {
+    if (frame->size_x != self->viewport_x || frame->size_y != self->viewport_y) {
+        glViewport(0, 0, frame->size_x, frame->size_y);
+        self->viewport_x = frame->size_x;
+        self->viewport_y = frame->size_y;
+    }
+
+    glUniformMatrix4fv(self->projection_matrix_id, 1, GL_FALSE, frame->projection_matrix);
+    glUniformMatrix4fv(self->view_matrix_id, 1, GL_FALSE, frame->view_matrix);
+
+    // Orphans last frame's buffer, so the upload does not wait for the GPU
+    // to finish drawing from it
+    glBindBuffer(GL_ARRAY_BUFFER, self->cells_bo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 3 * frame->num_cells, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float) * 3 * frame->num_cells, frame->cells);
 
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glBindVertexArray(self->vao);
+    glDrawElementsInstanced(GL_TRIANGLES, self->num_indices, GL_UNSIGNED_INT, (void*)0, frame->num_cells);
 }
@@ -2,6 +2,9 @@
 #define __GAME_OF_LIFE_RENDERER_H__
 
 #include "world.h"
+#include "snapshot.h"
+#include "edit_queue.h"
+#include "rewind.h"
 
 #include <glad/glad.h>  // OpenGL loading library. Must be included before glfw
 #include <GLFW/glfw3.h> // Multiplatform library for OpenGL
@@ -12,6 +15,22 @@ enum ColorScheme {
     Grayscale
 };
 
+/// Cells to draw in one frame, built on the thread handling input and
+/// drawn on the render thread, see render_thread.h.
+struct RenderFrame {
+    float view_matrix[16];
+    float projection_matrix[16];
+
+    // Size of the framebuffer the matrices were built for
+    int size_x;
+    int size_y;
+
+    // x, y and 1 if alive or 0 if dead for each visible cell
+    float *cells;
+    unsigned int num_cells;
+    unsigned int capacity;
+};
+
 struct Renderer {
    
     GLuint program_id;
@@ -19,22 +38,35 @@ struct Renderer {
     unsigned int vao;
     unsigned int vbo;
     unsigned int ibo;
-    unsigned int cbo_alive;
-    unsigned int cbo_dead;
-    unsigned int num_vertices;
+    unsigned int num_indices;
+
+    // Per instance cell positions and states, refilled every frame
+    unsigned int cells_bo;
+
+    float alive_color[3];
+    float dead_color[3];
 
     float eye[3];
 
     GLuint model_matrix_id;
     GLuint view_matrix_id;
     GLuint projection_matrix_id;
+    GLuint alive_color_id;
+    GLuint dead_color_id;
+
+    // Size the viewport was last set to
+    int viewport_x;
+    int viewport_y;
 };
 
 struct Renderer *rendererCreate(enum ColorScheme color_scheme);
 void rendererDestroy(struct Renderer *self);
 void rendererRecenter(struct Renderer *self, struct World *world);
-int rendererGrowWorldToFillView(struct Renderer *self, struct World *world);
-void renderWorld(struct Renderer *self, struct World *world);
-void renderClear(struct Renderer *self);
+int rendererHandleWorldInput(struct Renderer *self, struct World *world, struct RewindRing *rewind);
+void rendererHandleEditInput(struct Renderer *self, struct World *world, struct EditQueue *edits);
+int rendererWorldInputPending();
+void rendererHandleViewInput(struct Renderer *self);
+int rendererBuildFrame(struct Renderer *self, const struct WorldSnapshot *snapshot, struct RenderFrame *frame);
+void rendererDrawFrame(struct Renderer *self, const struct RenderFrame *frame);
 
 #endif // __GAME_OF_LIFE_RENDERER_H__
@@ -0,0 +1,392 @@
+#include "rewind.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int cellsAlive(const struct RewindCells *self, int x, int y) {
+    int64_t c = (int64_t) x - self->min_x;
+    int64_t r = (int64_t) y - self->min_y;
+    if (c < 0 || r < 0 || c >= self->cols || r >= self->rows)
+        return 0;
+    return self->cells[(size_t) r * self->cols + (size_t) c] != 0;
+}
+
+static int cellsReserve(struct RewindCells *self, size_t size) {
+    if (size <= self->capacity)
+        return 1;
+
+    unsigned char *cells = realloc(self->cells, size);
+    if (!cells) {
+        fprintf(stderr, "rewind::cellsReserve: Error! Failed to allocate memory for %zu cells.\n", size);
+        return 0;
+    }
+    self->cells = cells;
+    self->capacity = size;
+    return 1;
+}
+
+/// Copies the live cells of the world.
+static int cellsCopyWorld(struct RewindCells *self, struct World *world) {
+    int min_x, min_y, max_x, max_y;
+    if (!worldLiveBounds(world, &min_x, &min_y, &max_x, &max_y)) {
+        self->cols = 0;
+        self->rows = 0;
+        return 1;
+    }
+
+    unsigned int cols = (unsigned int) (max_x - min_x + 1);
+    unsigned int rows = (unsigned int) (max_y - min_y + 1);
+    if (!cellsReserve(self, (size_t) cols * rows))
+        return 0;
+
+    worldGetCells(world, self->cells, rows, cols, cols, min_x, min_y);
+
+    self->min_x = min_x;
+    self->min_y = min_y;
+    self->cols = cols;
+    self->rows = rows;
+    return 1;
+}
+
+/// Copies the cells of src inside the given box to dst, which covers the
+/// box. Cells of the box outside src are dead.
+static int cellsRebox(const struct RewindCells *src, struct RewindCells *dst, int min_x, int min_y,
+                      unsigned int cols, unsigned int rows) {
+    if (!cellsReserve(dst, (size_t) cols * rows))
+        return 0;
+    if (cols && rows)
+        memset(dst->cells, 0, (size_t) cols * rows);
+    dst->min_x = min_x;
+    dst->min_y = min_y;
+    dst->cols = cols;
+    dst->rows = rows;
+
+    int64_t x0 = min_x > src->min_x ? min_x : src->min_x;
+    int64_t y0 = min_y > src->min_y ? min_y : src->min_y;
+    int64_t x1 = (int64_t) min_x + cols < (int64_t) src->min_x + src->cols ? (int64_t) min_x + cols
+                                                                          : (int64_t) src->min_x + src->cols;
+    int64_t y1 = (int64_t) min_y + rows < (int64_t) src->min_y + src->rows ? (int64_t) min_y + rows
+                                                                          : (int64_t) src->min_y + src->rows;
+    if (x0 >= x1)
+        return 1;
+    for (int64_t y = y0; y < y1; ++y) {
+        memcpy(&dst->cells[(size_t) (y - min_y) * cols + (size_t) (x0 - min_x)],
+               &src->cells[(size_t) (y - src->min_y) * src->cols + (size_t) (x0 - src->min_x)],
+               (size_t) (x1 - x0));
+    }
+    return 1;
+}
+
+static int reserveBuffer(struct RewindRing *self, size_t size) {
+    if (size <= self->buffer_capacity)
+        return 1;
+
+    unsigned char *buffer = realloc(self->buffer, size);
+    if (!buffer) {
+        fprintf(stderr, "rewind::reserveBuffer: Error! Failed to allocate memory for %zu bytes.\n", size);
+        return 0;
+    }
+    self->buffer = buffer;
+    self->buffer_capacity = size;
+    return 1;
+}
+
+/// Encodes the cells of after that differ from before, or from an empty
+/// world if before is NULL, into a new frame.
+static int encodeFrame(struct RewindRing *self, const struct RewindCells *before, const struct RewindCells *after,
+                       uint64_t generation, struct RewindFrame *frame) {
+    frame->generation = generation;
+    frame->keyframe = before == NULL;
+    frame->live_min_x = after->min_x;
+    frame->live_min_y = after->min_y;
+    frame->live_cols = after->cols;
+    frame->live_rows = after->rows;
+
+    // The box covers both generations' live cells
+    int64_t min_x = after->min_x, min_y = after->min_y;
+    int64_t max_x = (int64_t) after->min_x + after->cols, max_y = (int64_t) after->min_y + after->rows;
+    if (before && before->cols && before->rows) {
+        if (!after->cols || !after->rows) {
+            min_x = before->min_x;
+            min_y = before->min_y;
+            max_x = (int64_t) before->min_x + before->cols;
+            max_y = (int64_t) before->min_y + before->rows;
+        } else {
+            min_x = before->min_x < min_x ? before->min_x : min_x;
+            min_y = before->min_y < min_y ? before->min_y : min_y;
+            max_x = (int64_t) before->min_x + before->cols > max_x ? (int64_t) before->min_x + before->cols : max_x;
+            max_y = (int64_t) before->min_y + before->rows > max_y ? (int64_t) before->min_y + before->rows : max_y;
+        }
+    }
+    frame->min_x = (int) min_x;
+    frame->min_y = (int) min_y;
+    frame->cols = (unsigned int) (max_x - min_x);
+    frame->rows = (unsigned int) (max_y - min_y);
+
+    // Varints of the gaps between changed cells, unless they come to more
+    // than a bit per cell
+    size_t count = (size_t) frame->cols * frame->rows;
+    size_t packed_size = (count + 7) / 8;
+    if (!reserveBuffer(self, packed_size + 10))
+        return 0;
+
+    size_t size = 0;
+    uint64_t gap = 0;
+    for (unsigned int r = 0; r < frame->rows && size <= packed_size; ++r) {
+        int y = frame->min_y + (int) r;
+        for (unsigned int c = 0; c < frame->cols; ++c) {
+            int x = frame->min_x + (int) c;
+            if (cellsAlive(after, x, y) == (before ? cellsAlive(before, x, y) : 0)) {
+                ++gap;
+                continue;
+            }
+            while (gap >= 0x80) {
+                self->buffer[size++] = (unsigned char) (gap | 0x80);
+                gap >>= 7;
+            }
+            self->buffer[size++] = (unsigned char) gap;
+            gap = 0;
+            if (size > packed_size)
+                break;
+        }
+    }
+
+    frame->packed = size > packed_size;
+    if (frame->packed) {
+        size = packed_size;
+        memset(self->buffer, 0, size);
+        size_t i = 0;
+        for (unsigned int r = 0; r < frame->rows; ++r) {
+            int y = frame->min_y + (int) r;
+            for (unsigned int c = 0; c < frame->cols; ++c, ++i) {
+                int x = frame->min_x + (int) c;
+                if (cellsAlive(after, x, y) != (before ? cellsAlive(before, x, y) : 0))
+                    self->buffer[i >> 3] |= (unsigned char) (1u << (i & 7));
+            }
+        }
+    }
+
+    frame->data = NULL;
+    frame->size = size;
+    if (size) {
+        frame->data = malloc(size);
+        if (!frame->data) {
+            fprintf(stderr, "rewind::encodeFrame: Error! Failed to allocate memory for a frame of %zu bytes.\n", size);
+            return 0;
+        }
+        memcpy(frame->data, self->buffer, size);
+    }
+    return 1;
+}
+
+/// Applies a frame to the cells of the frame before it, or to no cells if
+/// it is a keyframe. scratch is overwritten.
+static int decodeFrame(const struct RewindFrame *frame, struct RewindCells *cells, struct RewindCells *scratch) {
+    if (frame->keyframe) {
+        cells->cols = 0;
+        cells->rows = 0;
+    }
+    if (!cellsRebox(cells, scratch, frame->min_x, frame->min_y, frame->cols, frame->rows))
+        return 0;
+
+    size_t count = (size_t) frame->cols * frame->rows;
+    if (frame->packed) {
+        for (size_t i = 0; i < count; ++i)
+            scratch->cells[i] ^= (frame->data[i >> 3] >> (i & 7)) & 1;
+    } else {
+        size_t index = 0;
+        size_t pos = 0;
+        while (pos < frame->size) {
+            uint64_t gap = 0;
+            unsigned int shift = 0;
+            while (pos < frame->size && (frame->data[pos] & 0x80) && shift < 64) {
+                gap |= (uint64_t) (frame->data[pos++] & 0x7f) << shift;
+                shift += 7;
+            }
+            if (pos < frame->size && shift < 64)
+                gap |= (uint64_t) frame->data[pos++] << shift;
+            else
+                gap = count;
+            if (gap >= count - index) {
+                fprintf(stderr, "rewind::decodeFrame: Error! Frame of generation %llu is corrupt.\n",
+                        (unsigned long long) frame->generation);
+                return 0;
+            }
+            index += gap;
+            scratch->cells[index++] ^= 1;
+        }
+    }
+
+    return cellsRebox(scratch, cells, frame->live_min_x, frame->live_min_y, frame->live_cols, frame->live_rows);
+}
+
+static struct RewindFrame *frameAt(struct RewindRing *self, unsigned int i) {
+    return &self->frames[(self->head + i) % self->max_frames];
+}
+
+static void dropNewest(struct RewindRing *self) {
+    struct RewindFrame *frame = frameAt(self, self->num_frames - 1);
+    self->bytes -= frame->size;
+    free(frame->data);
+    --self->num_frames;
+}
+
+/// Drops the oldest keyframe and the deltas that depend on it.
+static void dropOldestGroup(struct RewindRing *self) {
+    do {
+        struct RewindFrame *frame = frameAt(self, 0);
+        self->bytes -= frame->size;
+        free(frame->data);
+        self->head = (self->head + 1) % self->max_frames;
+        --self->num_frames;
+    } while (self->num_frames && !frameAt(self, 0)->keyframe);
+}
+
+static void dropAll(struct RewindRing *self) {
+    while (self->num_frames)
+        dropNewest(self);
+    self->head = 0;
+    self->since_keyframe = 0;
+    self->last.cols = 0;
+    self->last.rows = 0;
+}
+
+struct RewindRing *rewindRingCreate(unsigned int max_frames, unsigned int keyframe_interval, size_t max_bytes) {
+
+    if (max_frames == 0 || keyframe_interval == 0) {
+        fprintf(stderr, "rewind::rewindRingCreate: Error! At least one frame must be kept.\n");
+        return NULL;
+    }
+
+    struct RewindRing *self = malloc(sizeof(struct RewindRing));
+    if (!self) {
+        fprintf(stderr, "Failed to allocate memory for the rewind ring.\n");
+        return NULL;
+    }
+
+    self->frames = malloc(sizeof(struct RewindFrame) * max_frames);
+    if (!self->frames) {
+        fprintf(stderr, "Failed to allocate memory for %u rewind frames.\n", max_frames);
+        free(self);
+        return NULL;
+    }
+    self->max_frames = max_frames;
+    self->head = 0;
+    self->num_frames = 0;
+    self->keyframe_interval = keyframe_interval;
+    self->since_keyframe = 0;
+    self->max_bytes = max_bytes;
+    self->bytes = 0;
+    memset(&self->last, 0, sizeof(struct RewindCells));
+    memset(&self->next, 0, sizeof(struct RewindCells));
+    self->buffer = NULL;
+    self->buffer_capacity = 0;
+    return self;
+}
+
+void rewindRingDestroy(struct RewindRing *self) {
+    if (!self)
+        return;
+
+    dropAll(self);
+    free(self->frames);
+    free(self->last.cells);
+    free(self->next.cells);
+    free(self->buffer);
+    free(self);
+}
+
+/// Records the world as the newest frame. Recording a generation again,
+/// e.g. after an edit, keeps both and seeking finds the later one.
+int rewindRingRecord(struct RewindRing *self, struct World *world) {
+    if (!cellsCopyWorld(&self->next, world))
+        return 0;
+
+    int keyframe = self->num_frames == 0 || self->since_keyframe + 1 >= self->keyframe_interval;
+    struct RewindFrame frame;
+    if (!encodeFrame(self, keyframe ? NULL : &self->last, &self->next, world->generation, &frame))
+        return 0;
+
+    // Old groups make room for the new frame. A delta that would have to
+    // drop its own keyframe becomes a keyframe.
+    while (self->num_frames &&
+           (self->num_frames >= self->max_frames || self->bytes + frame.size > self->max_bytes)) {
+        int one_group = 1;
+        for (unsigned int i = 1; i < self->num_frames && one_group; ++i)
+            one_group = !frameAt(self, i)->keyframe;
+
+        if (one_group && !frame.keyframe) {
+            free(frame.data);
+            if (!encodeFrame(self, NULL, &self->next, world->generation, &frame))
+                return 0;
+        }
+        dropOldestGroup(self);
+    }
+
+    *frameAt(self, self->num_frames) = frame;
+    ++self->num_frames;
+    self->bytes += frame.size;
+    self->since_keyframe = frame.keyframe ? 0 : self->since_keyframe + 1;
+
+    struct RewindCells last = self->last;
+    self->last = self->next;
+    self->next = last;
+    return 1;
+}
+
+/// Puts the world back to the latest frame recorded at or before the
+/// generation, and drops the frames after it. Returns 0 if no frame that
+/// old is kept, the world is unchanged.
+int rewindRingSeek(struct RewindRing *self, struct World *world, uint64_t generation) {
+    unsigned int found = self->num_frames;
+    for (unsigned int i = self->num_frames; i-- > 0;) {
+        if (frameAt(self, i)->generation <= generation) {
+            found = i;
+            break;
+        }
+    }
+    if (found == self->num_frames)
+        return 0;
+
+    unsigned int keyframe = found;
+    while (!frameAt(self, keyframe)->keyframe)
+        --keyframe;
+
+    // Decoded into next with last as scratch, last is replaced by the
+    // frame found anyway
+    for (unsigned int i = keyframe; i <= found; ++i) {
+        if (!decodeFrame(frameAt(self, i), &self->next, &self->last)) {
+            dropAll(self);
+            return 0;
+        }
+    }
+
+    const struct RewindCells *cells = &self->next;
+    worldClear(world);
+    if (!worldStampAt(world, cells->min_x, cells->min_y, cells->cols, cells->rows, cells->cells)) {
+        fprintf(stderr, "rewind::rewindRingSeek: Error! Failed to put back the cells of generation %llu.\n",
+                (unsigned long long) frameAt(self, found)->generation);
+        dropAll(self);
+        return 0;
+    }
+    world->generation = frameAt(self, found)->generation;
+
+    while (self->num_frames > found + 1)
+        dropNewest(self);
+    self->since_keyframe = found - keyframe;
+
+    struct RewindCells last = self->last;
+    self->last = self->next;
+    self->next = last;
+    return 1;
+}
+
+/// Gets the oldest generation that can be sought. Returns 0 if no frame is
+/// kept.
+int rewindRingOldest(struct RewindRing *self, uint64_t *generation) {
+    if (!self->num_frames)
+        return 0;
+    *generation = frameAt(self, 0)->generation;
+    return 1;
+}
@@ -0,0 +1,81 @@
+#ifndef __GAME_OF_LIFE_REWIND_H__
+#define __GAME_OF_LIFE_REWIND_H__
+
+#include "world.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DEFAULT_REWIND_KEYFRAME_INTERVAL 64
+#define DEFAULT_REWIND_BYTES (64u << 20)
+
+/// Cols x rows cells with the top left cell at (min_x, min_y) in world
+/// coords, one byte per cell. Cells outside are dead.
+struct RewindCells {
+    int min_x;
+    int min_y;
+    unsigned int cols;
+    unsigned int rows;
+    unsigned char *cells;
+    size_t capacity;
+};
+
+/// One recorded generation, stored as the cells that changed since the
+/// frame before it. A keyframe stores the cells that changed since an
+/// empty world, so it is decoded without the frames before it.
+struct RewindFrame {
+    uint64_t generation;
+    int keyframe;
+
+    // Box of the changed cells, which covers the live cells of this frame
+    // and of the one before it
+    int min_x;
+    int min_y;
+    unsigned int cols;
+    unsigned int rows;
+
+    // Live cells of this frame, the cells once decoded are cropped to them
+    int live_min_x;
+    int live_min_y;
+    unsigned int live_cols;
+    unsigned int live_rows;
+
+    // Changed cells of the box in row order. Either the number of unchanged
+    // cells before each changed cell, as varints, or with packed set a bit
+    // per cell, whichever is smaller.
+    int packed;
+    unsigned char *data;
+    size_t size;
+};
+
+/// Past generations of a world, kept so it can be put back to one of them.
+/// Every keyframe_interval frames is a keyframe and the frames between
+/// are deltas, so seeking decodes at most keyframe_interval frames. At most
+/// max_frames frames and about max_bytes bytes of changed cells are kept,
+/// the oldest keyframe and its deltas are dropped first.
+struct RewindRing {
+    struct RewindFrame *frames;
+    unsigned int max_frames;
+    unsigned int head;
+    unsigned int num_frames;
+    unsigned int keyframe_interval;
+    unsigned int since_keyframe;
+    size_t max_bytes;
+    size_t bytes;
+
+    // Cells of the latest frame, the next frame is the change from them
+    struct RewindCells last;
+
+    // Scratch cells and encoding buffer, reused between frames
+    struct RewindCells next;
+    unsigned char *buffer;
+    size_t buffer_capacity;
+};
+
+struct RewindRing *rewindRingCreate(unsigned int max_frames, unsigned int keyframe_interval, size_t max_bytes);
+void rewindRingDestroy(struct RewindRing *self);
+int rewindRingRecord(struct RewindRing *self, struct World *world);
+int rewindRingSeek(struct RewindRing *self, struct World *world, uint64_t generation);
+int rewindRingOldest(struct RewindRing *self, uint64_t *generation);
+
+#endif // __GAME_OF_LIFE_REWIND_H__
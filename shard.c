@@ -0,0 +1,726 @@
+#include "shard.h"
+
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+enum ShardCommandType {
+    ShardCommandSetup = 0,  // Followed by a ShardSetup and the packed rows of the shard and its halos
+    ShardCommandStep,       // Step generations, swap halos and reply with ShardStats
+    ShardCommandGather,     // Reply with the packed interior rows
+    ShardCommandQuit
+};
+
+struct ShardCommand {
+    uint32_t type;
+    uint32_t generations;
+};
+
+/// Shape of a shard. Its world has halo_top + rows + halo_bottom rows of
+/// cols cells, the interior rows starting at domain row row_begin.
+struct ShardSetup {
+    uint32_t cols;
+    uint32_t rows;
+    uint32_t halo_top;
+    uint32_t halo_bottom;
+    uint32_t row_begin;
+    int32_t topology;
+    int32_t engine;
+    uint32_t num_threads;
+    char rule[LIFE_RULE_MAX_CHARS];
+};
+
+/// State of a worker process.
+struct ShardState {
+    struct World *world;
+    struct ShardSetup setup;
+
+    // Sockets to the shards above and below, -1 if there is none
+    int up_fd;
+    int down_fd;
+
+    // Packed rows sent to and received from the shards above and below
+    uint8_t *halo_out[2];
+    uint8_t *halo_in[2];
+
+    // Live cells in the halo rows, which belong to other shards
+    uint64_t halo_population;
+};
+
+static int writeAll(int fd, const void *data, size_t bytes) {
+    const char *next = data;
+    while (bytes) {
+        ssize_t n = send(fd, next, bytes, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        next += n;
+        bytes -= (size_t) n;
+    }
+    return 1;
+}
+
+static int readAll(int fd, void *data, size_t bytes) {
+    char *next = data;
+    while (bytes) {
+        ssize_t n = recv(fd, next, bytes, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return 0;
+        next += n;
+        bytes -= (size_t) n;
+    }
+    return 1;
+}
+
+/// Bytes of a row of cols cells packed 8 cells per byte, bit i of byte b
+/// being the cell at col 8*b + i.
+static size_t rowBytes(unsigned int cols) {
+    return (cols + 7) / 8;
+}
+
+static void packRow(const unsigned char *cells, unsigned int cols, uint8_t *bits) {
+    memset(bits, 0, rowBytes(cols));
+    for (unsigned int c = 0; c < cols; ++c)
+        bits[c >> 3] |= (uint8_t) ((cells[c] != 0) << (c & 7));
+}
+
+/// Packs row r of the world as packRow does, read from whichever cells the
+/// engine keeps, so a bit packed world is not unpacked.
+static void packWorldRow(struct World *world, unsigned int r, unsigned int cols, uint8_t *bits) {
+    int y = world->tl_cell_pos_y + (int) r;
+    memset(bits, 0, rowBytes(cols));
+    for (unsigned int c = 0; c < cols; ++c)
+        bits[c >> 3] |= (uint8_t) (worldCellAlive(world, world->tl_cell_pos_x + (int) c, y) << (c & 7));
+}
+
+static void unpackRow(const uint8_t *bits, unsigned int cols, unsigned char *cells) {
+    for (unsigned int c = 0; c < cols; ++c)
+        cells[c] = (bits[c >> 3] >> (c & 7)) & 1;
+}
+
+/// Sets num_rows rows of the world from packed rows, toggling only the
+/// cells that differ so the counts of the world stay up to date. Returns
+/// the live cells in the rows.
+static uint64_t setRows(struct World *world, unsigned int first_row, unsigned int num_rows, const uint8_t *bits) {
+    const size_t bytes = rowBytes(world->cols);
+    uint64_t population = 0;
+    for (unsigned int i = 0; i < num_rows; ++i) {
+        int y = world->tl_cell_pos_y + (int) (first_row + i);
+        for (unsigned int c = 0; c < world->cols; ++c) {
+            int alive = (bits[i * bytes + (c >> 3)] >> (c & 7)) & 1;
+            population += (uint64_t) alive;
+            if (alive != worldCellAlive(world, world->tl_cell_pos_x + (int) c, y))
+                worldToggleCell(world, (int) c, (int) (first_row + i));
+        }
+    }
+    return population;
+}
+
+/// Sends the edge rows of the shard to its neighbours and receives theirs,
+/// both at once so neither side waits on the other to read.
+static int transferHalos(struct ShardState *state, size_t bytes) {
+    int fds[2] = {state->setup.halo_top ? state->up_fd : -1, state->setup.halo_bottom ? state->down_fd : -1};
+    size_t sent[2] = {0, 0};
+    size_t received[2] = {0, 0};
+    for (int i = 0; i < 2; ++i) {
+        if (fds[i] < 0)
+            sent[i] = received[i] = bytes;
+    }
+
+    for (;;) {
+        struct pollfd polls[2];
+        int num_polls = 0;
+        int poll_side[2];
+        for (int i = 0; i < 2; ++i) {
+            short events = (short) ((sent[i] < bytes ? POLLOUT : 0) | (received[i] < bytes ? POLLIN : 0));
+            if (!events)
+                continue;
+            polls[num_polls].fd = fds[i];
+            polls[num_polls].events = events;
+            polls[num_polls].revents = 0;
+            poll_side[num_polls++] = i;
+        }
+        if (!num_polls)
+            return 1;
+
+        if (poll(polls, (nfds_t) num_polls, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            return 0;
+        }
+
+        for (int j = 0; j < num_polls; ++j) {
+            int i = poll_side[j];
+            if ((polls[j].revents & POLLOUT) && sent[i] < bytes) {
+                ssize_t n = send(fds[i], state->halo_out[i] + sent[i], bytes - sent[i], MSG_DONTWAIT | MSG_NOSIGNAL);
+                if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+                    return 0;
+                sent[i] += n > 0 ? (size_t) n : 0;
+            }
+            if ((polls[j].revents & (POLLIN | POLLHUP | POLLERR)) && received[i] < bytes) {
+                ssize_t n = recv(fds[i], state->halo_in[i] + received[i], bytes - received[i], MSG_DONTWAIT);
+                if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR))
+                    return 0;
+                received[i] += n > 0 ? (size_t) n : 0;
+            }
+        }
+    }
+}
+
+/// Swaps halos with the neighbouring shards, so the halo rows again hold
+/// the cells of the rows next to the shard.
+static int exchangeHalos(struct ShardState *state) {
+    struct World *world = state->world;
+    const struct ShardSetup *setup = &state->setup;
+    const size_t bytes = rowBytes(setup->cols);
+    unsigned int halo = setup->halo_top ? setup->halo_top : setup->halo_bottom;
+    if (!halo)
+        return 1;
+
+    for (unsigned int i = 0; i < halo; ++i) {
+        if (setup->halo_top)
+            packWorldRow(world, setup->halo_top + i, setup->cols, &state->halo_out[0][i * bytes]);
+        if (setup->halo_bottom)
+            packWorldRow(world, setup->halo_top + setup->rows - halo + i, setup->cols, &state->halo_out[1][i * bytes]);
+    }
+
+    if (!transferHalos(state, halo * bytes)) {
+        fprintf(stderr, "shard::exchangeHalos: Error! Failed to swap halos with the neighbouring shards.\n");
+        return 0;
+    }
+
+    state->halo_population = 0;
+    if (setup->halo_top)
+        state->halo_population += setRows(world, 0, setup->halo_top, state->halo_in[0]);
+    if (setup->halo_bottom)
+        state->halo_population += setRows(world, setup->halo_top + setup->rows, setup->halo_bottom, state->halo_in[1]);
+    return 1;
+}
+
+static void shardStats(struct ShardState *state, struct ShardStats *stats) {
+    memset(stats, 0, sizeof(struct ShardStats));
+    stats->ok = 1;
+    if (!state->world)
+        return;
+
+    stats->population = worldPopulation(state->world) - state->halo_population;
+    int min_x, min_y, max_x, max_y;
+    if (worldLiveBounds(state->world, &min_x, &min_y, &max_x, &max_y)) {
+        int offset = (int) state->setup.row_begin - (int) state->setup.halo_top - state->world->tl_cell_pos_y;
+        stats->live = 1;
+        stats->min_x = min_x - state->world->tl_cell_pos_x;
+        stats->max_x = max_x - state->world->tl_cell_pos_x;
+        stats->min_y = min_y + offset;
+        stats->max_y = max_y + offset;
+    }
+}
+
+/// Makes the world of the shard from a setup command.
+static int setupShard(struct ShardState *state, int control_fd) {
+    struct ShardSetup *setup = &state->setup;
+    if (!readAll(control_fd, setup, sizeof(struct ShardSetup)))
+        return 0;
+    setup->rule[LIFE_RULE_MAX_CHARS - 1] = '\0';
+
+    const size_t bytes = rowBytes(setup->cols);
+    unsigned int halo = setup->halo_top > setup->halo_bottom ? setup->halo_top : setup->halo_bottom;
+    unsigned int total_rows = setup->halo_top + setup->rows + setup->halo_bottom;
+    for (int i = 0; i < 2; ++i) {
+        free(state->halo_out[i]);
+        free(state->halo_in[i]);
+        state->halo_out[i] = malloc(halo * bytes + 1);
+        state->halo_in[i] = malloc(halo * bytes + 1);
+    }
+    uint8_t *row = malloc(bytes);
+    if (!row || !state->halo_out[0] || !state->halo_out[1] || !state->halo_in[0] || !state->halo_in[1]) {
+        fprintf(stderr, "shard::setupShard: Error! Failed to allocate memory for the halos.\n");
+        free(row);
+        return 0;
+    }
+
+    struct World *world = state->world;
+    world->engine = (enum WorldEngine) setup->engine;
+    world->compact_interval = 0;
+    int ok = worldSetRule(world, setup->rule) && worldSetThreads(world, setup->num_threads) &&
+             worldSetTopology(world, (enum WorldTopology) setup->topology, setup->cols, total_rows);
+    if (ok)
+        worldClear(world);
+
+    // Every row is read, even after a failure, so the commands that follow
+    // are read from the right place
+    state->halo_population = 0;
+    for (unsigned int r = 0; r < total_rows; ++r) {
+        if (!readAll(control_fd, row, bytes)) {
+            free(row);
+            return 0;
+        }
+        if (!ok)
+            continue;
+        uint64_t population = setRows(world, r, 1, row);
+        if (r < setup->halo_top || r >= setup->halo_top + setup->rows)
+            state->halo_population += population;
+    }
+
+    free(row);
+    return ok;
+}
+
+/// Packs the interior rows and sends them to the coordinator.
+static int sendInterior(struct ShardState *state, int control_fd) {
+    const size_t bytes = rowBytes(state->setup.cols);
+    uint8_t *row = malloc(bytes);
+    if (!row)
+        return 0;
+
+    for (unsigned int r = 0; r < state->setup.rows; ++r) {
+        packWorldRow(state->world, state->setup.halo_top + r, state->setup.cols, row);
+        if (!writeAll(control_fd, row, bytes)) {
+            free(row);
+            return 0;
+        }
+    }
+
+    free(row);
+    return 1;
+}
+
+/// Runs commands from the coordinator until told to quit or its socket
+/// closes. Runs in the forked worker process.
+static void runWorker(int control_fd, int up_fd, int down_fd) {
+    struct ShardState state;
+    memset(&state, 0, sizeof(struct ShardState));
+    state.up_fd = up_fd;
+    state.down_fd = down_fd;
+    state.world = worldCreate();
+
+    struct ShardCommand command;
+    while (state.world && readAll(control_fd, &command, sizeof(struct ShardCommand))) {
+        struct ShardStats stats;
+        if (command.type == ShardCommandQuit)
+            break;
+
+        if (command.type == ShardCommandSetup) {
+            int ok = setupShard(&state, control_fd);
+            shardStats(&state, &stats);
+            stats.ok = ok;
+        } else if (command.type == ShardCommandStep) {
+            int ok = worldStep(state.world, command.generations) && exchangeHalos(&state);
+            shardStats(&state, &stats);
+            stats.ok = ok;
+        } else if (command.type == ShardCommandGather) {
+            if (!sendInterior(&state, control_fd))
+                break;
+            continue;
+        } else {
+            break;
+        }
+
+        if (!writeAll(control_fd, &stats, sizeof(struct ShardStats)))
+            break;
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        free(state.halo_out[i]);
+        free(state.halo_in[i]);
+    }
+    worldDestroy(state.world);
+}
+
+/// Starts num_workers worker processes. Shard i is linked to shard i + 1
+/// by a socket pair, and the last shard to the first for a torus.
+struct ShardCluster *shardClusterCreate(unsigned int num_workers, unsigned int halo) {
+    if (num_workers < 1 || halo < 1) {
+        fprintf(stderr, "shard::shardClusterCreate: Error! Expected at least one worker and a halo of at least one row.\n");
+        return NULL;
+    }
+
+    struct ShardCluster *self = calloc(1, sizeof(struct ShardCluster));
+    if (!self) {
+        fprintf(stderr, "Failed to allocate memory for the shard cluster.\n");
+        return NULL;
+    }
+    self->workers = calloc(num_workers, sizeof(struct ShardWorker));
+    int *fds = malloc(sizeof(int) * 4 * num_workers);
+    if (!self->workers || !fds) {
+        fprintf(stderr, "Failed to allocate memory for the shard cluster.\n");
+        free(fds);
+        free(self->workers);
+        free(self);
+        return NULL;
+    }
+    self->num_workers = num_workers;
+    self->halo = halo;
+    self->threads_per_worker = 1;
+    self->topology = TopologyUnbounded;
+    self->engine = EngineDense;
+    lifeRuleConway(&self->rule);
+
+    // fds holds the two ends of the control socket of each worker, then the
+    // two ends of the link below each shard
+    int *control = fds;
+    int *links = fds + 2 * num_workers;
+    unsigned int num_links = num_workers > 1 ? num_workers : 0;
+    for (unsigned int i = 0; i < 4 * num_workers; ++i)
+        fds[i] = -1;
+    int created = 1;
+    for (unsigned int i = 0; created && i < num_workers; ++i)
+        created = socketpair(AF_UNIX, SOCK_STREAM, 0, &control[2 * i]) == 0;
+    for (unsigned int i = 0; created && i < num_links; ++i)
+        created = socketpair(AF_UNIX, SOCK_STREAM, 0, &links[2 * i]) == 0;
+
+    // Buffered output would otherwise be written again by each worker
+    fflush(stdout);
+    fflush(stderr);
+    for (unsigned int i = 0; created && i < num_workers; ++i) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            created = 0;
+            break;
+        }
+
+        if (pid == 0) {
+            int up_fd = num_links ? links[2 * ((i + num_workers - 1) % num_workers) + 1] : -1;
+            int down_fd = num_links ? links[2 * i] : -1;
+            for (unsigned int j = 0; j < 4 * num_workers; ++j) {
+                if (fds[j] >= 0 && fds[j] != up_fd && fds[j] != down_fd && fds[j] != control[2 * i + 1])
+                    close(fds[j]);
+            }
+            for (unsigned int j = 0; j < i; ++j)
+                close(self->workers[j].control_fd);
+            runWorker(control[2 * i + 1], up_fd, down_fd);
+            _exit(0);
+        }
+
+        self->workers[i].pid = pid;
+        self->workers[i].control_fd = control[2 * i];
+        control[2 * i] = -1;
+    }
+
+    // The workers hold their own ends, the coordinator only its control ends
+    for (unsigned int j = 0; j < 4 * num_workers; ++j) {
+        if (fds[j] >= 0)
+            close(fds[j]);
+    }
+    free(fds);
+
+    if (!created) {
+        fprintf(stderr, "shard::shardClusterCreate: Error! Failed to start %u workers.\n", num_workers);
+        shardClusterDestroy(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+void shardClusterDestroy(struct ShardCluster *self) {
+    if (!self)
+        return;
+
+    struct ShardCommand quit = {ShardCommandQuit, 0};
+    for (unsigned int i = 0; i < self->num_workers; ++i) {
+        if (self->workers[i].pid <= 0)
+            continue;
+        writeAll(self->workers[i].control_fd, &quit, sizeof(struct ShardCommand));
+        close(self->workers[i].control_fd);
+    }
+    for (unsigned int i = 0; i < self->num_workers; ++i) {
+        if (self->workers[i].pid > 0)
+            waitpid(self->workers[i].pid, NULL, 0);
+    }
+
+    free(self->workers);
+    free(self->cells);
+    free(self);
+}
+
+/// Reads the stats of every worker after a command and sums them.
+static int readStats(struct ShardCluster *self) {
+    int ok = 1;
+    int live = 0;
+    self->population = 0;
+    for (unsigned int i = 0; i < self->num_workers; ++i) {
+        struct ShardStats *stats = &self->workers[i].stats;
+        if (!readAll(self->workers[i].control_fd, stats, sizeof(struct ShardStats)) || !stats->ok) {
+            fprintf(stderr, "shard::readStats: Error! Worker %u failed.\n", i);
+            ok = 0;
+            continue;
+        }
+
+        self->population += stats->population;
+        if (!stats->live)
+            continue;
+        if (!live || stats->min_x + self->domain_x < self->live_min_x)
+            self->live_min_x = stats->min_x + self->domain_x;
+        if (!live || stats->min_y + self->domain_y < self->live_min_y)
+            self->live_min_y = stats->min_y + self->domain_y;
+        if (!live || stats->max_x + self->domain_x > self->live_max_x)
+            self->live_max_x = stats->max_x + self->domain_x;
+        if (!live || stats->max_y + self->domain_y > self->live_max_y)
+            self->live_max_y = stats->max_y + self->domain_y;
+        live = 1;
+    }
+
+    if (!live)
+        self->live_min_x = self->live_min_y = self->live_max_x = self->live_max_y = 0;
+    return ok;
+}
+
+/// Sends each worker its shard of the domain cells, with the halos above
+/// and below it.
+static int scatterDomain(struct ShardCluster *self) {
+    const unsigned int n = self->num_workers;
+    const size_t bytes = rowBytes(self->domain_cols);
+    uint8_t *row = malloc(bytes);
+    if (!row) {
+        fprintf(stderr, "shard::scatterDomain: Error! Failed to allocate memory for a row.\n");
+        return 0;
+    }
+
+    char rule[LIFE_RULE_MAX_CHARS];
+    lifeRuleToString(&self->rule, rule);
+    int wraps = self->topology == TopologyTorus && n > 1;
+    for (unsigned int i = 0; i < n; ++i) {
+        struct ShardWorker *worker = &self->workers[i];
+        worker->row_begin = (unsigned int) ((uint64_t) i * self->domain_rows / n);
+        worker->row_end = (unsigned int) ((uint64_t) (i + 1) * self->domain_rows / n);
+
+        // The outer edges of a bounded world have no halo, the shard's own
+        // edge is the edge of the world
+        struct ShardSetup setup;
+        memset(&setup, 0, sizeof(struct ShardSetup));
+        setup.cols = self->domain_cols;
+        setup.rows = worker->row_end - worker->row_begin;
+        setup.halo_top = (i > 0 || wraps) ? self->halo : 0;
+        setup.halo_bottom = (i + 1 < n || wraps) ? self->halo : 0;
+        setup.row_begin = worker->row_begin;
+        setup.topology = self->topology == TopologyTorus ? TopologyTorus : TopologyBounded;
+        setup.engine = self->engine;
+        setup.num_threads = self->threads_per_worker;
+        memcpy(setup.rule, rule, LIFE_RULE_MAX_CHARS);
+
+        struct ShardCommand command = {ShardCommandSetup, 0};
+        if (!writeAll(worker->control_fd, &command, sizeof(struct ShardCommand)) ||
+            !writeAll(worker->control_fd, &setup, sizeof(struct ShardSetup))) {
+            fprintf(stderr, "shard::scatterDomain: Error! Failed to send worker %u its shard.\n", i);
+            free(row);
+            return 0;
+        }
+
+        int first = (int) worker->row_begin - (int) setup.halo_top;
+        int last = (int) worker->row_end + (int) setup.halo_bottom;
+        for (int r = first; r < last; ++r) {
+            unsigned int domain_row = (unsigned int) ((r + (int) self->domain_rows) % (int) self->domain_rows);
+            packRow(&self->cells[(size_t) domain_row * self->domain_cols], self->domain_cols, row);
+            if (!writeAll(worker->control_fd, row, bytes)) {
+                fprintf(stderr, "shard::scatterDomain: Error! Failed to send worker %u its shard.\n", i);
+                free(row);
+                return 0;
+            }
+        }
+    }
+
+    free(row);
+    return readStats(self);
+}
+
+/// Collects the interior rows of every shard into the domain cells.
+static int gatherDomain(struct ShardCluster *self) {
+    const size_t bytes = rowBytes(self->domain_cols);
+    uint8_t *row = malloc(bytes);
+    if (!row) {
+        fprintf(stderr, "shard::gatherDomain: Error! Failed to allocate memory for a row.\n");
+        return 0;
+    }
+
+    struct ShardCommand command = {ShardCommandGather, 0};
+    int ok = 1;
+    for (unsigned int i = 0; ok && i < self->num_workers; ++i)
+        ok = writeAll(self->workers[i].control_fd, &command, sizeof(struct ShardCommand));
+
+    for (unsigned int i = 0; ok && i < self->num_workers; ++i) {
+        struct ShardWorker *worker = &self->workers[i];
+        for (unsigned int r = worker->row_begin; ok && r < worker->row_end; ++r) {
+            ok = readAll(worker->control_fd, row, bytes);
+            if (ok)
+                unpackRow(row, self->domain_cols, &self->cells[(size_t) r * self->domain_cols]);
+        }
+    }
+
+    if (!ok)
+        fprintf(stderr, "shard::gatherDomain: Error! Failed to collect the cells of the shards.\n");
+    free(row);
+    return ok;
+}
+
+/// Sets the domain of an unbounded world to the live bounds and a margin
+/// of a quarter of their size, at least SHARD_MIN_MARGIN and two halos,
+/// so the domain is moved less often as the pattern grows. Every shard
+/// gets at least a halo of rows.
+static void fitDomain(struct ShardCluster *self, int min_x, int min_y, int max_x, int max_y) {
+    unsigned int width = (unsigned int) (max_x - min_x + 1);
+    unsigned int height = (unsigned int) (max_y - min_y + 1);
+    unsigned int min_margin = SHARD_MIN_MARGIN > 2 * self->halo ? SHARD_MIN_MARGIN : 2 * self->halo;
+    unsigned int margin_x = width / 4 > min_margin ? width / 4 : min_margin;
+    unsigned int margin_y = height / 4 > min_margin ? height / 4 : min_margin;
+
+    self->domain_x = min_x - (int) margin_x;
+    self->domain_y = min_y - (int) margin_y;
+    self->domain_cols = width + 2 * margin_x;
+    self->domain_rows = height + 2 * margin_y;
+    if (self->domain_rows < self->num_workers * self->halo) {
+        unsigned int extra = self->num_workers * self->halo - self->domain_rows;
+        self->domain_y -= (int) (extra / 2);
+        self->domain_rows += extra;
+    }
+}
+
+/// Moves the cells to a domain fitted to the live cells and sends the
+/// workers their new shards.
+static int regrowDomain(struct ShardCluster *self) {
+    int old_x = self->domain_x;
+    int old_y = self->domain_y;
+    unsigned int old_cols = self->domain_cols;
+    unsigned int old_rows = self->domain_rows;
+    unsigned char *old_cells = self->cells;
+
+    fitDomain(self, self->live_min_x, self->live_min_y, self->live_max_x, self->live_max_y);
+    self->cells = calloc((size_t) self->domain_cols * self->domain_rows, 1);
+    if (!self->cells) {
+        fprintf(stderr, "shard::regrowDomain: Error! Failed to allocate memory for %u x %u cells.\n",
+                self->domain_cols, self->domain_rows);
+        free(old_cells);
+        return 0;
+    }
+
+    // Every live cell is in both domains
+    for (unsigned int r = 0; r < old_rows; ++r) {
+        int y = old_y + (int) r - self->domain_y;
+        if (y < 0 || y >= (int) self->domain_rows)
+            continue;
+        for (unsigned int c = 0; c < old_cols; ++c) {
+            int x = old_x + (int) c - self->domain_x;
+            if (old_cells[(size_t) r * old_cols + c] && x >= 0 && x < (int) self->domain_cols)
+                self->cells[(size_t) y * self->domain_cols + x] = 1;
+        }
+    }
+
+    free(old_cells);
+    ++self->regrows;
+    return scatterDomain(self);
+}
+
+/// Splits the world between the workers. The shards take the rule and the
+/// engine of the world, which must be dense, bit packed or lookup. A torus
+/// or bounded world is split as it is, an unbounded world is given a
+/// domain around its live cells, see shardClusterStep.
+int shardClusterLoad(struct ShardCluster *self, struct World *world) {
+    if (world->engine == EngineHashLife || world->engine == EngineSparse) {
+        fprintf(stderr, "shard::shardClusterLoad: Error! Shards are stepped with the dense, bit packed or lookup engines.\n");
+        return 0;
+    }
+
+    // A bit packed world keeps its cells packed once it has been stepped
+    if (!worldSyncCells(world))
+        return 0;
+
+    self->topology = world->topology;
+    self->engine = world->engine;
+    self->rule = world->rule;
+    self->generation = world->generation;
+
+    if (world->topology == TopologyUnbounded) {
+        int min_x, min_y, max_x, max_y;
+        if (!worldLiveBounds(world, &min_x, &min_y, &max_x, &max_y)) {
+            min_x = max_x = world->tl_cell_pos_x;
+            min_y = max_y = world->tl_cell_pos_y;
+        }
+        fitDomain(self, min_x, min_y, max_x, max_y);
+    } else {
+        self->domain_x = world->tl_cell_pos_x;
+        self->domain_y = world->tl_cell_pos_y;
+        self->domain_cols = world->cols;
+        self->domain_rows = world->rows;
+        if (self->num_workers > 1 && world->rows / self->num_workers < self->halo) {
+            fprintf(stderr, "shard::shardClusterLoad: Error! %u rows cannot be split into %u shards of at least %u rows.\n",
+                    world->rows, self->num_workers, self->halo);
+            return 0;
+        }
+    }
+
+    free(self->cells);
+    self->cells = calloc((size_t) self->domain_cols * self->domain_rows, 1);
+    if (!self->cells) {
+        fprintf(stderr, "shard::shardClusterLoad: Error! Failed to allocate memory for %u x %u cells.\n",
+                self->domain_cols, self->domain_rows);
+        return 0;
+    }
+
+    for (unsigned int r = 0; r < world->rows; ++r) {
+        int y = world->tl_cell_pos_y + (int) r - self->domain_y;
+        for (unsigned int c = 0; c < world->cols; ++c) {
+            int x = world->tl_cell_pos_x + (int) c - self->domain_x;
+            if (world->cells[(size_t) r * world->stride + c])
+                self->cells[(size_t) y * self->domain_cols + x] = 1;
+        }
+    }
+
+    return scatterDomain(self);
+}
+
+/// Steps the shards a halo of generations at a time, swapping halos after
+/// each batch. A live cell moves at most a cell per generation, so before
+/// each batch the cells of an unbounded world are moved to a larger domain
+/// once live cells come within a halo of its edge.
+int shardClusterStep(struct ShardCluster *self, uint64_t generations) {
+    while (generations) {
+        if (self->topology == TopologyUnbounded && self->population &&
+            (self->live_min_x - self->domain_x < (int) self->halo ||
+             self->live_min_y - self->domain_y < (int) self->halo ||
+             self->domain_x + (int) self->domain_cols - 1 - self->live_max_x < (int) self->halo ||
+             self->domain_y + (int) self->domain_rows - 1 - self->live_max_y < (int) self->halo)) {
+            if (!gatherDomain(self) || !regrowDomain(self))
+                return 0;
+        }
+
+        uint32_t batch = generations < self->halo ? (uint32_t) generations : self->halo;
+        struct ShardCommand command = {ShardCommandStep, batch};
+        for (unsigned int i = 0; i < self->num_workers; ++i) {
+            if (!writeAll(self->workers[i].control_fd, &command, sizeof(struct ShardCommand))) {
+                fprintf(stderr, "shard::shardClusterStep: Error! Failed to send worker %u a step.\n", i);
+                return 0;
+            }
+        }
+        if (!readStats(self))
+            return 0;
+
+        self->generation += batch;
+        generations -= batch;
+    }
+    return 1;
+}
+
+/// Copies the cells of the shards back into the world, which must be the
+/// world loaded or one of the same topology and size.
+int shardClusterGather(struct ShardCluster *self, struct World *world) {
+    if (!gatherDomain(self))
+        return 0;
+
+    worldClear(world);
+    for (unsigned int r = 0; r < self->domain_rows; ++r) {
+        for (unsigned int c = 0; c < self->domain_cols; ++c) {
+            if (self->cells[(size_t) r * self->domain_cols + c] &&
+                !worldToggleCellAt(world, self->domain_x + (int) c, self->domain_y + (int) r))
+                return 0;
+        }
+    }
+    world->generation = self->generation;
+    return 1;
+}
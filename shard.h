@@ -0,0 +1,89 @@
+#ifndef __GAME_OF_LIFE_SHARD_H__
+#define __GAME_OF_LIFE_SHARD_H__
+
+#include "world.h"
+
+#include <stdint.h>
+#include <sys/types.h>
+
+// An unbounded world is given at least this many dead cells around its
+// live cells when split into shards, see shardClusterStep.
+#define SHARD_MIN_MARGIN 64
+
+/// Live cells of the interior rows of one shard, as reported by its worker
+/// after each batch of generations.
+struct ShardStats {
+    uint64_t population;
+
+    // Set if any cell of the shard, halos included, is alive. The bounds
+    // are then those of the shard and its halos in domain coords, which
+    // together cover every live cell since the halos hold the live cells
+    // of the neighbouring shards.
+    int32_t live;
+    int32_t min_x;
+    int32_t min_y;
+    int32_t max_x;
+    int32_t max_y;
+    int32_t ok;
+};
+
+/// A worker process owning rows [row_begin, row_end) of the domain.
+struct ShardWorker {
+    pid_t pid;
+
+    // Commands are sent and stats read on this end of a socket pair
+    int control_fd;
+
+    unsigned int row_begin;
+    unsigned int row_end;
+    struct ShardStats stats;
+};
+
+/// Steps a world split into horizontal shards, each stepped by a separate
+/// worker process. Neighbouring shards swap the halo rows of cells along
+/// their shared edge over Unix domain sockets after every halo
+/// generations, and this process, the coordinator, sums their stats and
+/// moves the cells to a larger domain when an unbounded world outgrows it.
+struct ShardCluster {
+    struct ShardWorker *workers;
+    unsigned int num_workers;
+
+    // Rows each shard keeps of its neighbours, and so the generations
+    // stepped between exchanges
+    unsigned int halo;
+
+    // Taken from the world loaded, see shardClusterLoad
+    enum WorldTopology topology;
+    enum WorldEngine engine;
+    struct LifeRule rule;
+    unsigned int threads_per_worker;
+
+    // The domain is the domain_cols x domain_rows cells from world coords
+    // (domain_x, domain_y) split between the shards. cells holds a byte
+    // per cell of the domain while the cells are moved to and from the
+    // workers.
+    int domain_x;
+    int domain_y;
+    unsigned int domain_cols;
+    unsigned int domain_rows;
+    unsigned char *cells;
+
+    // Sums of the stats of the shards after the last step
+    uint64_t generation;
+    uint64_t population;
+    int live_min_x;
+    int live_min_y;
+    int live_max_x;
+    int live_max_y;
+
+    // Number of times the domain has been moved to fit the live cells
+    uint64_t regrows;
+};
+
+struct ShardCluster *shardClusterCreate(unsigned int num_workers, unsigned int halo);
+void shardClusterDestroy(struct ShardCluster *self);
+int shardClusterLoad(struct ShardCluster *self, struct World *world);
+int shardClusterStep(struct ShardCluster *self, uint64_t generations);
+int shardClusterGather(struct ShardCluster *self, struct World *world);
+
+#endif // __GAME_OF_LIFE_SHARD_H__
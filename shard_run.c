@@ -0,0 +1,166 @@
+#include "shard.h"
+#include "world.h"
+#include "time_control.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DEFAULT_WORKERS 2
+#define DEFAULT_HALO 1
+
+void printUsage();
+
+int main(int argc, char *argv[]) {
+
+    const char *load_file_path = NULL;
+    const char *save_file_path = NULL;
+    enum WorldEngine engine = EngineDense;
+    const char *rule = NULL;
+    enum WorldTopology topology = TopologyUnbounded;
+    unsigned int topology_cols = 0; // 0 = size of the loaded world
+    unsigned int topology_rows = 0;
+    uint64_t generations = 0;
+    unsigned int num_workers = DEFAULT_WORKERS;
+    unsigned int halo = DEFAULT_HALO;
+    unsigned int threads_per_worker = 1;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "l:s:e:r:b:n:w:h:t:")) != -1) {
+        switch (opt) {
+            case 'l':
+                load_file_path = optarg;
+                break;
+            case 's':
+                save_file_path = optarg;
+                break;
+            case 'e':
+                if (strcmp(optarg, "dense") == 0) {
+                    engine = EngineDense;
+                } else if (strcmp(optarg, "bitpacked") == 0) {
+                    engine = EngineBitPacked;
+                } else if (strcmp(optarg, "lookup") == 0) {
+                    engine = EngineLookupTable;
+                } else {
+                    fprintf(stderr, "Unrecognised engine %s, shards are stepped with dense, bitpacked or lookup\n", optarg);
+                    printUsage();
+                    return 1;
+                }
+                break;
+            case 'r':
+                rule = optarg;
+                break;
+            case 'b':
+                if (strncmp(optarg, "torus", 5) == 0) {
+                    topology = TopologyTorus;
+                } else if (strncmp(optarg, "bounded", 7) == 0) {
+                    topology = TopologyBounded;
+                } else if (strcmp(optarg, "unbounded") != 0) {
+                    fprintf(stderr, "Unrecognised topology %s\n", optarg);
+                    printUsage();
+                    return 1;
+                }
+
+                // Optional size, e.g. torus:256x128
+                const char *size = strchr(optarg, ':');
+                if (size && sscanf(size + 1, "%ux%u", &topology_cols, &topology_rows) != 2) {
+                    fprintf(stderr, "Expected a size of COLSxROWS in %s\n", optarg);
+                    printUsage();
+                    return 1;
+                }
+                break;
+            case 'n':
+                if (sscanf(optarg, "%" SCNu64, &generations) != 1) {
+                    fprintf(stderr, "Expected a generation count, got %s\n", optarg);
+                    printUsage();
+                    return 1;
+                }
+                break;
+            case 'w':
+                if (atoi(optarg) < 1) {
+                    fprintf(stderr, "Worker count must be at least 1\n");
+                    printUsage();
+                    return 1;
+                }
+                num_workers = (unsigned int) atoi(optarg);
+                break;
+            case 'h':
+                if (atoi(optarg) < 1) {
+                    fprintf(stderr, "Halo must be at least 1 row\n");
+                    printUsage();
+                    return 1;
+                }
+                halo = (unsigned int) atoi(optarg);
+                break;
+            case 't':
+                if (atoi(optarg) < 1) {
+                    fprintf(stderr, "Thread count must be at least 1\n");
+                    printUsage();
+                    return 1;
+                }
+                threads_per_worker = (unsigned int) atoi(optarg);
+                break;
+            default:
+                fprintf(stderr, "Unrecognised command line option.\n");
+                printUsage();
+                return 1;
+        }
+    }
+
+    if (!load_file_path) {
+        fprintf(stderr, "Expected a world file to load\n");
+        printUsage();
+        return 1;
+    }
+
+    // The workers are forked before the world is loaded, so they start
+    // from a small process
+    struct ShardCluster *cluster = shardClusterCreate(num_workers, halo);
+    if (!cluster)
+        return 1;
+    cluster->threads_per_worker = threads_per_worker;
+
+    struct World *world = worldCreate();
+    int ok = world && worldLoadFromFile(world, load_file_path);
+    if (ok && rule)
+        ok = worldSetRule(world, rule);
+    if (ok && topology != TopologyUnbounded)
+        ok = worldSetTopology(world, topology, topology_cols, topology_rows);
+    if (ok) {
+        world->engine = engine;
+        ok = shardClusterLoad(cluster, world);
+    }
+    if (!ok) {
+        shardClusterDestroy(cluster);
+        worldDestroy(world);
+        return 1;
+    }
+
+    unsigned long start = timeNow();
+    ok = shardClusterStep(cluster, generations);
+    double seconds = (timeNow() - start) * 1e-6;
+
+    if (ok) {
+        fprintf(stdout, "Stepped %" PRIu64 " generations on %u shards in %.3f s, %.1f generations/s\n",
+                generations, num_workers, seconds, seconds > 0.0 ? generations / seconds : 0.0);
+        fprintf(stdout, "Generation %" PRIu64 ", population %" PRIu64, cluster->generation, cluster->population);
+        if (cluster->population)
+            fprintf(stdout, ", live cells in (%d, %d) to (%d, %d)", cluster->live_min_x, cluster->live_min_y,
+                    cluster->live_max_x, cluster->live_max_y);
+        fprintf(stdout, "\nDomain of %u x %u cells, moved %" PRIu64 " times\n",
+                cluster->domain_cols, cluster->domain_rows, cluster->regrows);
+    }
+
+    if (ok && save_file_path)
+        ok = shardClusterGather(cluster, world) && worldSaveToFile(world, save_file_path);
+
+    shardClusterDestroy(cluster);
+    worldDestroy(world);
+    return ok ? 0 : 1;
+}
+
+void printUsage() {
+    fprintf(stderr, "./shard_run -l load_file_path -s save_file_path -e [dense, bitpacked, lookup] -r rule -b [unbounded, torus[:COLSxROWS], bounded[:COLSxROWS]] -n generations -w workers -h halo -t threads_per_worker\n");
+}
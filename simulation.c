@@ -0,0 +1,160 @@
+#include "simulation.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+// Edits are applied within this many us of being pushed, however slow the
+// update rate
+#define EDIT_POLL_US 16000
+#define EDIT_QUEUE_CAPACITY 4096
+
+/// Waits with the lock held until the time timeNow() returns passes
+/// deadline or the thread is told to stop.
+static void waitUntil(struct Simulation *self, unsigned long deadline) {
+    const unsigned long us_per_sec = 1000000;
+    struct timespec ts;
+    ts.tv_sec = (time_t) (deadline / us_per_sec);
+    ts.tv_nsec = (long) (deadline % us_per_sec) * 1000;
+
+    // timeNow is TIME_UTC, the realtime clock the condition waits on
+    while (!self->stop && timeNow() < deadline)
+        pthread_cond_timedwait(&self->wake, &self->lock, &ts);
+}
+
+/// Publishes the world and records it to rewind to. Must be called with the
+/// lock held.
+static int publishGeneration(struct Simulation *self) {
+    return simulationPublish(self) && (!self->rewind || rewindRingRecord(self->rewind, self->world));
+}
+
+static void *simulationMain(void *arg) {
+    struct Simulation *self = arg;
+
+    pthread_mutex_lock(&self->lock);
+    while (!self->stop) {
+        while (__atomic_load_n(&self->frame_waiting, __ATOMIC_RELAXED) && !self->stop)
+            pthread_cond_wait(&self->wake, &self->lock);
+        if (self->stop)
+            break;
+
+        // Edits land on the current generation, before it is updated. One
+        // that fails is dropped, the world is still whole.
+        unsigned int applied = 0;
+        editQueueDrain(self->edits, self->world, &applied);
+        if (applied && !publishGeneration(self)) {
+            self->failed = 1;
+            break;
+        }
+
+        // Like hasNextTickPassed and sleepTillNextTick, but the lock is free
+        // while waiting, and the wait is cut short to look for edits
+        self->rate.ticks_per_sec = self->world->update_rate.ticks_per_sec;
+        unsigned long now = timeNow();
+        unsigned long deadline = self->rate.last_tick + timeBetweenTicks(&self->rate);
+        if (now < deadline) {
+            waitUntil(self, deadline < now + EDIT_POLL_US ? deadline : now + EDIT_POLL_US);
+            continue;
+        }
+        self->rate.last_tick = now;
+
+        uint64_t generation = self->world->generation;
+        if (!worldUpdate(self->world)) {
+            fprintf(stderr, "simulation::simulationMain: Error! Failed to update the world.\n");
+            self->failed = 1;
+            break;
+        }
+        if (self->world->generation != generation && !publishGeneration(self)) {
+            self->failed = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    return NULL;
+}
+
+/// Publishes the world as it is and starts updating it on a new thread.
+struct Simulation *simulationCreate(struct World *world) {
+
+    struct Simulation *self = malloc(sizeof(struct Simulation));
+    if (!self) {
+        fprintf(stderr, "Failed to allocate memory for the simulation.\n");
+        return NULL;
+    }
+
+    self->world = world;
+    self->snapshots = snapshotRingCreate();
+    self->edits = editQueueCreate(EDIT_QUEUE_CAPACITY);
+    self->rewind = NULL;
+    if (world->rewind_generations)
+        self->rewind = rewindRingCreate(world->rewind_generations, DEFAULT_REWIND_KEYFRAME_INTERVAL,
+                                        DEFAULT_REWIND_BYTES);
+    if (!self->snapshots || !self->edits || (world->rewind_generations && !self->rewind) ||
+        !publishGeneration(self)) {
+        snapshotRingDestroy(self->snapshots);
+        editQueueDestroy(self->edits);
+        rewindRingDestroy(self->rewind);
+        free(self);
+        return NULL;
+    }
+    self->rate.ticks_per_sec = world->update_rate.ticks_per_sec;
+    self->rate.last_tick = timeNow();
+    self->frame_waiting = 0;
+    self->stop = 0;
+    self->failed = 0;
+    pthread_mutex_init(&self->lock, NULL);
+    pthread_cond_init(&self->wake, NULL);
+
+    if (pthread_create(&self->thread, NULL, simulationMain, self) != 0) {
+        fprintf(stderr, "simulation::simulationCreate: Error! Failed to create the simulation thread.\n");
+        pthread_cond_destroy(&self->wake);
+        pthread_mutex_destroy(&self->lock);
+        snapshotRingDestroy(self->snapshots);
+        editQueueDestroy(self->edits);
+        rewindRingDestroy(self->rewind);
+        free(self);
+        return NULL;
+    }
+
+    return self;
+}
+
+/// Stops the thread once the generation it is on has finished. Every
+/// snapshot must have been released. Edits still queued are dropped.
+void simulationDestroy(struct Simulation *self) {
+    if (!self)
+        return;
+
+    pthread_mutex_lock(&self->lock);
+    self->stop = 1;
+    pthread_cond_broadcast(&self->wake);
+    pthread_mutex_unlock(&self->lock);
+    pthread_join(self->thread, NULL);
+
+    pthread_cond_destroy(&self->wake);
+    pthread_mutex_destroy(&self->lock);
+    snapshotRingDestroy(self->snapshots);
+    editQueueDestroy(self->edits);
+    rewindRingDestroy(self->rewind);
+    free(self);
+}
+
+/// Takes the world from the simulation thread, waiting at most for the
+/// generation it is on.
+void simulationLock(struct Simulation *self) {
+    __atomic_store_n(&self->frame_waiting, 1, __ATOMIC_RELAXED);
+    pthread_mutex_lock(&self->lock);
+    __atomic_store_n(&self->frame_waiting, 0, __ATOMIC_RELAXED);
+}
+
+void simulationUnlock(struct Simulation *self) {
+    pthread_cond_broadcast(&self->wake);
+    pthread_mutex_unlock(&self->lock);
+}
+
+/// Publishes the world after an edit or rewind. Must be called with the lock
+/// held.
+int simulationPublish(struct Simulation *self) {
+    return snapshotPublish(self->snapshots, self->world);
+}
@@ -0,0 +1,62 @@
+#ifndef __GAME_OF_LIFE_SIMULATION_H__
+#define __GAME_OF_LIFE_SIMULATION_H__
+
+#include "world.h"
+#include "snapshot.h"
+#include "edit_queue.h"
+#include "rewind.h"
+#include "time_control.h"
+
+#include <pthread.h>
+
+/// Updates a world on its own thread at the world's update_rate, so that
+/// a slow generation does not hold up input and drawing, and a slow frame
+/// does not hold up the generations. Each generation is published to
+/// snapshots, which other threads read without waiting. Other threads edit
+/// the cells by pushing to edits, also without waiting, or change the rest
+/// of the world between simulationLock and simulationUnlock. The
+/// generations are also recorded so the world can be rewound.
+struct Simulation {
+
+    struct World *world;
+    pthread_t thread;
+
+    // Latest generation and edits, see snapshotAcquire
+    struct SnapshotRing *snapshots;
+
+    // Edits of the cells from any thread, applied by the simulation thread
+    // between generations, see editQueueDrain
+    struct EditQueue *edits;
+
+    // Past generations and edits, recorded by the simulation thread. NULL
+    // if the world's rewind_generations is zero. Seeking needs the lock.
+    struct RewindRing *rewind;
+
+    // Guards the world and the fields below
+    pthread_mutex_t lock;
+
+    // Signalled to stop the thread or when a frame has been drawn
+    pthread_cond_t wake;
+
+    // Ticks of the simulation thread. ticks_per_sec follows the world's
+    // update_rate, which the window changes.
+    struct TimeControl rate;
+
+    // Set by simulationLock while a thread waits for the lock. The
+    // simulation thread lets it have the lock before the next generation,
+    // so generations that take longer than a tick do not starve it.
+    int frame_waiting;
+
+    int stop;
+
+    // Set if a generation failed, the thread stops updating the world
+    int failed;
+};
+
+struct Simulation *simulationCreate(struct World *world);
+void simulationDestroy(struct Simulation *self);
+void simulationLock(struct Simulation *self);
+void simulationUnlock(struct Simulation *self);
+int simulationPublish(struct Simulation *self);
+
+#endif // __GAME_OF_LIFE_SIMULATION_H__
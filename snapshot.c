@@ -0,0 +1,129 @@
+#include "snapshot.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct SnapshotRing *snapshotRingCreate() {
+
+    struct SnapshotRing *self = malloc(sizeof(struct SnapshotRing));
+    if (!self) {
+        fprintf(stderr, "Failed to allocate memory for the snapshots.\n");
+        return NULL;
+    }
+
+    for (int i = 0; i < SNAPSHOT_SLOTS; ++i) {
+        struct WorldSnapshot *slot = &self->slots[i];
+        slot->refs = 0;
+        slot->generation = 0;
+        slot->population = 0;
+        slot->min_x = 0;
+        slot->min_y = 0;
+        slot->cols = 0;
+        slot->rows = 0;
+        slot->cells = NULL;
+        slot->capacity = 0;
+    }
+    self->latest = -1;
+    self->skipped = 0;
+    return self;
+}
+
+/// Frees the snapshots, which no reader may still hold.
+void snapshotRingDestroy(struct SnapshotRing *self) {
+    if (!self)
+        return;
+
+    for (int i = 0; i < SNAPSHOT_SLOTS; ++i)
+        free(self->slots[i].cells);
+    free(self);
+}
+
+/// Copies the live cells of the world into a free slot and makes it the
+/// latest snapshot. Only one thread may publish at a time, and the world
+/// must not change meanwhile. If readers hold every other slot the
+/// generation is skipped. Returns 0 if memory for the cells ran out.
+int snapshotPublish(struct SnapshotRing *self, struct World *world) {
+    int latest = __atomic_load_n(&self->latest, __ATOMIC_SEQ_CST);
+    struct WorldSnapshot *slot = NULL;
+    int index = 0;
+    for (; index < SNAPSHOT_SLOTS; ++index) {
+        int free_refs = 0;
+        if (index != latest &&
+            __atomic_compare_exchange_n(&self->slots[index].refs, &free_refs, SNAPSHOT_WRITING, 0,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+            slot = &self->slots[index];
+            break;
+        }
+    }
+    if (!slot) {
+        ++self->skipped;
+        return 1;
+    }
+
+    int min_x = 0, min_y = 0, max_x = -1, max_y = -1;
+    worldLiveBounds(world, &min_x, &min_y, &max_x, &max_y);
+    unsigned int cols = (unsigned int) (max_x - min_x + 1);
+    unsigned int rows = (unsigned int) (max_y - min_y + 1);
+
+    size_t size = (size_t) cols * rows;
+    if (size > slot->capacity) {
+        unsigned char *cells = realloc(slot->cells, size);
+        if (!cells) {
+            fprintf(stderr, "snapshot::snapshotPublish: Error! Failed to allocate memory for %u x %u cells.\n",
+                    cols, rows);
+            __atomic_fetch_sub(&slot->refs, SNAPSHOT_WRITING, __ATOMIC_SEQ_CST);
+            return 0;
+        }
+        slot->cells = cells;
+        slot->capacity = size;
+    }
+
+    worldGetCells(world, slot->cells, rows, cols, cols, min_x, min_y);
+
+    slot->generation = world->generation;
+    slot->population = worldPopulation(world);
+    slot->min_x = min_x;
+    slot->min_y = min_y;
+    slot->cols = cols;
+    slot->rows = rows;
+
+    // Readers that looked at the slot while it was written have seen
+    // SNAPSHOT_WRITING and let it go, or will see it is not the latest
+    __atomic_fetch_sub(&slot->refs, SNAPSHOT_WRITING, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&self->latest, index, __ATOMIC_SEQ_CST);
+    return 1;
+}
+
+/// Takes a reference to the latest snapshot, or returns NULL if none was
+/// published yet. The snapshot stays valid until snapshotRelease.
+struct WorldSnapshot *snapshotAcquire(struct SnapshotRing *self) {
+    while (1) {
+        int index = __atomic_load_n(&self->latest, __ATOMIC_SEQ_CST);
+        if (index < 0)
+            return NULL;
+
+        struct WorldSnapshot *slot = &self->slots[index];
+        int refs = __atomic_fetch_add(&slot->refs, 1, __ATOMIC_SEQ_CST);
+
+        // The slot is reused once it is no longer the latest, and may be
+        // the latest again by the time it is checked, with new cells that
+        // were all written before it was published
+        if (!(refs & SNAPSHOT_WRITING) && __atomic_load_n(&self->latest, __ATOMIC_SEQ_CST) == index)
+            return slot;
+        __atomic_fetch_sub(&slot->refs, 1, __ATOMIC_SEQ_CST);
+    }
+}
+
+void snapshotRelease(struct WorldSnapshot *snapshot) {
+    if (snapshot)
+        __atomic_fetch_sub(&snapshot->refs, 1, __ATOMIC_SEQ_CST);
+}
+
+int snapshotCellAlive(const struct WorldSnapshot *self, int x, int y) {
+    int c = x - self->min_x;
+    int r = y - self->min_y;
+    if (c < 0 || r < 0 || c >= (int) self->cols || r >= (int) self->rows)
+        return 0;
+    return self->cells[(size_t) r * self->cols + c] != 0;
+}
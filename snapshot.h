@@ -0,0 +1,56 @@
+#ifndef __GAME_OF_LIFE_SNAPSHOT_H__
+#define __GAME_OF_LIFE_SNAPSHOT_H__
+
+#include "world.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SNAPSHOT_SLOTS 4
+
+// Added to the refs of a slot while it is being written
+#define SNAPSHOT_WRITING (1 << 30)
+
+/// Copy of the live cells of one generation. Never changes once published.
+struct WorldSnapshot {
+
+    // Readers holding the snapshot, plus SNAPSHOT_WRITING while written
+    int refs;
+
+    uint64_t generation;
+    uint64_t population;
+
+    // The cols x rows cells with the top left cell at (min_x, min_y) in
+    // world coords, one byte per cell. They cover the live cells, cells
+    // outside are dead.
+    int min_x;
+    int min_y;
+    unsigned int cols;
+    unsigned int rows;
+    unsigned char *cells;
+    size_t capacity;
+};
+
+/// Snapshots published by one writer and read by any number of threads
+/// without locks. The writer fills a slot no reader holds and then makes it
+/// the latest with an atomic store. A reader takes a reference to the
+/// latest slot and checks it is still the latest, so a slot is only
+/// rewritten once no reader holds it.
+struct SnapshotRing {
+    struct WorldSnapshot slots[SNAPSHOT_SLOTS];
+
+    // Slot of the latest snapshot, -1 before the first
+    int latest;
+
+    // Generations not published because every other slot was held
+    uint64_t skipped;
+};
+
+struct SnapshotRing *snapshotRingCreate();
+void snapshotRingDestroy(struct SnapshotRing *self);
+int snapshotPublish(struct SnapshotRing *self, struct World *world);
+struct WorldSnapshot *snapshotAcquire(struct SnapshotRing *self);
+void snapshotRelease(struct WorldSnapshot *snapshot);
+int snapshotCellAlive(const struct WorldSnapshot *self, int x, int y);
+
+#endif // __GAME_OF_LIFE_SNAPSHOT_H__
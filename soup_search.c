@@ -0,0 +1,413 @@
+#include "world.h"
+#include "census.h"
+#include "thread_pool.h"
+#include "time_control.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Each soup is a random SOUP_SIZE x SOUP_SIZE square in the middle of an
+// unbounded world of SOUP_WORLD_SIZE x SOUP_WORLD_SIZE cells. The world is
+// cleared for each soup and only allocated again after a soup spread past
+// it, see clearSoupWorld.
+#define SOUP_SIZE 16
+#define SOUP_WORLD_SIZE 128
+
+// Soups are stepped this many generations at a time, and the spaceships
+// that escaped are taken out between, see censusTakeEscaped.
+#define SOUP_ESCAPE_GENERATIONS 64
+
+#define DEFAULT_SOUPS 10000
+#define DEFAULT_MAX_GENERATIONS 10000
+
+// Distinct results each worker can hold, a power of two. Results past
+// three quarters full are counted as untracked rather than stored.
+#define WORKER_RESULTS (1 << 16)
+#define RESULTS_SHOWN 20
+#define OBJECTS_SHOWN 20
+
+/// Distinct final state of the soups, keyed by the hash of its live cells
+/// moved to the origin. An empty slot has a count of zero.
+struct SoupResult {
+    uint64_t hash;
+    uint64_t count;
+    uint64_t population;
+    uint64_t period;
+
+    // Index of the first soup that gave this result
+    uint64_t soup;
+};
+
+struct SoupSearch;
+
+/// State owned by one task of the pool, so workers never share a world, a
+/// results table or a census.
+struct SoupWorker {
+    struct SoupSearch *search;
+    struct World *world;
+    struct Census *census;
+    struct SoupResult *results;
+    unsigned int num_results;
+    uint64_t untracked;
+    uint64_t unstable;
+    int failed;
+};
+
+struct SoupSearch {
+    uint64_t seed;
+    uint64_t num_soups;
+    uint64_t max_generations;
+
+    // Index of the next soup to run, taken atomically by the workers
+    uint64_t next_soup;
+
+    struct SoupWorker *workers;
+    unsigned int num_workers;
+};
+
+void printUsage();
+
+/// splitmix64, a fast PRNG whose state is a single counter. Soup i of a
+/// search is generated from seed and i alone, so any soup can be redone.
+static uint64_t nextRandom(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+/// Fills the middle of the cleared world with soup number soup of the
+/// search, each cell alive with probability 1/2.
+static void placeSoup(struct World *world, uint64_t seed, uint64_t soup) {
+    uint64_t state = seed ^ (soup * 0xD1B54A32D192ED03ull);
+    int offset = (SOUP_WORLD_SIZE - SOUP_SIZE) / 2;
+
+    for (int r = 0; r < SOUP_SIZE; r += 64 / SOUP_SIZE) {
+        uint64_t bits = nextRandom(&state);
+        for (int i = 0; i < 64; ++i) {
+            if ((bits >> i) & 1)
+                worldToggleCellAt(world, offset + i % SOUP_SIZE, offset + r + i / SOUP_SIZE);
+        }
+    }
+}
+
+/// Clears the world for the next soup. A world that grew for a soup that
+/// spread far is put back to its first size, so the soups after it are not
+/// stepped in a larger world than they need.
+static int clearSoupWorld(struct World *world) {
+    worldClear(world);
+    if (world->tl_cell_pos_x == 0 && world->tl_cell_pos_y == 0 &&
+        world->rows == SOUP_WORLD_SIZE && world->cols == SOUP_WORLD_SIZE)
+        return 1;
+
+    world->tl_cell_pos_x = 0;
+    world->tl_cell_pos_y = 0;
+    return worldSetTopology(world, TopologyUnbounded, SOUP_WORLD_SIZE, SOUP_WORLD_SIZE);
+}
+
+/// Counts a result in a results table of capacity slots. Returns 0 if the
+/// result is new and the table is too full to take it.
+static int addResult(struct SoupResult *results, unsigned int capacity, unsigned int *num_results,
+                     const struct SoupResult *result) {
+    unsigned int i = (unsigned int) (result->hash >> 32) & (capacity - 1);
+    while (results[i].count) {
+        if (results[i].hash == result->hash && results[i].population == result->population) {
+            results[i].count += result->count;
+            if (result->soup < results[i].soup)
+                results[i].soup = result->soup;
+            return 1;
+        }
+        i = (i + 1) & (capacity - 1);
+    }
+
+    if (*num_results >= capacity / 4 * 3)
+        return 0;
+    results[i] = *result;
+    ++*num_results;
+    return 1;
+}
+
+/// Steps the soup in the world of the worker until it repeats or
+/// max_generations have passed. A soup that sends out spaceships only
+/// repeats once they are gone, so the census of the worker takes out and
+/// counts the spaceships that escaped after each batch of generations.
+static int settleSoup(struct SoupWorker *worker, uint64_t max_generations) {
+    struct World *world = worker->world;
+    struct WorldPeriod period;
+    while (world->generation < max_generations && !worldPeriod(world, &period)) {
+        uint64_t batch = max_generations - world->generation;
+        if (!worldStep(world, batch < SOUP_ESCAPE_GENERATIONS ? batch : SOUP_ESCAPE_GENERATIONS))
+            return 0;
+        if (!worldPeriod(world, &period) && !censusTakeEscaped(worker->census, world))
+            return 0;
+    }
+    return 1;
+}
+
+/// Runs soups until every soup of the search has been taken.
+static void searchTask(void *arg, unsigned int i) {
+    struct SoupSearch *search = (struct SoupSearch *) arg;
+    struct SoupWorker *worker = &search->workers[i];
+    struct World *world = worker->world;
+
+    for (;;) {
+        uint64_t soup = __atomic_fetch_add(&search->next_soup, 1, __ATOMIC_RELAXED);
+        if (soup >= search->num_soups)
+            return;
+
+        if (!clearSoupWorld(world)) {
+            worker->failed = 1;
+            return;
+        }
+        placeSoup(world, search->seed, soup);
+        if (!settleSoup(worker, search->max_generations)) {
+            worker->failed = 1;
+            return;
+        }
+
+        struct WorldPeriod period;
+        if (!worldPeriod(world, &period)) {
+            ++worker->unstable;
+            continue;
+        }
+
+        if (!censusTake(worker->census, world)) {
+            worker->failed = 1;
+            return;
+        }
+
+        struct SoupResult result = {worldHashAtOrigin(world), 1, worldPopulation(world), period.period, soup};
+        if (!addResult(worker->results, WORKER_RESULTS, &worker->num_results, &result))
+            ++worker->untracked;
+    }
+}
+
+static int compareResults(const void *a, const void *b) {
+    const struct SoupResult *result_a = a;
+    const struct SoupResult *result_b = b;
+    if (result_a->count != result_b->count)
+        return result_a->count < result_b->count ? 1 : -1;
+    return result_a->soup < result_b->soup ? -1 : result_a->soup > result_b->soup;
+}
+
+/// Merges the results and the censuses of the workers and prints the most
+/// common results and objects.
+static int reportResults(struct SoupSearch *search, double seconds) {
+    unsigned int capacity = 1;
+    uint64_t untracked = 0;
+    uint64_t unstable = 0;
+    for (unsigned int i = 0; i < search->num_workers; ++i) {
+        while (capacity < 2 * (search->workers[i].num_results + 1) * search->num_workers)
+            capacity *= 2;
+        untracked += search->workers[i].untracked;
+        unstable += search->workers[i].unstable;
+    }
+
+    struct SoupResult *merged = calloc(capacity, sizeof(struct SoupResult));
+    if (!merged) {
+        fprintf(stderr, "soup_search::reportResults: Error! Failed to allocate memory for the results.\n");
+        return 0;
+    }
+
+    unsigned int num_merged = 0;
+    for (unsigned int i = 0; i < search->num_workers; ++i) {
+        struct SoupWorker *worker = &search->workers[i];
+        for (unsigned int j = 0; j < WORKER_RESULTS; ++j) {
+            if (worker->results[j].count)
+                addResult(merged, capacity, &num_merged, &worker->results[j]);
+        }
+    }
+
+    // Pack the distinct results to the front and sort by count
+    unsigned int n = 0;
+    for (unsigned int j = 0; j < capacity; ++j) {
+        if (merged[j].count)
+            merged[n++] = merged[j];
+    }
+    qsort(merged, n, sizeof(struct SoupResult), compareResults);
+
+    fprintf(stdout, "Searched %" PRIu64 " soups in %.3f s, %.1f soups/s on %u threads\n",
+            search->num_soups, seconds, seconds > 0.0 ? search->num_soups / seconds : 0.0, search->num_workers);
+    fprintf(stdout, "%u distinct results, %" PRIu64 " did not settle in %" PRIu64 " generations",
+            n, unstable, search->max_generations);
+    if (untracked)
+        fprintf(stdout, ", %" PRIu64 " not tracked", untracked);
+    fprintf(stdout, "\n\n%10s %10s %6s %18s %10s\n", "count", "population", "period", "hash", "first soup");
+    for (unsigned int j = 0; j < n && j < RESULTS_SHOWN; ++j) {
+        fprintf(stdout, "%10" PRIu64 " %10" PRIu64 " %6" PRIu64 " %018" PRIx64 " %10" PRIu64 "\n",
+                merged[j].count, merged[j].population, merged[j].period, merged[j].hash, merged[j].soup);
+    }
+    free(merged);
+
+    // The census of the first worker takes the tallies of the others
+    struct Census *census = search->workers[0].census;
+    for (unsigned int i = 1; i < search->num_workers; ++i) {
+        if (!censusMerge(census, search->workers[i].census))
+            return 0;
+    }
+    fprintf(stdout, "\nObjects in the settled soups: ");
+    return censusPrint(census, OBJECTS_SHOWN);
+}
+
+/// Creates an unbounded world for soups, stepped serially since the search
+/// already runs a soup per thread. It is never compacted, so it keeps the
+/// size of the largest soup seen rather than shrinking and growing again.
+static struct World *createSoupWorld(enum WorldEngine engine) {
+    struct World *world = worldCreate();
+    if (!world)
+        return NULL;
+
+    world->engine = engine;
+    world->detect_period = 1;
+    world->compact_interval = 0;
+    if (!worldSetThreads(world, 1) ||
+        !worldSetTopology(world, TopologyUnbounded, SOUP_WORLD_SIZE, SOUP_WORLD_SIZE)) {
+        worldDestroy(world);
+        return NULL;
+    }
+    return world;
+}
+
+static void destroySearch(struct SoupSearch *search) {
+    if (!search->workers)
+        return;
+    for (unsigned int i = 0; i < search->num_workers; ++i) {
+        worldDestroy(search->workers[i].world);
+        censusDestroy(search->workers[i].census);
+        free(search->workers[i].results);
+    }
+    free(search->workers);
+}
+
+int main(int argc, char *argv[]) {
+
+    struct SoupSearch search = {0, DEFAULT_SOUPS, DEFAULT_MAX_GENERATIONS, 0, NULL, 0};
+    enum WorldEngine engine = EngineDense;
+    unsigned int num_threads = threadPoolDefaultThreads();
+    int write_soup = 0;
+    uint64_t soup_to_write = 0;
+    char soup_file_path[256];
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:s:g:t:e:w:")) != -1) {
+        switch (opt) {
+            case 'n':
+                if (sscanf(optarg, "%" SCNu64, &search.num_soups) != 1) {
+                    fprintf(stderr, "Expected a soup count, got %s\n", optarg);
+                    printUsage();
+                    return 1;
+                }
+                break;
+            case 's':
+                if (sscanf(optarg, "%" SCNu64, &search.seed) != 1) {
+                    fprintf(stderr, "Expected a seed, got %s\n", optarg);
+                    printUsage();
+                    return 1;
+                }
+                break;
+            case 'g':
+                if (sscanf(optarg, "%" SCNu64, &search.max_generations) != 1) {
+                    fprintf(stderr, "Expected a generation count, got %s\n", optarg);
+                    printUsage();
+                    return 1;
+                }
+                break;
+            case 't':
+                if (atoi(optarg) < 1) {
+                    fprintf(stderr, "Thread count must be at least 1\n");
+                    printUsage();
+                    return 1;
+                }
+                num_threads = (unsigned int) atoi(optarg);
+                break;
+            case 'e':
+                if (strcmp(optarg, "dense") == 0) {
+                    engine = EngineDense;
+                } else if (strcmp(optarg, "bitpacked") == 0) {
+                    engine = EngineBitPacked;
+                } else if (strcmp(optarg, "lookup") == 0) {
+                    engine = EngineLookupTable;
+                } else {
+                    fprintf(stderr, "Unrecognised engine %s, soups are stepped with dense, lookup or bitpacked\n",
+                            optarg);
+                    printUsage();
+                    return 1;
+                }
+                break;
+            case 'w':
+                if (sscanf(optarg, "%" SCNu64, &soup_to_write) != 1) {
+                    fprintf(stderr, "Expected a soup index, got %s\n", optarg);
+                    printUsage();
+                    return 1;
+                }
+                write_soup = 1;
+                break;
+            default:
+                fprintf(stderr, "Unrecognised command line option.\n");
+                printUsage();
+                return 1;
+        }
+    }
+
+    // Write out a single soup, e.g. one listed as the first soup of a result
+    if (write_soup) {
+        struct World *world = createSoupWorld(engine);
+        if (!world)
+            return 1;
+        placeSoup(world, search.seed, soup_to_write);
+        snprintf(soup_file_path, sizeof(soup_file_path), "soup_%" PRIu64 "_%" PRIu64 ".txt", search.seed, soup_to_write);
+        int saved = worldSaveToFile(world, soup_file_path);
+        if (saved)
+            fprintf(stdout, "Wrote %s\n", soup_file_path);
+        worldDestroy(world);
+        return saved ? 0 : 1;
+    }
+
+    struct ThreadPool *pool = threadPoolCreate(num_threads);
+    search.workers = calloc(num_threads, sizeof(struct SoupWorker));
+    if (!pool || !search.workers) {
+        fprintf(stderr, "Failed to create the worker pool.\n");
+        threadPoolDestroy(pool);
+        free(search.workers);
+        return 1;
+    }
+
+    // Every world, census and results table is made up front
+    search.num_workers = num_threads;
+    for (unsigned int i = 0; i < num_threads; ++i) {
+        struct SoupWorker *worker = &search.workers[i];
+        worker->search = &search;
+        worker->world = createSoupWorld(engine);
+        worker->census = censusCreate();
+        worker->results = calloc(WORKER_RESULTS, sizeof(struct SoupResult));
+        if (!worker->world || !worker->census || !worker->results) {
+            fprintf(stderr, "Failed to create the soup worlds.\n");
+            destroySearch(&search);
+            threadPoolDestroy(pool);
+            return 1;
+        }
+    }
+
+    unsigned long start = timeNow();
+    threadPoolRun(pool, searchTask, &search, num_threads);
+    double seconds = (timeNow() - start) * 1e-6;
+
+    int failed = 0;
+    for (unsigned int i = 0; i < num_threads; ++i)
+        failed |= search.workers[i].failed;
+    if (failed)
+        fprintf(stderr, "Failed to step or take the census of a soup.\n");
+
+    int reported = !failed && reportResults(&search, seconds);
+
+    destroySearch(&search);
+    threadPoolDestroy(pool);
+    return reported ? 0 : 1;
+}
+
+void printUsage() {
+    fprintf(stderr, "./soup_search -n soups -s seed -g max_generations -t threads -e [dense, lookup, bitpacked] -w soup_index\n");
+}
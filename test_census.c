@@ -0,0 +1,137 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "census.h"
+#include "world.h"
+
+/// Places cells written as rows split by '/', '1' for live cells, with
+/// the top left at (c, r).
+static void placeCells(struct World *world, int c, int r, const char *cells) {
+    int col = 0;
+    for (const char *ch = cells; *ch; ++ch) {
+        if (*ch == '/') {
+            col = 0;
+            ++r;
+            continue;
+        }
+        if (*ch == '1')
+            worldToggleCell(world, c + col, r);
+        ++col;
+    }
+}
+
+/// Checks the count of each named object in the census.
+static int checkCounts(struct Census *census, int with_glider) {
+    const char *names[] = {"block", "boat", "beehive", "blinker", "beacon", "pulsar", "glider"};
+    const uint64_t counts[] = {2, 1, 1, 1, 1, 1, 1};
+    for (int i = 0; i < 7; ++i) {
+        uint64_t expected = (i == 6 && !with_glider) ? 0 : counts[i];
+        if (censusCount(census, names[i]) != expected) {
+            fprintf(stderr, "test_census: expected %lu of %s, counted %lu\n",
+                    (unsigned long) expected, names[i], (unsigned long) censusCount(census, names[i]));
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int main(void) {
+
+    fprintf(stderr, "test_census: \n");
+
+    struct Census *census = censusCreate();
+    struct World *world = worldCreate();
+    if (!census || !world || !worldSetTopology(world, TopologyBounded, 64, 64)) {
+        fprintf(stderr, "test_census: censusCreate    FAILED\n");
+        censusDestroy(census);
+        worldDestroy(world);
+        return 1;
+    }
+
+    // Objects in orientations and phases other than those of the known
+    // objects table, and a lone cell that is not a known object.
+    placeCells(world, 2, 2, "11/11");
+    placeCells(world, 10, 2, ".11/1.1/.1.");
+    placeCells(world, 20, 2, ".1./1.1/1.1/.1.");
+    placeCells(world, 30, 2, "1/1/1");
+    placeCells(world, 2, 20, "11../1.../...1/..11");
+    placeCells(world, 20, 20, "..111...111../............./1....1.1....1/1....1.1....1/1....1.1....1/..111...111../"
+                                 "............./..111...111../1....1.1....1/1....1.1....1/1....1.1....1/"
+                                 "............./..111...111..");
+    placeCells(world, 40, 20, "11/11");
+    placeCells(world, 50, 50, "111/1../.1.");
+    placeCells(world, 60, 2, "1");
+
+    if (!censusTake(census, world) || !checkCounts(census, 1) || census->num_objects != 8) {
+        fprintf(stderr, "test_census: censusTake    FAILED\n");
+        censusDestroy(census);
+        worldDestroy(world);
+        return 2;
+    }
+
+    // Every phase of an oscillator or spaceship is tallied as one object.
+    // The lone cell dies.
+    for (int generations = 1; generations <= 8; ++generations) {
+        censusReset(census);
+        if (!worldStep(world, 1) || !censusTake(census, world) || !checkCounts(census, 1) ||
+            census->num_objects != 7) {
+            fprintf(stderr, "test_census: census after %d generations    FAILED\n", generations);
+            censusDestroy(census);
+            worldDestroy(world);
+            return 3;
+        }
+    }
+
+    // Tallies of several censuses add up
+    struct Census *other = censusCreate();
+    if (!other || !censusTake(other, world) || !censusMerge(census, other) ||
+        censusCount(census, "block") != 4 || censusCount(census, "glider") != 2) {
+        fprintf(stderr, "test_census: censusMerge    FAILED\n");
+        censusDestroy(other);
+        censusDestroy(census);
+        worldDestroy(world);
+        return 4;
+    }
+    censusDestroy(other);
+
+    // Objects are only named under B3/S23
+    censusReset(census);
+    if (!worldSetRule(world, "B36/S23") || !censusTake(census, world) ||
+        censusCount(census, "block") != 0 || census->num_objects != 7) {
+        fprintf(stderr, "test_census: census under B36/S23    FAILED\n");
+        censusDestroy(census);
+        worldDestroy(world);
+        return 5;
+    }
+    worldDestroy(world);
+
+    // The r-pentomino settles by generation 1103 into 8 blocks and 6
+    // gliders. Each glider is taken out and counted once it is clear of
+    // the ash, so the world stays small while they fly off.
+    censusReset(census);
+    world = worldCreate();
+    if (!world || !worldSetTopology(world, TopologyUnbounded, 64, 64)) {
+        fprintf(stderr, "test_census: worldSetTopology    FAILED\n");
+        censusDestroy(census);
+        worldDestroy(world);
+        return 6;
+    }
+    placeCells(world, 30, 30, ".11/11./.1.");
+    int escaped_ok = 1;
+    while (escaped_ok && world->generation < 2048)
+        escaped_ok = worldStep(world, 64) && censusTakeEscaped(census, world);
+    uint64_t escaped = censusCount(census, "glider");
+    if (!escaped_ok || escaped != 6 || !censusTake(census, world) || censusCount(census, "glider") != 6 ||
+        censusCount(census, "block") != 8 || world->cols > 256 || world->rows > 256) {
+        fprintf(stderr, "test_census: %lu gliders escaped the r-pentomino\n", (unsigned long) escaped);
+        fprintf(stderr, "test_census: censusTakeEscaped    FAILED\n");
+        censusDestroy(census);
+        worldDestroy(world);
+        return 7;
+    }
+
+    censusDestroy(census);
+    worldDestroy(world);
+    fprintf(stderr, "test_census: All tests PASSED\n");
+    return 0;
+}
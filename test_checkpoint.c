@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "checkpoint.h"
+#include "world.h"
+
+#define CHECKPOINT_FILE "test_checkpoint.ckpt"
+#define GUN_FILE "../resources/examples/gosper_glider_gun.txt"
+
+/// True if both worlds have the same live cells in world coords.
+static int sameCells(struct World *a, struct World *b) {
+    if (worldPopulation(a) != worldPopulation(b))
+        return 0;
+
+    int min_x, min_y, max_x, max_y;
+    if (!worldLiveBounds(a, &min_x, &min_y, &max_x, &max_y))
+        return 1;
+    for (int y = min_y; y <= max_y; ++y) {
+        for (int x = min_x; x <= max_x; ++x) {
+            if (worldCellAlive(a, x, y) != worldCellAlive(b, x, y))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/// True if the worlds are the same and stay the same for 50 generations.
+static int sameWorlds(struct World *a, struct World *b) {
+    if (a->generation != b->generation || a->topology != b->topology || !lifeRuleEqual(&a->rule, &b->rule) ||
+        !sameCells(a, b))
+        return 0;
+    if (a->topology != TopologyUnbounded &&
+        (a->cols != b->cols || a->rows != b->rows || a->tl_cell_pos_x != b->tl_cell_pos_x ||
+         a->tl_cell_pos_y != b->tl_cell_pos_y))
+        return 0;
+    return worldStep(a, 50) && worldStep(b, 50) && a->generation == b->generation && sameCells(a, b);
+}
+
+/// Fills a 96x64 torus with a HighLife soup, each cell alive with
+/// probability 1/2.
+static struct World *createSoup() {
+    struct World *world = worldCreate();
+    if (!world || !worldSetRule(world, "B36/S23") || !worldSetTopology(world, TopologyTorus, 96, 64)) {
+        worldDestroy(world);
+        return NULL;
+    }
+
+    uint64_t state = 12345;
+    for (int r = 0; r < 64; ++r) {
+        for (int c = 0; c < 96; ++c) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            if (state >> 63)
+                worldToggleCell(world, c, r);
+        }
+    }
+    return world;
+}
+
+static void removeFiles() {
+    unlink(CHECKPOINT_FILE);
+    unlink(CHECKPOINT_FILE ".prev");
+    unlink(CHECKPOINT_FILE ".tmp");
+}
+
+/// Writes the world to file_name and resumes a new world from
+/// CHECKPOINT_FILE, which must come out the same as the world.
+static int checkRoundTrip(struct World *world, const char *file_name) {
+    struct Checkpoint checkpoint;
+    checkpointInit(&checkpoint);
+    int ok = checkpointCapture(&checkpoint, world) && checkpointWrite(&checkpoint, file_name);
+    checkpointFree(&checkpoint);
+
+    struct World *resumed = worldCreate();
+    ok = ok && resumed && checkpointResume(resumed, CHECKPOINT_FILE) && sameWorlds(world, resumed);
+    worldDestroy(resumed);
+    return ok;
+}
+
+int main(void) {
+
+    fprintf(stderr, "test_checkpoint: \n");
+    removeFiles();
+
+    // The cells, where they are, the generation, rule and topology come
+    // back, and the world carries on the same
+    struct World *world = worldCreate();
+    if (!world || !worldLoadFromFile(world, GUN_FILE) || !worldStep(world, 100) ||
+        !checkRoundTrip(world, CHECKPOINT_FILE)) {
+        fprintf(stderr, "test_checkpoint: unbounded gun    FAILED\n");
+        worldDestroy(world);
+        removeFiles();
+        return 1;
+    }
+    worldDestroy(world);
+
+    world = createSoup();
+    if (!world || !worldStep(world, 30) || !checkRoundTrip(world, CHECKPOINT_FILE)) {
+        fprintf(stderr, "test_checkpoint: HighLife torus soup    FAILED\n");
+        worldDestroy(world);
+        removeFiles();
+        return 2;
+    }
+
+    // A checkpoint with a flipped bit is skipped for the one it replaced,
+    // the gun's
+    FILE *file = fopen(CHECKPOINT_FILE, "r+b");
+    int byte = file && fseek(file, sizeof(struct CheckpointHeader) + 5, SEEK_SET) == 0 ? fgetc(file) : EOF;
+    int flipped = byte != EOF && fseek(file, sizeof(struct CheckpointHeader) + 5, SEEK_SET) == 0 &&
+                  fputc(byte ^ 0x10, file) != EOF;
+    if (file)
+        fclose(file);
+    struct World *resumed = worldCreate();
+    if (!flipped || !resumed || !checkpointResume(resumed, CHECKPOINT_FILE) || resumed->generation != 100) {
+        fprintf(stderr, "test_checkpoint: corrupt checkpoint    FAILED\n");
+        worldDestroy(world);
+        worldDestroy(resumed);
+        removeFiles();
+        return 3;
+    }
+    worldDestroy(resumed);
+
+    // A whole temp file left by a crash before its rename is the newest
+    if (!worldStep(world, 10) || !checkRoundTrip(world, CHECKPOINT_FILE ".tmp")) {
+        fprintf(stderr, "test_checkpoint: resume from temp file    FAILED\n");
+        worldDestroy(world);
+        removeFiles();
+        return 4;
+    }
+    worldDestroy(world);
+    removeFiles();
+
+    // Checkpoints submitted faster than they are written replace the one
+    // waiting, and the last is written before the thread stops
+    world = createSoup();
+    struct Checkpointer *checkpointer = checkpointerCreate(CHECKPOINT_FILE);
+    int submitted = world && checkpointer;
+    for (int i = 0; submitted && i < 20; ++i)
+        submitted = worldStep(world, 5) && checkpointerSubmit(checkpointer, world);
+    checkpointerDestroy(checkpointer);
+    resumed = worldCreate();
+    if (!submitted || !resumed || !checkpointResume(resumed, CHECKPOINT_FILE) || !sameWorlds(world, resumed)) {
+        fprintf(stderr, "test_checkpoint: checkpointerSubmit    FAILED\n");
+        worldDestroy(world);
+        worldDestroy(resumed);
+        removeFiles();
+        return 5;
+    }
+    worldDestroy(world);
+    worldDestroy(resumed);
+    removeFiles();
+
+    fprintf(stderr, "test_checkpoint: All tests PASSED\n");
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "edit_queue.h"
+#include "world.h"
+
+#define PRODUCERS 4
+#define EDITS_PER_PRODUCER 20000
+
+struct Producer {
+    struct EditQueue *queue;
+    int row;
+};
+
+/// Sets a row of cells alive, one edit at a time, trying again while the
+/// queue is full.
+static void *produceEdits(void *arg) {
+    struct Producer *producer = arg;
+    for (int i = 0; i < EDITS_PER_PRODUCER; ++i) {
+        struct WorldEdit edit = {EditSet, i, producer->row, 1, 1, 1, NULL, 0, 0};
+        while (!editQueuePush(producer->queue, &edit))
+            ;
+    }
+    return NULL;
+}
+
+int main(void) {
+
+    fprintf(stderr, "test_edit_queue: \n");
+
+    struct World *world = worldCreate();
+    struct EditQueue *queue = editQueueCreate(8);
+    if (!world || !queue) {
+        fprintf(stderr, "test_edit_queue: editQueueCreate    FAILED\n");
+        worldDestroy(world);
+        editQueueDestroy(queue);
+        return 1;
+    }
+
+    // Every kind of edit, applied in the order pushed
+    unsigned char *glider = malloc(9);
+    const unsigned char glider_cells[9] = {0, 1, 0, 0, 0, 1, 1, 1, 1};
+    for (int i = 0; i < 9; ++i)
+        glider[i] = glider_cells[i];
+    struct WorldEdit edits[] = {
+        {EditSet, 100, 100, 1, 1, 1, NULL, 0, 0},
+        {EditToggle, 100, 100, 1, 1, 1, NULL, 0, 0},
+        {EditToggle, -50, -40, 1, 1, 1, NULL, 0, 0},
+        {EditStamp, 10, 10, 3, 3, 1, glider, 1, 0},
+        {EditSet, 12, 12, 1, 1, 0, NULL, 0, 0},
+        {EditClearRegion, -60, -60, 20, 30, 0, NULL, 0, 0},
+    };
+    for (int i = 0; i < 6; ++i) {
+        if (!editQueuePush(queue, &edits[i])) {
+            fprintf(stderr, "test_edit_queue: editQueuePush    FAILED\n");
+            worldDestroy(world);
+            editQueueDestroy(queue);
+            return 2;
+        }
+    }
+    unsigned int applied = 0;
+    int ok = editQueueDrain(queue, world, &applied) && applied == 6;
+    ok = ok && worldPopulation(world) == 4 && !worldCellAlive(world, 100, 100) &&
+         !worldCellAlive(world, -50, -40) && worldCellAlive(world, 11, 10) && worldCellAlive(world, 12, 11) &&
+         !worldCellAlive(world, 12, 12) && worldCellAlive(world, 10, 12);
+    if (!ok) {
+        fprintf(stderr, "test_edit_queue: editQueueDrain    FAILED\n");
+        worldDestroy(world);
+        editQueueDestroy(queue);
+        return 3;
+    }
+
+    // A full queue refuses edits rather than waiting
+    struct WorldEdit set = {EditSet, 0, 0, 1, 1, 1, NULL, 0, 0};
+    unsigned int pushed = 0;
+    while (pushed < 100 && editQueuePush(queue, &set))
+        ++pushed;
+    ok = pushed == 8 && editQueueDrain(queue, world, &applied) && applied == 8 && editQueuePush(queue, &set);
+    ok = ok && editQueueDrain(queue, world, &applied) && applied == 1;
+    if (!ok) {
+        fprintf(stderr, "test_edit_queue: full queue    FAILED\n");
+        worldDestroy(world);
+        editQueueDestroy(queue);
+        return 4;
+    }
+
+    // Edits for a later generation wait for it
+    worldClear(world);
+    struct WorldEdit later = {EditSet, 5, 5, 1, 1, 1, NULL, 0, 3};
+    struct WorldEdit now = {EditSet, 9, 9, 1, 1, 1, NULL, 0, 0};
+    editQueuePush(queue, &later);
+    editQueuePush(queue, &now);
+    ok = editQueueDrain(queue, world, &applied) && applied == 1 && worldCellAlive(world, 9, 9) &&
+         !worldCellAlive(world, 5, 5);
+    world->generation = 3;
+    ok = ok && editQueueDrain(queue, world, &applied) && applied == 1 && worldCellAlive(world, 5, 5);
+    if (!ok) {
+        fprintf(stderr, "test_edit_queue: at_generation    FAILED\n");
+        worldDestroy(world);
+        editQueueDestroy(queue);
+        return 5;
+    }
+    editQueueDestroy(queue);
+
+    // Edits pushed from several threads at once are all applied once
+    worldClear(world);
+    queue = editQueueCreate(64);
+    struct Producer producers[PRODUCERS];
+    pthread_t threads[PRODUCERS];
+    for (int i = 0; i < PRODUCERS; ++i) {
+        producers[i].queue = queue;
+        producers[i].row = 2 * i;
+        pthread_create(&threads[i], NULL, produceEdits, &producers[i]);
+    }
+    unsigned int total = 0;
+    ok = queue != NULL;
+    while (ok && total < PRODUCERS * EDITS_PER_PRODUCER) {
+        ok = editQueueDrain(queue, world, &applied);
+        total += applied;
+    }
+    for (int i = 0; i < PRODUCERS; ++i)
+        pthread_join(threads[i], NULL);
+    ok = ok && editQueueDrain(queue, world, &applied) && applied == 0 &&
+         worldPopulation(world) == PRODUCERS * EDITS_PER_PRODUCER;
+    if (!ok) {
+        fprintf(stderr, "test_edit_queue: concurrent editQueuePush    FAILED\n");
+        worldDestroy(world);
+        editQueueDestroy(queue);
+        return 6;
+    }
+
+    worldDestroy(world);
+    editQueueDestroy(queue);
+
+    fprintf(stderr, "test_edit_queue: All tests PASSED\n");
+    return 0;
+}
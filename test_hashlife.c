@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "hashlife.h"
+#include "world.h"
+
+int main(void) {
+
+    fprintf(stderr, "test_hashlife: \n");
+
+    // A glider moves one cell diagonally every four generations.
+    unsigned char glider[] = {0, 1, 0,
+                              0, 0, 1,
+                              1, 1, 1};
+    struct HashLife *hashlife = hashLifeCreate();
+    if (!hashlife || !hashLifeSetCells(hashlife, glider, 3, 3, 3, 0, 0)) {
+        fprintf(stderr, "test_hashlife: hashLifeSetCells    FAILED\n");
+        hashLifeDestroy(hashlife);
+        return 1;
+    }
+
+    if (!hashLifeStep(hashlife, 12)) {
+        fprintf(stderr, "test_hashlife: hashLifeStep    FAILED\n");
+        hashLifeDestroy(hashlife);
+        return 2;
+    }
+
+    int64_t min_x, min_y, max_x, max_y;
+    unsigned char moved[9];
+    if (!hashLifeBounds(hashlife, &min_x, &min_y, &max_x, &max_y) ||
+        min_x != 1024 || min_y != 1024 || max_x != 1026 || max_y != 1026) {
+        fprintf(stderr, "test_hashlife: glider is not at (1024, 1024) after 4096 generations\n");
+        fprintf(stderr, "test_hashlife: hashLifeBounds    FAILED\n");
+        hashLifeDestroy(hashlife);
+        return 3;
+    }
+
+    hashLifeGetCells(hashlife, moved, 3, 3, 3, 1024, 1024);
+    for (int i = 0; i < 9; ++i) {
+        if (moved[i] != glider[i]) {
+            fprintf(stderr, "test_hashlife: hashLifeGetCells    FAILED\n");
+            hashLifeDestroy(hashlife);
+            return 4;
+        }
+    }
+    hashLifeDestroy(hashlife);
+
+    // The gosper glider gun adds one five cell glider every 30 generations.
+    struct World *world = worldCreate();
+    if (!world || !worldLoadFromFile(world, "../resources/examples/gosper_glider_gun.txt")) {
+        fprintf(stderr, "test_hashlife: worldLoadFromFile    FAILED\n");
+        worldDestroy(world);
+        return 5;
+    }
+
+    hashlife = hashLifeCreate();
+    if (!hashlife || !hashLifeSetCells(hashlife, world->cells, world->rows, world->cols, world->stride, 0, 0)) {
+        fprintf(stderr, "test_hashlife: hashLifeSetCells    FAILED\n");
+        hashLifeDestroy(hashlife);
+        worldDestroy(world);
+        return 6;
+    }
+    worldDestroy(world);
+
+    if (!hashLifeAdvance(hashlife, 1000000000ull)) {
+        fprintf(stderr, "test_hashlife: hashLifeAdvance    FAILED\n");
+        hashLifeDestroy(hashlife);
+        return 7;
+    }
+    uint64_t population = hashLifePopulation(hashlife);
+
+    // and carries on the same once the nodes it no longer uses are freed
+    uint64_t num_nodes = hashlife->num_nodes;
+    if (!hashLifeCollect(hashlife) || hashlife->num_nodes >= num_nodes || !hashLifeAdvance(hashlife, 30) ||
+        hashLifePopulation(hashlife) != population + 5 || hashlife->generation != 1000000030ull) {
+        fprintf(stderr, "test_hashlife: gun population %lu does not grow by one glider every 30 generations\n",
+                (unsigned long) population);
+        fprintf(stderr, "test_hashlife: hashLifeAdvance gun    FAILED\n");
+        hashLifeDestroy(hashlife);
+        return 8;
+    }
+
+    hashLifeDestroy(hashlife);
+
+    // A world stepped with the hashlife engine keeps the quadtree, so the
+    // gun can be stepped a billion generations, far past the size of the
+    // dense cells. 10^9 - 340 is a whole number of periods of the gun, so
+    // the gun and the first gliders match the dense engine at 340, and the
+    // gliders fly a cell down and right every 4 generations.
+    struct World *dense = worldCreate();
+    world = worldCreate();
+    if (!dense || !world || !worldLoadFromFile(dense, "../resources/examples/gosper_glider_gun.txt") ||
+        !worldLoadFromFile(world, "../resources/examples/gosper_glider_gun.txt")) {
+        fprintf(stderr, "test_hashlife: worldLoadFromFile    FAILED\n");
+        worldDestroy(dense);
+        worldDestroy(world);
+        return 9;
+    }
+    world->engine = EngineHashLife;
+
+    uint64_t generations = 1000000000ull;
+    uint64_t moved_periods = (generations - 340) / 30;
+    int dense_min_x, dense_min_y, dense_max_x, dense_max_y;
+    int world_min_x, world_min_y, world_max_x, world_max_y;
+    if (!worldStep(dense, 340) || !worldStep(world, generations) || world->generation != generations ||
+        world->current != CellsHashLife || world->cells ||
+        worldPopulation(world) != worldPopulation(dense) + 5 * moved_periods ||
+        !worldLiveBounds(dense, &dense_min_x, &dense_min_y, &dense_max_x, &dense_max_y) ||
+        !worldLiveBounds(world, &world_min_x, &world_min_y, &world_max_x, &world_max_y) ||
+        world_min_x != dense_min_x || world_min_y != dense_min_y ||
+        world_max_x != dense_max_x + (int) (moved_periods * 30 / 4) ||
+        world_max_y != dense_max_y + (int) (moved_periods * 30 / 4)) {
+        fprintf(stderr, "test_hashlife: worldStep gun a billion generations    FAILED\n");
+        worldDestroy(dense);
+        worldDestroy(world);
+        return 10;
+    }
+    for (int y = dense_min_y; y <= dense_max_y; ++y) {
+        for (int x = dense_min_x; x <= dense_max_x; ++x) {
+            if (worldCellAlive(world, x, y) != worldCellAlive(dense, x, y)) {
+                fprintf(stderr, "test_hashlife: gun differs from the dense engine at (%d, %d)\n", x, y);
+                fprintf(stderr, "test_hashlife: worldStep gun a billion generations    FAILED\n");
+                worldDestroy(dense);
+                worldDestroy(world);
+                return 11;
+            }
+        }
+    }
+    worldDestroy(dense);
+    worldDestroy(world);
+
+    fprintf(stderr, "test_hashlife: ALL TESTS PASSED\n");
+    return 0;
+}
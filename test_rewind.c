@@ -0,0 +1,159 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "rewind.h"
+#include "world.h"
+
+#define GUN_FILE "../resources/examples/gosper_glider_gun.txt"
+
+/// True if both worlds have the same live cells in world coords.
+static int sameCells(struct World *a, struct World *b) {
+    if (worldPopulation(a) != worldPopulation(b))
+        return 0;
+
+    int min_x, min_y, max_x, max_y;
+    if (!worldLiveBounds(a, &min_x, &min_y, &max_x, &max_y))
+        return 1;
+    for (int y = min_y; y <= max_y; ++y) {
+        for (int x = min_x; x <= max_x; ++x) {
+            if (worldCellAlive(a, x, y) != worldCellAlive(b, x, y))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/// Fills a 128x128 torus with a soup, each cell alive with probability 1/2.
+static struct World *createSoup() {
+    struct World *world = worldCreate();
+    if (!world || !worldSetTopology(world, TopologyTorus, 128, 128)) {
+        worldDestroy(world);
+        return NULL;
+    }
+
+    uint64_t state = 12345;
+    for (int r = 0; r < 128; ++r) {
+        for (int c = 0; c < 128; ++c) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            if (state >> 63)
+                worldToggleCell(world, c, r);
+        }
+    }
+    return world;
+}
+
+/// Updates the world generations times, recording each generation.
+static int stepRecorded(struct World *world, struct RewindRing *ring, unsigned int generations) {
+    for (unsigned int i = 0; i < generations; ++i) {
+        if (!worldUpdate(world) || !rewindRingRecord(ring, world))
+            return 0;
+    }
+    return 1;
+}
+
+/// True if the world was sought to the generation of the reference, which
+/// is updated there from its first generation.
+static int checkSeek(struct RewindRing *ring, struct World *world, struct World *reference, uint64_t generation) {
+    while (reference->generation < generation) {
+        if (!worldUpdate(reference))
+            return 0;
+    }
+    return rewindRingSeek(ring, world, generation) && world->generation == generation &&
+           sameCells(world, reference);
+}
+
+int main(void) {
+
+    fprintf(stderr, "test_rewind: \n");
+
+    struct World *world = worldCreate();
+    struct World *reference = worldCreate();
+    struct RewindRing *ring = rewindRingCreate(1000, 16, DEFAULT_REWIND_BYTES);
+    if (!world || !reference || !ring || !worldLoadFromFile(world, GUN_FILE) ||
+        !worldLoadFromFile(reference, GUN_FILE)) {
+        fprintf(stderr, "test_rewind: rewindRingCreate    FAILED\n");
+        worldDestroy(world);
+        worldDestroy(reference);
+        rewindRingDestroy(ring);
+        return 1;
+    }
+
+    // Seeking back decodes from the keyframe before the generation
+    if (!rewindRingRecord(ring, world) || !stepRecorded(world, ring, 300) ||
+        !checkSeek(ring, world, reference, 137)) {
+        fprintf(stderr, "test_rewind: rewindRingSeek    FAILED\n");
+        worldDestroy(world);
+        worldDestroy(reference);
+        rewindRingDestroy(ring);
+        return 2;
+    }
+
+    // The frames after it were dropped, and the world is recorded again
+    // from there
+    if (ring->num_frames != 138 || !stepRecorded(world, ring, 100) || !checkSeek(ring, world, reference, 200) ||
+        !checkSeek(ring, world, reference, 200) || rewindRingSeek(ring, world, 201) != 1 ||
+        world->generation != 200) {
+        fprintf(stderr, "test_rewind: record after rewindRingSeek    FAILED\n");
+        worldDestroy(world);
+        worldDestroy(reference);
+        rewindRingDestroy(ring);
+        return 3;
+    }
+
+    // An edit is recorded at the generation it was made, and seeking finds
+    // it rather than the generation before the edit
+    worldSetCellAt(world, -20, -20, 1);
+    worldSetCellAt(reference, -20, -20, 1);
+    if (!rewindRingRecord(ring, world) || !stepRecorded(world, ring, 10) ||
+        !checkSeek(ring, world, reference, 200)) {
+        fprintf(stderr, "test_rewind: rewindRingSeek to an edit    FAILED\n");
+        worldDestroy(world);
+        worldDestroy(reference);
+        rewindRingDestroy(ring);
+        return 4;
+    }
+    rewindRingDestroy(ring);
+    worldDestroy(world);
+    worldDestroy(reference);
+
+    // Only the newest frames are kept, whole keyframe groups at a time,
+    // and older generations are not sought
+    world = worldCreate();
+    reference = worldCreate();
+    ring = rewindRingCreate(50, 16, DEFAULT_REWIND_BYTES);
+    uint64_t oldest = 0;
+    if (!world || !reference || !ring || !worldLoadFromFile(world, GUN_FILE) ||
+        !worldLoadFromFile(reference, GUN_FILE) || !stepRecorded(world, ring, 300) || ring->num_frames > 50 ||
+        !rewindRingOldest(ring, &oldest) || oldest < 300 - 50 || rewindRingSeek(ring, world, oldest - 1) ||
+        world->generation != 300 || !checkSeek(ring, world, reference, oldest)) {
+        fprintf(stderr, "test_rewind: rewindRingCreate of 50 frames    FAILED\n");
+        worldDestroy(world);
+        worldDestroy(reference);
+        rewindRingDestroy(ring);
+        return 5;
+    }
+    rewindRingDestroy(ring);
+    worldDestroy(world);
+    worldDestroy(reference);
+
+    // A soup changes too many cells to list them, its frames are a bit per
+    // cell. Groups are dropped to keep the bytes in budget.
+    world = createSoup();
+    reference = createSoup();
+    ring = rewindRingCreate(1000, 8, 16 * 1024);
+    if (!world || !reference || !ring || !rewindRingRecord(ring, world) || !ring->frames[0].packed ||
+        !stepRecorded(world, ring, 200) || ring->bytes > 16 * 1024 || !rewindRingOldest(ring, &oldest) ||
+        !checkSeek(ring, world, reference, oldest)) {
+        fprintf(stderr, "test_rewind: torus soup in 16 KB    FAILED\n");
+        worldDestroy(world);
+        worldDestroy(reference);
+        rewindRingDestroy(ring);
+        return 6;
+    }
+    rewindRingDestroy(ring);
+    worldDestroy(world);
+    worldDestroy(reference);
+
+    fprintf(stderr, "test_rewind: All tests PASSED\n");
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "shard.h"
+#include "world.h"
+
+/// True if both worlds have the same live cells in world coords.
+static int sameCells(struct World *a, struct World *b) {
+    if (worldPopulation(a) != worldPopulation(b))
+        return 0;
+
+    int min_x, min_y, max_x, max_y;
+    if (!worldLiveBounds(a, &min_x, &min_y, &max_x, &max_y))
+        return 1;
+    for (int y = min_y; y <= max_y; ++y) {
+        for (int x = min_x; x <= max_x; ++x) {
+            if (worldCellAlive(a, x, y) != worldCellAlive(b, x, y))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/// Fills a cols x rows world with a soup, each cell alive with probability
+/// 1/2.
+static struct World *createSoup(enum WorldTopology topology, unsigned int cols, unsigned int rows,
+                                enum WorldEngine engine) {
+    struct World *world = worldCreate();
+    if (!world)
+        return NULL;
+
+    world->engine = engine;
+    if (!worldSetTopology(world, topology, cols, rows)) {
+        worldDestroy(world);
+        return NULL;
+    }
+
+    uint64_t state = 12345;
+    for (unsigned int r = 0; r < rows; ++r) {
+        for (unsigned int c = 0; c < cols; ++c) {
+            state = state * 6364136223846793005ull + 1442695040888963407ull;
+            if (state >> 63)
+                worldToggleCell(world, (int) c, (int) r);
+        }
+    }
+    return world;
+}
+
+/// Steps a copy of the world in shards and the world itself, and compares
+/// the cells and stats.
+static int checkSharded(struct World *world, struct World *copy, unsigned int num_workers, unsigned int halo,
+                        uint64_t generations) {
+    struct ShardCluster *cluster = shardClusterCreate(num_workers, halo);
+    if (!cluster)
+        return 0;
+
+    int ok = shardClusterLoad(cluster, copy) && shardClusterStep(cluster, generations);
+    ok = ok && worldStep(world, generations) && cluster->population == worldPopulation(world);
+
+    int min_x, min_y, max_x, max_y;
+    if (ok && worldLiveBounds(world, &min_x, &min_y, &max_x, &max_y) && world->topology != TopologyTorus) {
+        ok = cluster->live_min_x == min_x && cluster->live_min_y == min_y &&
+             cluster->live_max_x == max_x && cluster->live_max_y == max_y;
+    }
+
+    ok = ok && shardClusterGather(cluster, copy) && copy->generation == world->generation && sameCells(world, copy);
+    shardClusterDestroy(cluster);
+    return ok;
+}
+
+int main(void) {
+
+    fprintf(stderr, "test_shard: \n");
+
+    // The gun fires gliders off the domain, which is moved to fit them
+    struct World *world = worldCreate();
+    struct World *copy = worldCreate();
+    if (!world || !copy || !worldLoadFromFile(world, "../resources/examples/gosper_glider_gun.txt") ||
+        !worldLoadFromFile(copy, "../resources/examples/gosper_glider_gun.txt")) {
+        fprintf(stderr, "test_shard: worldLoadFromFile    FAILED\n");
+        worldDestroy(world);
+        worldDestroy(copy);
+        return 1;
+    }
+
+    if (!checkSharded(world, copy, 3, 1, 400)) {
+        fprintf(stderr, "test_shard: unbounded gun on 3 shards    FAILED\n");
+        worldDestroy(world);
+        worldDestroy(copy);
+        return 2;
+    }
+
+    // Deeper halos step several generations between exchanges, including
+    // a last batch shorter than the halo
+    if (!checkSharded(world, copy, 2, 5, 333)) {
+        fprintf(stderr, "test_shard: unbounded gun with halos of 5 rows    FAILED\n");
+        worldDestroy(world);
+        worldDestroy(copy);
+        return 3;
+    }
+    worldDestroy(world);
+    worldDestroy(copy);
+
+    // The first and last shards of a torus are neighbours, a bounded world
+    // has no halo past its edges
+    enum WorldTopology topologies[] = {TopologyTorus, TopologyBounded};
+    enum WorldEngine engines[] = {EngineDense, EngineBitPacked, EngineLookupTable};
+    for (int t = 0; t < 2; ++t) {
+        for (int e = 0; e < 3; ++e) {
+            for (unsigned int num_workers = 1; num_workers <= 4; num_workers += 3) {
+                world = createSoup(topologies[t], 150, 61, engines[e]);
+                copy = createSoup(topologies[t], 150, 61, engines[e]);
+                if (!world || !copy || !checkSharded(world, copy, num_workers, 3, 100)) {
+                    fprintf(stderr, "test_shard: %s soup with engine %d on %u shards    FAILED\n",
+                            t == 0 ? "torus" : "bounded", e, num_workers);
+                    worldDestroy(world);
+                    worldDestroy(copy);
+                    return 4;
+                }
+                worldDestroy(world);
+                worldDestroy(copy);
+            }
+        }
+    }
+
+    // A bit packed world that has been stepped keeps its cells packed
+    world = createSoup(TopologyTorus, 64, 64, EngineBitPacked);
+    copy = createSoup(TopologyTorus, 64, 64, EngineBitPacked);
+    if (!world || !copy || !worldUpdate(world) || !worldUpdate(copy) || !checkSharded(world, copy, 2, 3, 50)) {
+        fprintf(stderr, "test_shard: stepped bit packed soup    FAILED\n");
+        worldDestroy(world);
+        worldDestroy(copy);
+        return 5;
+    }
+    worldDestroy(world);
+    worldDestroy(copy);
+
+    fprintf(stderr, "test_shard: All tests PASSED\n");
+    return 0;
+}
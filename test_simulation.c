@@ -0,0 +1,209 @@
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "simulation.h"
+#include "world.h"
+
+static const unsigned char glider[9] = {0, 1, 0, 0, 0, 1, 1, 1, 1};
+
+/// True if both worlds have the same live cells in world coords.
+static int sameCells(struct World *a, struct World *b) {
+    if (worldPopulation(a) != worldPopulation(b))
+        return 0;
+
+    int min_x, min_y, max_x, max_y;
+    if (!worldLiveBounds(a, &min_x, &min_y, &max_x, &max_y))
+        return 1;
+    for (int y = min_y; y <= max_y; ++y) {
+        for (int x = min_x; x <= max_x; ++x) {
+            if (worldCellAlive(a, x, y) != worldCellAlive(b, x, y))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/// Reads snapshots while the simulation publishes them. Each must hold as
+/// many live cells as its population, and come no earlier than the last.
+/// Returns NULL if they all do.
+static void *readSnapshots(void *arg) {
+    struct Simulation *simulation = arg;
+    uint64_t generation = 0;
+    for (int i = 0; i < 2000; ++i) {
+        struct WorldSnapshot *snapshot = snapshotAcquire(simulation->snapshots);
+        if (!snapshot || snapshot->generation < generation) {
+            snapshotRelease(snapshot);
+            return arg;
+        }
+
+        uint64_t population = 0;
+        for (size_t c = 0; c < (size_t) snapshot->cols * snapshot->rows; ++c)
+            population += snapshot->cells[c] != 0;
+        generation = snapshot->generation;
+        int consistent = population == snapshot->population;
+        snapshotRelease(snapshot);
+        if (!consistent)
+            return arg;
+    }
+    return NULL;
+}
+
+int main(void) {
+
+    fprintf(stderr, "test_simulation: \n");
+
+    struct World *world = worldCreate();
+    if (!world || !worldLoadFromFile(world, "../resources/examples/gosper_glider_gun.txt")) {
+        fprintf(stderr, "test_simulation: worldLoadFromFile    FAILED\n");
+        worldDestroy(world);
+        return 1;
+    }
+
+    // The world is updated on the simulation thread at its update rate
+    world->update_rate.ticks_per_sec = 1000.0f;
+    struct Simulation *simulation = simulationCreate(world);
+    if (!simulation) {
+        fprintf(stderr, "test_simulation: simulationCreate    FAILED\n");
+        worldDestroy(world);
+        return 2;
+    }
+    usleep(200000);
+
+    // and not while another thread holds the lock
+    simulationLock(simulation);
+    uint64_t generation = world->generation;
+    usleep(50000);
+    int held = world->generation == generation;
+    simulationUnlock(simulation);
+    if (generation < 10 || !held) {
+        fprintf(stderr, "test_simulation: simulationLock    FAILED\n");
+        simulationDestroy(simulation);
+        worldDestroy(world);
+        return 3;
+    }
+
+    // Generations the other thread waits for do not starve it of the lock
+    for (int i = 0; i < 100; ++i) {
+        simulationLock(simulation);
+        simulationUnlock(simulation);
+    }
+
+    // The latest snapshot is the world as it is between generations
+    simulationLock(simulation);
+    struct WorldSnapshot *snapshot = snapshotAcquire(simulation->snapshots);
+    int matches = snapshot && snapshot->generation == world->generation &&
+                  snapshot->population == worldPopulation(world);
+    for (int y = -5; matches && y < 50; ++y) {
+        for (int x = -5; x < 50; ++x)
+            matches = matches && snapshotCellAlive(snapshot, x, y) == worldCellAlive(world, x, y);
+    }
+    snapshotRelease(snapshot);
+
+    // and edits are published by the editing thread
+    worldToggleCellAt(world, -20, -20);
+    matches = matches && simulationPublish(simulation);
+    snapshot = snapshotAcquire(simulation->snapshots);
+    matches = matches && snapshotCellAlive(snapshot, -20, -20);
+    snapshotRelease(snapshot);
+    worldToggleCellAt(world, -20, -20);
+    matches = matches && simulationPublish(simulation);
+    simulationUnlock(simulation);
+    if (!matches) {
+        fprintf(stderr, "test_simulation: snapshotAcquire    FAILED\n");
+        simulationDestroy(simulation);
+        worldDestroy(world);
+        return 4;
+    }
+
+    // Readers on other threads never see a snapshot being rewritten, and a
+    // held snapshot is not reused
+    pthread_t readers[3];
+    for (int i = 0; i < 3; ++i)
+        pthread_create(&readers[i], NULL, readSnapshots, simulation);
+    snapshot = snapshotAcquire(simulation->snapshots);
+    uint64_t held_generation = snapshot->generation;
+    int consistent = 1;
+    for (int i = 0; i < 3; ++i) {
+        void *failed;
+        pthread_join(readers[i], &failed);
+        consistent = consistent && !failed;
+    }
+    consistent = consistent && snapshot->generation == held_generation;
+    snapshotRelease(snapshot);
+    if (!consistent) {
+        fprintf(stderr, "test_simulation: concurrent snapshots    FAILED\n");
+        simulationDestroy(simulation);
+        worldDestroy(world);
+        return 5;
+    }
+
+    // Paused worlds are not updated
+    simulationLock(simulation);
+    world->updates_paused = 1;
+    generation = world->generation;
+    simulationUnlock(simulation);
+    usleep(50000);
+    simulationLock(simulation);
+    held = world->generation == generation;
+    world->updates_paused = 0;
+    simulationUnlock(simulation);
+    if (!held) {
+        fprintf(stderr, "test_simulation: updates_paused    FAILED\n");
+        simulationDestroy(simulation);
+        worldDestroy(world);
+        return 6;
+    }
+
+    // A queued edit lands on the generation it was pushed for, wherever the
+    // simulation thread is when it is pushed
+    simulationLock(simulation);
+    uint64_t stamp_generation = world->generation + 20;
+    simulationUnlock(simulation);
+    struct WorldEdit stamp = {EditStamp, -100, -100, 3, 3, 1, (unsigned char *) glider, 0, stamp_generation};
+    int pushed = editQueuePush(simulation->edits, &stamp);
+    for (int i = 0; i < 200; ++i) {
+        simulationLock(simulation);
+        generation = world->generation;
+        simulationUnlock(simulation);
+        if (generation > stamp_generation + 10)
+            break;
+        usleep(10000);
+    }
+    if (!pushed || generation <= stamp_generation + 10) {
+        fprintf(stderr, "test_simulation: editQueuePush    FAILED\n");
+        simulationDestroy(simulation);
+        worldDestroy(world);
+        return 7;
+    }
+
+    // The thread stops without waiting out a slow tick
+    simulationLock(simulation);
+    world->update_rate.ticks_per_sec = 0.5f;
+    simulationUnlock(simulation);
+    usleep(50000);
+    unsigned long start = timeNow();
+    simulationDestroy(simulation);
+    if (timeNow() - start > 500000) {
+        fprintf(stderr, "test_simulation: simulationDestroy    FAILED\n");
+        worldDestroy(world);
+        return 8;
+    }
+
+    // The simulated generations match a serial run with the glider
+    // stamped at the same generation
+    struct World *serial = worldCreate();
+    int same = serial && worldLoadFromFile(serial, "../resources/examples/gosper_glider_gun.txt") &&
+               worldStep(serial, stamp_generation) && worldStampAt(serial, -100, -100, 3, 3, glider) &&
+               worldStep(serial, world->generation - stamp_generation) && sameCells(serial, world);
+    worldDestroy(serial);
+    worldDestroy(world);
+    if (!same) {
+        fprintf(stderr, "test_simulation: simulated generations    FAILED\n");
+        return 9;
+    }
+
+    fprintf(stderr, "test_simulation: All tests PASSED\n");
+    return 0;
+}
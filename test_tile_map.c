@@ -0,0 +1,133 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "tile_map.h"
+#include "world.h"
+
+#define TILE_FILE "test_tile_map.tiles"
+
+/// True if both maps have the same live cells.
+static int sameTiles(struct TileMap *a, struct TileMap *b) {
+    if (tileMapPopulation(a) != tileMapPopulation(b))
+        return 0;
+
+    int64_t min_x, min_y, max_x, max_y;
+    if (!tileMapBounds(a, &min_x, &min_y, &max_x, &max_y))
+        return 1;
+    for (int64_t y = min_y; y <= max_y; ++y) {
+        for (int64_t x = min_x; x <= max_x; ++x) {
+            if (tileMapCell(a, x, y) != tileMapCell(b, x, y))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+static int stepTiles(struct TileMap *tiles, unsigned int generations) {
+    for (unsigned int i = 0; i < generations; ++i) {
+        if (!tileMapStep(tiles, NULL))
+            return 0;
+    }
+    return 1;
+}
+
+int main(void) {
+
+    fprintf(stderr, "test_tile_map: \n");
+
+    struct World *world = worldCreate();
+    if (!world || !worldLoadFromFile(world, "../resources/examples/gosper_glider_gun.txt")) {
+        fprintf(stderr, "test_tile_map: worldLoadFromFile    FAILED\n");
+        worldDestroy(world);
+        return 1;
+    }
+
+    // Tiles in a backing file step the same as tiles on the heap
+    unlink(TILE_FILE);
+    struct TileMap *heap = tileMapCreate();
+    struct TileMap *mapped = tileMapCreateMapped(TILE_FILE);
+    if (!heap || !mapped ||
+        !tileMapSetCells(heap, world->cells, world->rows, world->cols, world->stride, 0, 0) ||
+        !tileMapSetCells(mapped, world->cells, world->rows, world->cols, world->stride, 0, 0) ||
+        !stepTiles(heap, 500) || !stepTiles(mapped, 500) || !sameTiles(heap, mapped)) {
+        fprintf(stderr, "test_tile_map: tileMapCreateMapped    FAILED\n");
+        tileMapDestroy(heap);
+        tileMapDestroy(mapped);
+        worldDestroy(world);
+        unlink(TILE_FILE);
+        return 2;
+    }
+
+    // The population and bounds kept in the tile summaries match the world's,
+    // also once a cell on the edge of the bounds is cleared
+    int64_t min_x, min_y, max_x, max_y;
+    int world_min_x, world_min_y, world_max_x, world_max_y;
+    int summarised = worldStep(world, 500) && tileMapPopulation(heap) == worldPopulation(world) &&
+                     tileMapBounds(heap, &min_x, &min_y, &max_x, &max_y) &&
+                     worldLiveBounds(world, &world_min_x, &world_min_y, &world_max_x, &world_max_y) &&
+                     min_x == world_min_x && min_y == world_min_y && max_x == world_max_x && max_y == world_max_y;
+    uint64_t cleared = 0;
+    for (int64_t x = min_x; summarised && x <= max_x; ++x) {
+        if (!tileMapCell(heap, x, max_y))
+            continue;
+        ++cleared;
+        summarised = tileMapSetCell(heap, x, max_y, 0) && tileMapSetCell(mapped, x, max_y, 0) &&
+                     tileMapPopulation(heap) == worldPopulation(world) - cleared;
+    }
+    int64_t cleared_max_y = max_y;
+    if (!summarised || !tileMapBounds(heap, &min_x, &min_y, &max_x, &max_y) || max_y >= cleared_max_y ||
+        !sameTiles(heap, mapped)) {
+        fprintf(stderr, "test_tile_map: tileMapPopulation/tileMapBounds    FAILED\n");
+        tileMapDestroy(heap);
+        tileMapDestroy(mapped);
+        worldDestroy(world);
+        unlink(TILE_FILE);
+        return 6;
+    }
+    worldDestroy(world);
+
+    // The tiles, generation and rule are read back from the file
+    tileMapDestroy(mapped);
+    mapped = tileMapCreateMapped(TILE_FILE);
+    if (!mapped || mapped->generation != 500 || !lifeRuleEqual(&mapped->rule, &heap->rule) ||
+        !sameTiles(heap, mapped)) {
+        fprintf(stderr, "test_tile_map: reopened tile file    FAILED\n");
+        tileMapDestroy(heap);
+        tileMapDestroy(mapped);
+        unlink(TILE_FILE);
+        return 3;
+    }
+
+    // and carry on stepping, reusing the slots of tiles that died out
+    unsigned int num_slots = mapped->num_slots;
+    if (!stepTiles(heap, 300) || !stepTiles(mapped, 300) || !sameTiles(heap, mapped) ||
+        mapped->num_slots > num_slots + 64) {
+        fprintf(stderr, "test_tile_map: step reopened tile file    FAILED\n");
+        tileMapDestroy(heap);
+        tileMapDestroy(mapped);
+        unlink(TILE_FILE);
+        return 4;
+    }
+
+    tileMapDestroy(heap);
+    tileMapDestroy(mapped);
+    unlink(TILE_FILE);
+
+    // A file that is not a tile file is refused
+    FILE *file = fopen(TILE_FILE, "w");
+    if (file) {
+        fprintf(file, "not a tile file\n");
+        fclose(file);
+    }
+    mapped = tileMapCreateMapped(TILE_FILE);
+    unlink(TILE_FILE);
+    if (!file || mapped) {
+        fprintf(stderr, "test_tile_map: tileMapCreateMapped of another file    FAILED\n");
+        tileMapDestroy(mapped);
+        return 5;
+    }
+
+    fprintf(stderr, "test_tile_map: All tests PASSED\n");
+    return 0;
+}
@@ -1,9 +1,18 @@
+#define _GNU_SOURCE
+#include <sched.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
+#include <limits.h>
 
 #include "world.h"
 
+int worldsEqual(struct World *a, struct World *b);
+int worldsEqualAt(struct World *a, struct World *b);
+int engineMatchesDense(struct World *dense, struct World *other);
+int liveBoundsMatchCells(struct World *world);
+
 int main(void) {
 
     fprintf(stderr, "test_world: \n");
@@ -68,6 +77,475 @@ int main(void) {
 
     worldDestroy(world);
 
+    // Every engine must match the dense engine generation for generation
+    char gun_file[] = "../resources/examples/gosper_glider_gun.txt";
+    for (int engine = EngineBitPacked; engine <= EngineLookupTable; ++engine) {
+        struct World *dense = worldCreate();
+        struct World *other = worldCreate();
+        other->engine = engine;
+        if (!worldLoadFromFile(dense, gun_file) || !worldLoadFromFile(other, gun_file)) {
+            fprintf(stderr, "test_world: worldLoadFromFile  FAILED\n");
+            worldDestroy(dense);
+            worldDestroy(other);
+            return -1;
+        }
+
+        for (int i = 0; i < 200; ++i) {
+            // An edit halfway goes to whichever cells the engine keeps
+            if (i == 100 && (!worldToggleCellAt(dense, 20, 20) || !worldToggleCellAt(other, 20, 20))) {
+                fprintf(stderr, "test_world: worldToggleCellAt    FAILED\n");
+                worldDestroy(dense);
+                worldDestroy(other);
+                return -1;
+            }
+            if (!worldUpdate(dense) || !worldUpdate(other)) {
+                fprintf(stderr, "test_world: worldUpdate    FAILED\n");
+                worldDestroy(dense);
+                worldDestroy(other);
+                return -1;
+            }
+
+            // The bit packed, hashlife and sparse engines step their own
+            // cells without writing them back
+            if ((engine == EngineBitPacked && (other->current != CellsPacked || other->cells)) ||
+                (engine == EngineHashLife && (other->current != CellsHashLife || other->cells)) ||
+                (engine == EngineSparse && (other->current != CellsTiles || other->cells || other->packed))) {
+                fprintf(stderr, "test_world: engine %d unpacked its cells at generation %d\n", engine, i+1);
+                fprintf(stderr, "test_world: worldUpdate engine %d    FAILED\n", engine);
+                worldDestroy(dense);
+                worldDestroy(other);
+                return -1;
+            }
+
+            if (!engineMatchesDense(dense, other)) {
+                fprintf(stderr, "test_world: engine %d differs from EngineDense at generation %d\n", engine, i+1);
+                fprintf(stderr, "test_world: worldUpdate engine %d    FAILED\n", engine);
+                worldDestroy(dense);
+                worldDestroy(other);
+                return -1;
+            }
+        }
+
+        worldDestroy(dense);
+        worldDestroy(other);
+    }
+
+    // Updating in parallel bands must match the serial update, also with
+    // each band owned by a thread bound to a processor, which clears the
+    // band's rows as the world grows
+    char train_file[] = "../resources/examples/glider_train.txt";
+    for (int engine = EngineDense; engine <= EngineLookupTable; ++engine) {
+        if (engine == EngineHashLife || engine == EngineSparse)
+            continue;
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        sched_getaffinity(0, sizeof(allowed), &allowed);
+        struct World *serial = worldCreate();
+        struct World *parallel = worldCreate();
+        struct World *placed = worldCreate();
+        serial->engine = engine;
+        parallel->engine = engine;
+        placed->engine = engine;
+        if (!worldSetThreads(serial, 1) || !worldSetThreads(parallel, 4) || !worldSetThreads(placed, 4) ||
+            !worldSetPlacement(placed, 1, 1) || !worldLoadFromFile(serial, train_file) ||
+            !worldLoadFromFile(parallel, train_file) || !worldLoadFromFile(placed, train_file)) {
+            fprintf(stderr, "test_world: worldSetThreads/worldLoadFromFile  FAILED\n");
+            worldDestroy(serial);
+            worldDestroy(parallel);
+            worldDestroy(placed);
+            return -1;
+        }
+
+        for (int i = 0; i < 100; ++i) {
+            worldUpdate(serial);
+            worldUpdate(parallel);
+            worldUpdate(placed);
+        }
+
+        // Only the workers stay bound, the calling thread may run on every
+        // processor it could before
+        cpu_set_t after;
+        CPU_ZERO(&after);
+        sched_getaffinity(0, sizeof(after), &after);
+
+        if (!worldsEqual(serial, parallel) || !worldsEqual(serial, placed) ||
+            worldPopulation(placed) != worldPopulation(serial) || !CPU_EQUAL(&allowed, &after)) {
+            fprintf(stderr, "test_world: parallel update differs from serial update (engine %d)\n", engine);
+            fprintf(stderr, "test_world: worldUpdate parallel    FAILED\n");
+            worldDestroy(serial);
+            worldDestroy(parallel);
+            worldDestroy(placed);
+            return -1;
+        }
+
+        worldDestroy(serial);
+        worldDestroy(parallel);
+        worldDestroy(placed);
+    }
+
+    // Every engine must match the dense engine under other rules: HighLife,
+    // Day & Night and Seeds
+    const char *rules[] = {"B36/S23", "B3678/S34678", "b2/s"};
+    for (int i = 0; i < 3; ++i) {
+        for (int engine = EngineBitPacked; engine <= EngineLookupTable; ++engine) {
+            struct World *dense = worldCreate();
+            struct World *other = worldCreate();
+            other->engine = engine;
+            if (!worldLoadFromFile(dense, gun_file) || !worldLoadFromFile(other, gun_file) ||
+                !worldSetRule(dense, rules[i]) || !worldSetRule(other, rules[i])) {
+                fprintf(stderr, "test_world: worldSetRule  FAILED\n");
+                worldDestroy(dense);
+                worldDestroy(other);
+                return -1;
+            }
+
+            for (int g = 0; g < 60; ++g) {
+                worldUpdate(dense);
+                worldUpdate(other);
+            }
+
+            if (!engineMatchesDense(dense, other)) {
+                fprintf(stderr, "test_world: engine %d differs from EngineDense under %s\n", engine, rules[i]);
+                fprintf(stderr, "test_world: worldUpdate rule    FAILED\n");
+                worldDestroy(dense);
+                worldDestroy(other);
+                return -1;
+            }
+
+            worldDestroy(dense);
+            worldDestroy(other);
+        }
+    }
+
+    // B0 is rejected, and a saved rule is loaded back from the file header
+    struct World *saved = worldCreate();
+    struct World *loaded = worldCreate();
+    char rule_str[LIFE_RULE_MAX_CHARS];
+    if (worldSetRule(saved, "B03/S23") || !worldSetRule(saved, "S23/B36") ||
+        !worldLoadFromFile(saved, world_file_1) || !worldSaveToFile(saved, "test_world_rule.txt") ||
+        !worldLoadFromFile(loaded, "test_world_rule.txt") || !worldsEqual(saved, loaded)) {
+        fprintf(stderr, "test_world: worldSetRule/worldSaveToFile  FAILED\n");
+        worldDestroy(saved);
+        worldDestroy(loaded);
+        return -1;
+    }
+
+    lifeRuleToString(&loaded->rule, rule_str);
+    if (strcmp(rule_str, "B36/S23") != 0) {
+        fprintf(stderr, "test_world: loaded rule %s, expected B36/S23\n", rule_str);
+        fprintf(stderr, "test_world: worldLoadFromFile rule  FAILED\n");
+        worldDestroy(saved);
+        worldDestroy(loaded);
+        return -1;
+    }
+
+    worldDestroy(saved);
+    worldDestroy(loaded);
+
+    char glider_file[] = "../resources/tests/glider_1.txt";
+
+    // A glider crosses a 70 x 50 torus and is back where it started after
+    // 4 * lcm(70, 50) generations. A bounded world never changes size.
+    for (int engine = EngineDense; engine <= EngineLookupTable; ++engine) {
+        if (engine == EngineHashLife || engine == EngineSparse)
+            continue;
+        struct World *torus = worldCreate();
+        struct World *start = worldCreate();
+        struct World *bounded = worldCreate();
+        torus->engine = engine;
+        bounded->engine = engine;
+        if (!worldLoadFromFile(torus, glider_file) || !worldLoadFromFile(start, glider_file) ||
+            !worldLoadFromFile(bounded, glider_file) ||
+            !worldSetTopology(torus, TopologyTorus, 70, 50) || !worldSetTopology(start, TopologyTorus, 70, 50) ||
+            !worldSetTopology(bounded, TopologyBounded, 20, 20)) {
+            fprintf(stderr, "test_world: worldSetTopology  FAILED\n");
+            worldDestroy(torus);
+            worldDestroy(start);
+            worldDestroy(bounded);
+            return -1;
+        }
+
+        for (int i = 0; i < 1400; ++i) {
+            worldUpdate(torus);
+            worldUpdate(bounded);
+        }
+
+        if (!worldsEqual(torus, start) || bounded->rows != 20 || bounded->cols != 20) {
+            fprintf(stderr, "test_world: glider did not cross the torus (engine %d)\n", engine);
+            fprintf(stderr, "test_world: worldSetTopology    FAILED\n");
+            worldDestroy(torus);
+            worldDestroy(start);
+            worldDestroy(bounded);
+            return -1;
+        }
+
+        worldDestroy(torus);
+        worldDestroy(start);
+        worldDestroy(bounded);
+    }
+
+    // A glider repeats every 4 generations one cell down and right, and can
+    // then be moved a million generations ahead without stepping. A blinker
+    // repeats in place every 2 generations.
+    struct World *glider = worldCreate();
+    struct World *reference = worldCreate();
+    struct World *blinker = worldCreate();
+    glider->detect_period = 1;
+    glider->fast_forward = 1;
+    blinker->detect_period = 1;
+    struct WorldPeriod period;
+    if (!worldLoadFromFile(glider, glider_file) || !worldLoadFromFile(reference, glider_file) ||
+        !worldLoadFromFile(blinker, world_file_1) ||
+        !worldAdvance(glider, 10) || !worldAdvance(reference, 10) || !worldAdvance(blinker, 10) ||
+        !worldPeriod(glider, &period) || period.period != 4 || period.dx != 1 || period.dy != 1 ||
+        !worldAdvance(glider, 1000000) || glider->generation != 1000010 ||
+        glider->population != reference->population ||
+        !worldPeriod(blinker, &period) || period.period != 2 || period.dx != 0 || period.dy != 0) {
+        fprintf(stderr, "test_world: worldPeriod    FAILED\n");
+        worldDestroy(glider);
+        worldDestroy(reference);
+        worldDestroy(blinker);
+        return -1;
+    }
+
+    for (int r = 0; r < reference->rows; ++r) {
+        for (int c = 0; c < reference->cols; ++c) {
+            int x = c + reference->tl_cell_pos_x;
+            int y = r + reference->tl_cell_pos_y;
+            if (*worldCell(reference, c, r) != worldCellAlive(glider, x + 250000, y + 250000)) {
+                fprintf(stderr, "test_world: fast forwarded glider is not where it should be\n");
+                fprintf(stderr, "test_world: worldAdvance fast_forward    FAILED\n");
+                worldDestroy(glider);
+                worldDestroy(reference);
+                worldDestroy(blinker);
+                return -1;
+            }
+        }
+    }
+
+    worldDestroy(glider);
+    worldDestroy(reference);
+    worldDestroy(blinker);
+
+    // Compaction trims the dead cells a glider leaves behind without
+    // changing the live cells
+    struct World *grown = worldCreate();
+    struct World *compacted = worldCreate();
+    grown->compact_interval = 0;
+    compacted->compact_interval = 16;
+    if (!worldLoadFromFile(grown, glider_file) || !worldLoadFromFile(compacted, glider_file)) {
+        fprintf(stderr, "test_world: worldLoadFromFile  FAILED\n");
+        worldDestroy(grown);
+        worldDestroy(compacted);
+        return -1;
+    }
+
+    for (int i = 0; i < 1000; ++i) {
+        worldUpdate(grown);
+        worldUpdate(compacted);
+    }
+
+    unsigned int max_rows = (2 + 2 * 4) * compacted->block_rows;
+    unsigned int max_cols = (2 + 2 * 4) * compacted->block_cols;
+    if (!worldsEqualAt(grown, compacted) || compacted->rows > max_rows || compacted->cols > max_cols) {
+        fprintf(stderr, "test_world: compacted world is %u x %u cells\n", compacted->rows, compacted->cols);
+        fprintf(stderr, "test_world: worldCompact    FAILED\n");
+        worldDestroy(grown);
+        worldDestroy(compacted);
+        return -1;
+    }
+
+    worldDestroy(grown);
+    worldDestroy(compacted);
+
+    // The population and live bounds kept by each engine match a scan of
+    // the cells, also after killing a cell on the edge of the bounds
+    for (int engine = EngineDense; engine <= EngineLookupTable; ++engine) {
+        struct World *tracked = worldCreate();
+        tracked->engine = engine;
+        if (!worldLoadFromFile(tracked, train_file)) {
+            fprintf(stderr, "test_world: worldLoadFromFile  FAILED\n");
+            worldDestroy(tracked);
+            return -1;
+        }
+
+        for (int i = 0; i < 60; ++i) {
+            worldUpdate(tracked);
+            if (i == 30) {
+                int min_x, min_y, max_x, max_y;
+                worldLiveBounds(tracked, &min_x, &min_y, &max_x, &max_y);
+                for (int x = min_x; x <= max_x; ++x) {
+                    if (worldCellAlive(tracked, x, min_y))
+                        worldToggleCellAt(tracked, x, min_y);
+                }
+            }
+            if (!liveBoundsMatchCells(tracked)) {
+                fprintf(stderr, "test_world: live bounds differ from the cells (engine %d)\n", engine);
+                fprintf(stderr, "test_world: worldLiveBounds    FAILED\n");
+                worldDestroy(tracked);
+                return -1;
+            }
+        }
+
+        worldDestroy(tracked);
+    }
+
+    // A cleared world keeps its size and can be reused for a new pattern
+    struct World *cleared = worldCreate();
+    cleared->detect_period = 1;
+    int min_x, min_y, max_x, max_y;
+    unsigned int cleared_rows = 0;
+    if (worldLoadFromFile(cleared, gun_file) && worldStep(cleared, 50)) {
+        cleared_rows = cleared->rows;
+        worldClear(cleared);
+    }
+    if (!cleared_rows || cleared->rows != cleared_rows || worldPopulation(cleared) || cleared->generation ||
+        worldLiveBounds(cleared, &min_x, &min_y, &max_x, &max_y) || !liveBoundsMatchCells(cleared)) {
+        fprintf(stderr, "test_world: worldClear    FAILED\n");
+        worldDestroy(cleared);
+        return -1;
+    }
+    for (int x = 4; x < 7; ++x)
+        worldToggleCellAt(cleared, x, 5);
+    if (!worldStep(cleared, 100) || !worldPeriod(cleared, &period) || period.period != 2 ||
+        worldPopulation(cleared) != 3) {
+        fprintf(stderr, "test_world: worldClear    FAILED\n");
+        worldDestroy(cleared);
+        return -1;
+    }
+    worldDestroy(cleared);
+
+    // A batch of generations from worldStep matches as many worldUpdate calls,
+    // and with detect_period set it stops at the first repeat
+    for (int engine = EngineDense; engine <= EngineLookupTable; ++engine) {
+        struct World *stepped = worldCreate();
+        struct World *updated = worldCreate();
+        stepped->engine = engine;
+        if (!worldLoadFromFile(stepped, gun_file) || !worldLoadFromFile(updated, gun_file) ||
+            !worldStep(stepped, 301)) {
+            fprintf(stderr, "test_world: worldStep    FAILED\n");
+            worldDestroy(stepped);
+            worldDestroy(updated);
+            return -1;
+        }
+        for (int i = 0; i < 301; ++i)
+            worldUpdate(updated);
+
+        if (stepped->generation != updated->generation || !worldsEqualAt(stepped, updated) ||
+            worldPopulation(stepped) != worldPopulation(updated)) {
+            fprintf(stderr, "test_world: worldStep differs from worldUpdate (engine %d)\n", engine);
+            fprintf(stderr, "test_world: worldStep    FAILED\n");
+            worldDestroy(stepped);
+            worldDestroy(updated);
+            return -1;
+        }
+
+        worldDestroy(stepped);
+        worldDestroy(updated);
+    }
+
+    // The bit packed engine advances tiles several generations per pass in
+    // worldStep, in an unbounded and in a bounded world
+    unsigned int tile_generations[] = {2, 5, 64};
+    for (int i = 0; i < 6; ++i) {
+        struct World *tiled = worldCreate();
+        struct World *updated = worldCreate();
+        tiled->engine = EngineBitPacked;
+        tiled->tile_generations = tile_generations[i % 3];
+        if (!worldLoadFromFile(tiled, train_file) || !worldLoadFromFile(updated, train_file) ||
+            (i >= 3 && (!worldSetTopology(tiled, TopologyBounded, 160, 64) ||
+                        !worldSetTopology(updated, TopologyBounded, 160, 64))) ||
+            !worldStep(tiled, 203)) {
+            fprintf(stderr, "test_world: worldStep tile_generations    FAILED\n");
+            worldDestroy(tiled);
+            worldDestroy(updated);
+            return -1;
+        }
+        for (int g = 0; g < 203; ++g)
+            worldUpdate(updated);
+
+        if (tiled->generation != updated->generation || !worldsEqualAt(tiled, updated)) {
+            fprintf(stderr, "test_world: tiled world differs (tile_generations %u)\n", tiled->tile_generations);
+            fprintf(stderr, "test_world: worldStep tile_generations    FAILED\n");
+            worldDestroy(tiled);
+            worldDestroy(updated);
+            return -1;
+        }
+
+        worldDestroy(tiled);
+        worldDestroy(updated);
+    }
+
+    // Every engine stops at the blinker's first repeat, the hashlife and
+    // sparse engines too although they advance many generations at once
+    enum WorldEngine period_engines[] = {EngineDense, EngineBitPacked, EngineHashLife, EngineSparse};
+    for (int e = 0; e < 4; ++e) {
+        blinker = worldCreate();
+        blinker->engine = period_engines[e];
+        blinker->detect_period = 1;
+        if (!worldLoadFromFile(blinker, world_file_1) || !worldStep(blinker, 1000000) ||
+            blinker->generation != 3 || !worldPeriod(blinker, &period) || period.period != 2) {
+            fprintf(stderr, "test_world: engine %d stopped at generation %lu\n", (int) period_engines[e],
+                    (unsigned long) blinker->generation);
+            fprintf(stderr, "test_world: worldStep detect_period    FAILED\n");
+            worldDestroy(blinker);
+            return -1;
+        }
+        worldDestroy(blinker);
+
+        // worldAdvance carries on past the repeat
+        blinker = worldCreate();
+        blinker->engine = period_engines[e];
+        blinker->detect_period = 1;
+        if (!worldLoadFromFile(blinker, world_file_1) || !worldAdvance(blinker, 100) ||
+            blinker->generation != 100 || !worldPeriod(blinker, &period) || period.period != 2) {
+            fprintf(stderr, "test_world: worldAdvance detect_period    FAILED\n");
+            worldDestroy(blinker);
+            return -1;
+        }
+        worldDestroy(blinker);
+    }
+
+    // The sparse engine keeps only the tiles around its live cells, so two
+    // gliders far further apart than the dense cells could hold step as one
+    struct World *sparse = worldCreate();
+    reference = worldCreate();
+    sparse->engine = EngineSparse;
+    int stamped = worldLoadFromFile(sparse, glider_file) && worldLoadFromFile(reference, glider_file) &&
+                  worldUpdate(sparse) && worldUpdate(reference);
+    for (int r = 0; stamped && r < reference->rows; ++r) {
+        for (int c = 0; c < reference->cols; ++c) {
+            int x = c + reference->tl_cell_pos_x;
+            int y = r + reference->tl_cell_pos_y;
+            if (*worldCell(reference, c, r))
+                stamped = worldToggleCellAt(sparse, x + 100000, y + 100000);
+        }
+    }
+    int sparse_min_x, sparse_min_y, sparse_max_x, sparse_max_y;
+    if (!stamped || !worldStep(sparse, 400) || !worldStep(reference, 400) || sparse->cells ||
+        worldPopulation(sparse) != 2 * worldPopulation(reference) ||
+        !worldLiveBounds(sparse, &sparse_min_x, &sparse_min_y, &sparse_max_x, &sparse_max_y) ||
+        !worldLiveBounds(reference, &min_x, &min_y, &max_x, &max_y) || sparse_min_x != min_x ||
+        sparse_min_y != min_y || sparse_max_x != max_x + 100000 || sparse_max_y != max_y + 100000) {
+        fprintf(stderr, "test_world: sparse gliders far apart    FAILED\n");
+        worldDestroy(sparse);
+        worldDestroy(reference);
+        return -1;
+    }
+    for (int y = min_y; y <= max_y; ++y) {
+        for (int x = min_x; x <= max_x; ++x) {
+            int alive = worldCellAlive(reference, x, y);
+            if (worldCellAlive(sparse, x, y) != alive || worldCellAlive(sparse, x + 100000, y + 100000) != alive) {
+                fprintf(stderr, "test_world: sparse gliders far apart    FAILED\n");
+                worldDestroy(sparse);
+                worldDestroy(reference);
+                return -1;
+            }
+        }
+    }
+    worldDestroy(sparse);
+    worldDestroy(reference);
+
 #if 0 
     struct World *world2 = worldCreate();
     // Test the world resizing only in the y dir
@@ -101,3 +579,85 @@ int main(void) {
     fprintf(stderr, "test_world: All tests PASSED\n");
     return 0;
 }
+
+int worldsEqual(struct World *a, struct World *b) {
+    if (a->rows != b->rows || a->cols != b->cols ||
+        a->tl_cell_pos_x != b->tl_cell_pos_x || a->tl_cell_pos_y != b->tl_cell_pos_y)
+        return 0;
+
+    for (int r = 0; r < a->rows; ++r) {
+        for (int c = 0; c < a->cols; ++c) {
+            int x = c + a->tl_cell_pos_x;
+            int y = r + a->tl_cell_pos_y;
+            if (worldCellAlive(a, x, y) != worldCellAlive(b, x, y))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/// Compares the live cells of two worlds in world coords, regardless of
+/// the size of their cells.
+int worldsEqualAt(struct World *a, struct World *b) {
+    struct World *worlds[2] = {a, b};
+    for (int i = 0; i < 2; ++i) {
+        struct World *w = worlds[i];
+        for (int r = 0; r < w->rows; ++r) {
+            for (int c = 0; c < w->cols; ++c) {
+                int x = c + w->tl_cell_pos_x;
+                int y = r + w->tl_cell_pos_y;
+                if (worldCellAlive(a, x, y) != worldCellAlive(b, x, y))
+                    return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+/// True if other has the live cells, population, bounds and hash of the
+/// dense world. The hashlife and sparse engines keep their own cells,
+/// whose size is not that of the dense world.
+int engineMatchesDense(struct World *dense, struct World *other) {
+    if (other->engine != EngineHashLife && other->engine != EngineSparse)
+        return worldsEqual(dense, other);
+
+    int a[4], b[4];
+    int live = worldLiveBounds(dense, &a[0], &a[1], &a[2], &a[3]);
+    if (live != worldLiveBounds(other, &b[0], &b[1], &b[2], &b[3]) ||
+        (live && memcmp(a, b, sizeof(a)) != 0))
+        return 0;
+    return worldPopulation(dense) == worldPopulation(other) && dense->hash == other->hash &&
+           worldsEqualAt(dense, other);
+}
+
+int liveBoundsMatchCells(struct World *world) {
+    // The cells of the hashlife and sparse engines are scanned once written
+    // back, which finds the bounds again
+    int bounds[4];
+    uint64_t tracked = worldPopulation(world);
+    int live = worldLiveBounds(world, &bounds[0], &bounds[1], &bounds[2], &bounds[3]);
+    if (!worldSyncCells(world))
+        return 0;
+
+    uint64_t population = 0;
+    int min_x = INT_MAX, min_y = INT_MAX, max_x = INT_MIN, max_y = INT_MIN;
+    for (int r = 0; r < world->rows; ++r) {
+        for (int c = 0; c < world->cols; ++c) {
+            int x = c + world->tl_cell_pos_x;
+            int y = r + world->tl_cell_pos_y;
+            if (!worldCellAlive(world, x, y))
+                continue;
+            ++population;
+            min_x = x < min_x ? x : min_x;
+            max_x = x > max_x ? x : max_x;
+            min_y = y < min_y ? y : min_y;
+            max_y = y > max_y ? y : max_y;
+        }
+    }
+
+    if (tracked != population)
+        return 0;
+    if (!live)
+        return population == 0;
+    return bounds[0] == min_x && bounds[1] == min_y && bounds[2] == max_x && bounds[3] == max_y;
+}
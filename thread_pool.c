@@ -0,0 +1,245 @@
+#define _GNU_SOURCE
+#include "thread_pool.h"
+
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/// Claims and runs tasks from the current batch until none are left.
+/// Must be called with the lock held, returns with the lock held.
+static void runTasks(struct ThreadPool *self) {
+    while (self->next_task < self->num_tasks) {
+        unsigned int i = self->next_task;
+        ++self->next_task;
+
+        pthread_mutex_unlock(&self->lock);
+        self->task(self->arg, i);
+        pthread_mutex_lock(&self->lock);
+
+        ++self->tasks_done;
+        if (self->tasks_done == self->num_tasks)
+            pthread_cond_broadcast(&self->work_done);
+    }
+}
+
+/// Runs the tasks of the current batch owned by thread index, see
+/// owned_tasks. Must be called with the lock held, returns with the lock
+/// held.
+static void runOwnedTasks(struct ThreadPool *self, unsigned int index) {
+    unsigned int begin = self->num_tasks * index / self->num_threads;
+    unsigned int end = self->num_tasks * (index + 1) / self->num_threads;
+    if (begin == end)
+        return;
+
+    pthread_mutex_unlock(&self->lock);
+    for (unsigned int i = begin; i < end; ++i)
+        self->task(self->arg, i);
+    pthread_mutex_lock(&self->lock);
+
+    self->tasks_done += end - begin;
+    if (self->tasks_done == self->num_tasks)
+        pthread_cond_broadcast(&self->work_done);
+}
+
+static void *workerMain(void *arg) {
+    struct ThreadPool *self = arg;
+    unsigned long seen_batch = 0;
+
+    // threadPoolCreate holds the lock until every worker is in workers
+    pthread_mutex_lock(&self->lock);
+    unsigned int index = 1;
+    while (index < self->num_threads && !pthread_equal(self->workers[index], pthread_self()))
+        ++index;
+
+    while (1) {
+        while (!self->shutdown && self->batch == seen_batch)
+            pthread_cond_wait(&self->work_ready, &self->lock);
+
+        if (self->shutdown)
+            break;
+
+        seen_batch = self->batch;
+        if (self->owned_tasks)
+            runOwnedTasks(self, index);
+        else
+            runTasks(self);
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    return NULL;
+}
+
+struct ThreadPool *threadPoolCreate(unsigned int num_threads) {
+
+    struct ThreadPool *self = malloc(sizeof(struct ThreadPool));
+    if (!self) {
+        fprintf(stderr, "Failed to allocate memory for the thread pool.\n");
+        return NULL;
+    }
+
+    if (num_threads == 0)
+        num_threads = 1;
+
+    self->num_threads = 1;
+    self->task = NULL;
+    self->arg = NULL;
+    self->num_tasks = 0;
+    self->next_task = 0;
+    self->tasks_done = 0;
+    self->batch = 0;
+    self->shutdown = 0;
+    self->owned_tasks = 0;
+    self->pinned = 0;
+    self->caller_cpu = 0;
+    pthread_mutex_init(&self->lock, NULL);
+    pthread_cond_init(&self->work_ready, NULL);
+    pthread_cond_init(&self->work_done, NULL);
+
+    self->workers = calloc(num_threads, sizeof(pthread_t));
+    if (!self->workers) {
+        fprintf(stderr, "Failed to allocate memory for the thread pool workers.\n");
+        threadPoolDestroy(self);
+        return NULL;
+    }
+
+    // The calling thread counts as the first thread. The workers wait for
+    // the lock to find their index in workers.
+    pthread_mutex_lock(&self->lock);
+    for (unsigned int i = 1; i < num_threads; ++i) {
+        if (pthread_create(&self->workers[i], NULL, workerMain, self) != 0) {
+            fprintf(stderr, "thread_pool::threadPoolCreate: Error! Failed to create worker %u.\n", i);
+            pthread_mutex_unlock(&self->lock);
+            threadPoolDestroy(self);
+            return NULL;
+        }
+        ++self->num_threads;
+    }
+    pthread_mutex_unlock(&self->lock);
+
+    return self;
+}
+
+void threadPoolDestroy(struct ThreadPool *self) {
+    if (!self)
+        return;
+
+    pthread_mutex_lock(&self->lock);
+    self->shutdown = 1;
+    pthread_cond_broadcast(&self->work_ready);
+    pthread_mutex_unlock(&self->lock);
+
+    for (unsigned int i = 1; i < self->num_threads; ++i)
+        pthread_join(self->workers[i], NULL);
+
+    pthread_cond_destroy(&self->work_done);
+    pthread_cond_destroy(&self->work_ready);
+    pthread_mutex_destroy(&self->lock);
+    free(self->workers);
+    free(self);
+}
+
+/// Binds the calling thread to the processor of thread 0 of a pinned pool
+/// for the length of a batch, saving its own processors in saved. Returns 1
+/// if it was bound and must be restored with restoreCaller.
+static int bindCaller(struct ThreadPool *self, cpu_set_t *saved) {
+    if (!self || !self->pinned)
+        return 0;
+
+    cpu_set_t one;
+    CPU_ZERO(&one);
+    CPU_SET(self->caller_cpu, &one);
+    CPU_ZERO(saved);
+    return pthread_getaffinity_np(pthread_self(), sizeof(*saved), saved) == 0 &&
+           pthread_setaffinity_np(pthread_self(), sizeof(one), &one) == 0;
+}
+
+static void restoreCaller(const cpu_set_t *saved) {
+    pthread_setaffinity_np(pthread_self(), sizeof(*saved), saved);
+}
+
+/// Runs task(arg, i) for i in [0, num_tasks) across the pool and returns
+/// once every task has finished. On a pinned pool the calling thread runs
+/// its share of the batch on the processor of thread 0, and may run
+/// anywhere again once the batch is done.
+void threadPoolRun(struct ThreadPool *self, ThreadPoolTask task, void *arg, unsigned int num_tasks) {
+    if (num_tasks == 0)
+        return;
+
+    cpu_set_t saved;
+    int bound = bindCaller(self, &saved);
+
+    if (!self || self->num_threads == 1 || (num_tasks == 1 && !self->owned_tasks)) {
+        for (unsigned int i = 0; i < num_tasks; ++i)
+            task(arg, i);
+        if (bound)
+            restoreCaller(&saved);
+        return;
+    }
+
+    pthread_mutex_lock(&self->lock);
+    self->task = task;
+    self->arg = arg;
+    self->num_tasks = num_tasks;
+    self->next_task = 0;
+    self->tasks_done = 0;
+    ++self->batch;
+    pthread_cond_broadcast(&self->work_ready);
+
+    if (self->owned_tasks)
+        runOwnedTasks(self, 0);
+    else
+        runTasks(self);
+    while (self->tasks_done < self->num_tasks)
+        pthread_cond_wait(&self->work_done, &self->lock);
+    pthread_mutex_unlock(&self->lock);
+
+    if (bound)
+        restoreCaller(&saved);
+}
+
+/// Binds worker i of the pool to the i-th processor the process may run on,
+/// wrapping around if there are more threads than processors. Thread 0 is
+/// whichever thread calls threadPoolRun, which is only bound to the first
+/// processor while it runs a batch, so threads it starts later are not
+/// confined to one processor. Consecutive processors are usually on the
+/// same NUMA node, so with owned_tasks neighbouring tasks stay on one node.
+int threadPoolPin(struct ThreadPool *self) {
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0 || CPU_COUNT(&allowed) == 0) {
+        fprintf(stderr, "thread_pool::threadPoolPin: Error! Failed to get the processors to run on.\n");
+        return 0;
+    }
+
+    int cpu = -1;
+    for (unsigned int i = 0; i < self->num_threads; ++i) {
+        do {
+            cpu = (cpu + 1) % CPU_SETSIZE;
+        } while (!CPU_ISSET(cpu, &allowed));
+
+        if (i == 0) {
+            self->caller_cpu = cpu;
+            continue;
+        }
+
+        cpu_set_t one;
+        CPU_ZERO(&one);
+        CPU_SET(cpu, &one);
+        if (pthread_setaffinity_np(self->workers[i], sizeof(one), &one) != 0) {
+            fprintf(stderr, "thread_pool::threadPoolPin: Error! Failed to bind thread %u to processor %d.\n", i, cpu);
+            return 0;
+        }
+    }
+
+    self->pinned = 1;
+    return 1;
+}
+
+/// Number of online processors, or 1 if it cannot be determined.
+unsigned int threadPoolDefaultThreads() {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1)
+        return 1;
+    return (unsigned int) cpus;
+}
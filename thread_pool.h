@@ -0,0 +1,48 @@
+#ifndef __GAME_OF_LIFE_THREAD_POOL_H__
+#define __GAME_OF_LIFE_THREAD_POOL_H__
+
+#include <pthread.h>
+
+/// Runs task index i of num_tasks. arg is shared between all tasks.
+typedef void (*ThreadPoolTask)(void *arg, unsigned int i);
+
+/// Persistent set of worker threads used to run a batch of tasks in
+/// parallel. The calling thread also works on the batch, so a pool of
+/// num_threads creates num_threads - 1 workers.
+struct ThreadPool {
+
+    pthread_t *workers;
+    unsigned int num_threads;
+
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+
+    // The current batch of tasks. Guarded by lock.
+    ThreadPoolTask task;
+    void *arg;
+    unsigned int num_tasks;
+    unsigned int next_task;
+    unsigned int tasks_done;
+    unsigned long batch;
+    int shutdown;
+
+    // With owned_tasks set, a batch of n tasks is split into num_threads
+    // runs of consecutive tasks and thread i always runs the i-th run, so
+    // the same thread runs task i of every batch of n tasks. Thread 0 is
+    // the calling thread. Otherwise threads claim the next task when free.
+    int owned_tasks;
+
+    // Set once threadPoolPin has bound each worker to its own processor.
+    // The calling thread is bound to caller_cpu while it runs a batch.
+    int pinned;
+    int caller_cpu;
+};
+
+struct ThreadPool *threadPoolCreate(unsigned int num_threads);
+void threadPoolDestroy(struct ThreadPool *self);
+void threadPoolRun(struct ThreadPool *self, ThreadPoolTask task, void *arg, unsigned int num_tasks);
+int threadPoolPin(struct ThreadPool *self);
+unsigned int threadPoolDefaultThreads();
+
+#endif // __GAME_OF_LIFE_THREAD_POOL_H__
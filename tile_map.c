@@ -0,0 +1,752 @@
+#include "tile_map.h"
+#include "life_word.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define TILE_MAP_INITIAL_BUCKETS 256
+#define MAX_FREE_TILES 64
+#define TILES_PER_TASK 16
+
+#define TILE_ROW_BYTES (sizeof(uint64_t) * TILE_SIZE)
+
+// Bits of Tile edges, one per neighbour a live cell on that edge or corner
+// could give birth into, in the order of edge_dx and edge_dy
+#define EDGE_TOP 1u
+#define EDGE_BOTTOM 2u
+#define EDGE_LEFT 4u
+#define EDGE_RIGHT 8u
+#define EDGE_TOP_LEFT 16u
+#define EDGE_TOP_RIGHT 32u
+#define EDGE_BOTTOM_LEFT 64u
+#define EDGE_BOTTOM_RIGHT 128u
+
+static const int edge_dx[8] = {0, 0, -1, 1, -1, 1, -1, 1};
+static const int edge_dy[8] = {-1, 1, 0, 0, -1, -1, 1, 1};
+
+// A backing file starts with a page holding the header, the slots follow
+#define TILE_FILE_HEADER_BYTES 4096
+#define TILE_FILE_CHUNK_BYTES ((size_t) TILE_FILE_CHUNK_SLOTS * sizeof(struct TileSlot))
+
+static const char tile_file_magic[8] = {'G', 'O', 'L', 'T', 'I', 'L', 'E', '1'};
+
+/// Header of a backing file. Slots past num_slots are unused.
+struct TileFileHeader {
+    char magic[8];
+    uint32_t tile_size;
+    uint32_t slot_bytes;
+    uint32_t num_slots;
+    uint32_t reserved;
+    uint64_t generation;
+    uint16_t birth;
+    uint16_t survival;
+};
+
+/// Tile coord of a world coord, rounding towards negative infinity.
+static int tileCoord(int64_t x) {
+    return (int) (x >= 0 ? x / TILE_SIZE : -((-x + TILE_SIZE - 1) / TILE_SIZE));
+}
+
+static unsigned int hashTile(int tx, int ty, unsigned int num_buckets) {
+    uint64_t h = (uint64_t) (uint32_t) tx * 0x9E3779B97F4A7C15ull ^ (uint64_t) (uint32_t) ty * 0xC2B2AE3D27D4EB4Full;
+    return (unsigned int) ((h ^ (h >> 32)) & (num_buckets - 1));
+}
+
+static const struct TileSummary empty_summary = {0, TILE_SIZE, -1, 0};
+
+/// Summary of the live cells of rows.
+static struct TileSummary summariseRows(const uint64_t *rows) {
+    struct TileSummary summary = empty_summary;
+    for (int r = 0; r < TILE_SIZE; ++r) {
+        if (!rows[r])
+            continue;
+        summary.population += __builtin_popcountll(rows[r]);
+        summary.cols |= rows[r];
+        if (summary.first_row == TILE_SIZE)
+            summary.first_row = r;
+        summary.last_row = r;
+    }
+    return summary;
+}
+
+static struct TileSlot *slotAt(struct TileMap *self, unsigned int slot) {
+    return &self->chunks[slot / TILE_FILE_CHUNK_SLOTS][slot % TILE_FILE_CHUNK_SLOTS];
+}
+
+struct TileMap *tileMapCreate() {
+
+    struct TileMap *self = calloc(1, sizeof(struct TileMap));
+    if (!self) {
+        fprintf(stderr, "Failed to allocate memory for the tile map.\n");
+        return NULL;
+    }
+
+    self->num_buckets = TILE_MAP_INITIAL_BUCKETS;
+    self->buckets = calloc(self->num_buckets, sizeof(struct Tile *));
+    if (!self->buckets) {
+        fprintf(stderr, "Failed to allocate memory for the tile map buckets.\n");
+        free(self);
+        return NULL;
+    }
+
+    self->file = -1;
+    lifeRuleConway(&self->rule);
+    return self;
+}
+
+void tileMapDestroy(struct TileMap *self) {
+    if (!self)
+        return;
+
+    // The tiles of a mapped map stay in its file, only their headers in
+    // memory are freed
+    if (self->file >= 0) {
+        tileMapSync(self);
+        for (unsigned int i = 0; i < self->num_tiles; ++i)
+            free(self->tiles[i]);
+        self->num_tiles = 0;
+    } else {
+        tileMapClear(self);
+    }
+
+    while (self->free_tiles) {
+        struct Tile *next = self->free_tiles->next;
+        free(self->free_tiles);
+        self->free_tiles = next;
+    }
+
+    for (unsigned int i = 0; i < self->num_chunks; ++i)
+        munmap(self->chunks[i], TILE_FILE_CHUNK_BYTES);
+    free(self->chunks);
+    if (self->file >= 0)
+        close(self->file);
+
+    free(self->tiles);
+    free(self->buckets);
+    free(self);
+}
+
+static struct Tile *findTile(struct TileMap *self, int tx, int ty) {
+    struct Tile *tile = self->buckets[hashTile(tx, ty, self->num_buckets)];
+    while (tile && (tile->tx != tx || tile->ty != ty))
+        tile = tile->next;
+    return tile;
+}
+
+static int growBuckets(struct TileMap *self) {
+    unsigned int num_buckets = self->num_buckets * 2;
+    struct Tile **buckets = calloc(num_buckets, sizeof(struct Tile *));
+    if (!buckets) {
+        fprintf(stderr, "tile_map::growBuckets: Error! Failed to allocate %u buckets.\n", num_buckets);
+        return 0;
+    }
+
+    for (unsigned int i = 0; i < self->num_tiles; ++i) {
+        struct Tile *tile = self->tiles[i];
+        unsigned int b = hashTile(tile->tx, tile->ty, num_buckets);
+        tile->next = buckets[b];
+        buckets[b] = tile;
+    }
+
+    free(self->buckets);
+    self->buckets = buckets;
+    self->num_buckets = num_buckets;
+    return 1;
+}
+
+/// Maps another chunk of slots at the end of the backing file.
+static int growFile(struct TileMap *self) {
+    struct TileSlot **chunks = realloc(self->chunks, sizeof(struct TileSlot *) * (self->num_chunks + 1));
+    if (!chunks) {
+        fprintf(stderr, "tile_map::growFile: Error! Failed to allocate the chunk list.\n");
+        return 0;
+    }
+    self->chunks = chunks;
+
+    // The file is only lengthened, an opened file already holds its chunks
+    off_t offset = (off_t) TILE_FILE_HEADER_BYTES + (off_t) self->num_chunks * (off_t) TILE_FILE_CHUNK_BYTES;
+    struct stat file_stat;
+    if (fstat(self->file, &file_stat) != 0 ||
+        (file_stat.st_size < offset + (off_t) TILE_FILE_CHUNK_BYTES &&
+         ftruncate(self->file, offset + (off_t) TILE_FILE_CHUNK_BYTES) != 0)) {
+        fprintf(stderr, "tile_map::growFile: Error! Failed to grow the tile file.\n");
+        return 0;
+    }
+
+    void *chunk = mmap(NULL, TILE_FILE_CHUNK_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, self->file, offset);
+    if (chunk == MAP_FAILED) {
+        fprintf(stderr, "tile_map::growFile: Error! Failed to map the tile file.\n");
+        return 0;
+    }
+    self->chunks[self->num_chunks++] = chunk;
+    return 1;
+}
+
+/// Allocates a tile whose rows follow it on the heap, or are the next
+/// slot of the backing file.
+static struct Tile *allocTile(struct TileMap *self) {
+    if (self->file < 0) {
+        struct Tile *tile = malloc(sizeof(struct Tile) + 2 * TILE_ROW_BYTES);
+        if (!tile)
+            return NULL;
+        tile->rows = (uint64_t *) (tile + 1);
+        tile->rows_next = tile->rows + TILE_SIZE;
+        tile->slot = TILE_NO_SLOT;
+        return tile;
+    }
+
+    if (self->num_slots == TILE_NO_SLOT ||
+        (self->num_slots == self->num_chunks * TILE_FILE_CHUNK_SLOTS && !growFile(self)))
+        return NULL;
+
+    struct Tile *tile = malloc(sizeof(struct Tile));
+    if (!tile)
+        return NULL;
+    tile->slot = self->num_slots++;
+    tile->rows = slotAt(self, tile->slot)->rows;
+    tile->rows_next = slotAt(self, tile->slot)->rows_next;
+    return tile;
+}
+
+/// Adds a tile to the tile list and its hash bucket.
+static int linkTile(struct TileMap *self, struct Tile *tile) {
+    if (self->num_tiles == self->tiles_capacity) {
+        unsigned int capacity = self->tiles_capacity ? self->tiles_capacity * 2 : 64;
+        struct Tile **tiles = realloc(self->tiles, sizeof(struct Tile *) * capacity);
+        if (!tiles) {
+            fprintf(stderr, "tile_map::linkTile: Error! Failed to allocate the tile list.\n");
+            return 0;
+        }
+        self->tiles = tiles;
+        self->tiles_capacity = capacity;
+    }
+
+    tile->index = self->num_tiles;
+    self->tiles[self->num_tiles] = tile;
+    ++self->num_tiles;
+
+    unsigned int b = hashTile(tile->tx, tile->ty, self->num_buckets);
+    tile->next = self->buckets[b];
+    self->buckets[b] = tile;
+
+    if (self->num_tiles > self->num_buckets)
+        growBuckets(self);
+    return 1;
+}
+
+/// Returns the tile at (tx, ty), allocating an empty one if needed.
+static struct Tile *addTile(struct TileMap *self, int tx, int ty) {
+    struct Tile *tile = findTile(self, tx, ty);
+    if (tile)
+        return tile;
+
+    if (self->free_tiles) {
+        tile = self->free_tiles;
+        self->free_tiles = tile->next;
+    } else {
+        tile = allocTile(self);
+        if (!tile) {
+            fprintf(stderr, "tile_map::addTile: Error! Failed to allocate a tile.\n");
+            return NULL;
+        }
+    }
+
+    memset(tile->rows, 0, TILE_ROW_BYTES);
+    tile->changed = 1;
+    tile->stepped = 0;
+    tile->edges = 0;
+    tile->summary = empty_summary;
+    tile->tx = tx;
+    tile->ty = ty;
+    if (tile->slot != TILE_NO_SLOT) {
+        struct TileSlot *slot = slotAt(self, tile->slot);
+        slot->tx = tx;
+        slot->ty = ty;
+        slot->used = 1;
+    }
+
+    if (!linkTile(self, tile)) {
+        tile->next = self->free_tiles;
+        self->free_tiles = tile;
+        return NULL;
+    }
+    return tile;
+}
+
+/// Unlinks a tile and keeps it for reuse, or frees it if enough are kept.
+/// Tiles of a backing file are always kept, with their slot. If the tile
+/// changed its neighbours are marked as changed, since they lose the
+/// removed cells.
+static void removeTile(struct TileMap *self, struct Tile *tile) {
+    for (int dy = -1; dy <= 1 && tile->changed; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+            struct Tile *neighbour = findTile(self, tile->tx + dx, tile->ty + dy);
+            if (neighbour)
+                neighbour->changed = 1;
+        }
+    }
+
+    struct Tile **link = &self->buckets[hashTile(tile->tx, tile->ty, self->num_buckets)];
+    while (*link != tile)
+        link = &(*link)->next;
+    *link = tile->next;
+
+    struct Tile *last = self->tiles[self->num_tiles - 1];
+    self->tiles[tile->index] = last;
+    last->index = tile->index;
+    --self->num_tiles;
+
+    if (tile->slot != TILE_NO_SLOT) {
+        slotAt(self, tile->slot)->used = 0;
+        tile->next = self->free_tiles;
+        self->free_tiles = tile;
+        return;
+    }
+
+    unsigned int num_free = 0;
+    for (struct Tile *t = self->free_tiles; t && num_free < MAX_FREE_TILES; t = t->next)
+        ++num_free;
+
+    if (num_free < MAX_FREE_TILES) {
+        tile->next = self->free_tiles;
+        self->free_tiles = tile;
+    } else {
+        free(tile);
+    }
+}
+
+void tileMapClear(struct TileMap *self) {
+    while (self->num_tiles)
+        removeTile(self, self->tiles[self->num_tiles - 1]);
+}
+
+/// Destroys a mapped map that failed to open, leaving its file as it was.
+static void closeWithoutSync(struct TileMap *self) {
+    if (self->file >= 0)
+        close(self->file);
+    self->file = -1;
+    for (unsigned int i = 0; i < self->num_tiles; ++i)
+        free(self->tiles[i]);
+    self->num_tiles = 0;
+    tileMapDestroy(self);
+}
+
+/// Opens a map whose tiles are kept in the file file_name, creating it if
+/// needed. The file is memory mapped, so only the tiles being stepped need
+/// to be in memory and the map can be much larger than RAM. The tiles,
+/// rule and generation of an existing file are read back, and the rows of
+/// each tile are read once to summarise them.
+struct TileMap *tileMapCreateMapped(const char *file_name) {
+    struct TileMap *self = tileMapCreate();
+    if (!self)
+        return NULL;
+
+    self->file = open(file_name, O_RDWR | O_CREAT, 0644);
+    struct stat file_stat;
+    if (self->file < 0 || fstat(self->file, &file_stat) != 0) {
+        fprintf(stderr, "tile_map::tileMapCreateMapped: Error! Failed to open %s.\n", file_name);
+        tileMapDestroy(self);
+        return NULL;
+    }
+    if (file_stat.st_size == 0)
+        return self;
+
+    struct TileFileHeader header;
+    if (pread(self->file, &header, sizeof(header), 0) != (ssize_t) sizeof(header) ||
+        memcmp(header.magic, tile_file_magic, sizeof(tile_file_magic)) != 0 ||
+        header.tile_size != TILE_SIZE || header.slot_bytes != sizeof(struct TileSlot)) {
+        fprintf(stderr, "tile_map::tileMapCreateMapped: Error! %s is not a tile file.\n", file_name);
+        closeWithoutSync(self);
+        return NULL;
+    }
+
+    unsigned int num_chunks = (header.num_slots + TILE_FILE_CHUNK_SLOTS - 1) / TILE_FILE_CHUNK_SLOTS;
+    if ((uint64_t) file_stat.st_size < TILE_FILE_HEADER_BYTES + (uint64_t) num_chunks * TILE_FILE_CHUNK_BYTES) {
+        fprintf(stderr, "tile_map::tileMapCreateMapped: Error! %s is truncated.\n", file_name);
+        closeWithoutSync(self);
+        return NULL;
+    }
+
+    // Chunks are mapped again over the existing slots, only the slot
+    // headers are read here
+    for (unsigned int i = 0; i < num_chunks; ++i) {
+        if (!growFile(self)) {
+            closeWithoutSync(self);
+            return NULL;
+        }
+    }
+
+    self->generation = header.generation;
+    self->rule.birth = header.birth;
+    self->rule.survival = header.survival;
+    char rule[LIFE_RULE_MAX_CHARS];
+    lifeRuleToString(&self->rule, rule);
+    if (!lifeRuleParse(&self->rule, rule))
+        lifeRuleConway(&self->rule);
+
+    for (unsigned int i = 0; i < header.num_slots; ++i) {
+        struct TileSlot *slot = slotAt(self, i);
+        struct Tile *tile = malloc(sizeof(struct Tile));
+        if (!tile) {
+            fprintf(stderr, "tile_map::tileMapCreateMapped: Error! Failed to allocate a tile.\n");
+            closeWithoutSync(self);
+            return NULL;
+        }
+        tile->slot = i;
+        tile->rows = slot->rows;
+        tile->rows_next = slot->rows_next;
+        tile->tx = slot->tx;
+        tile->ty = slot->ty;
+        tile->changed = 1;
+        tile->stepped = 0;
+        tile->edges = 0;
+        tile->summary = empty_summary;
+        self->num_slots = i + 1;
+
+        if (!slot->used) {
+            tile->next = self->free_tiles;
+            self->free_tiles = tile;
+            continue;
+        }
+        tile->summary = summariseRows(tile->rows);
+        if (!linkTile(self, tile)) {
+            free(tile);
+            closeWithoutSync(self);
+            return NULL;
+        }
+    }
+
+    return self;
+}
+
+/// Writes the header of the backing file and flushes the mapped tiles to
+/// it. Does nothing for a map without a backing file.
+int tileMapSync(struct TileMap *self) {
+    if (self->file < 0)
+        return 1;
+
+    struct TileFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, tile_file_magic, sizeof(tile_file_magic));
+    header.tile_size = TILE_SIZE;
+    header.slot_bytes = sizeof(struct TileSlot);
+    header.num_slots = self->num_slots;
+    header.generation = self->generation;
+    header.birth = self->rule.birth;
+    header.survival = self->rule.survival;
+
+    int synced = pwrite(self->file, &header, sizeof(header), 0) == (ssize_t) sizeof(header);
+    for (unsigned int i = 0; i < self->num_chunks; ++i)
+        synced &= msync(self->chunks[i], TILE_FILE_CHUNK_BYTES, MS_SYNC) == 0;
+    if (!synced)
+        fprintf(stderr, "tile_map::tileMapSync: Error! Failed to write the tile file.\n");
+    return synced;
+}
+
+/// State of the cell at world coords (x, y).
+int tileMapCell(struct TileMap *self, int64_t x, int64_t y) {
+    int tx = tileCoord(x);
+    int ty = tileCoord(y);
+    struct Tile *tile = findTile(self, tx, ty);
+    if (!tile)
+        return 0;
+
+    int64_t c = x - (int64_t) tx * TILE_SIZE;
+    int64_t r = y - (int64_t) ty * TILE_SIZE;
+    return (tile->rows[r] >> c) & 1;
+}
+
+/// Sets the cell at world coords (x, y), allocating or freeing its tile.
+int tileMapSetCell(struct TileMap *self, int64_t x, int64_t y, int alive) {
+    int tx = tileCoord(x);
+    int ty = tileCoord(y);
+    struct Tile *tile = alive ? addTile(self, tx, ty) : findTile(self, tx, ty);
+    if (!tile)
+        return !alive;
+
+    int64_t c = x - (int64_t) tx * TILE_SIZE;
+    int64_t r = y - (int64_t) ty * TILE_SIZE;
+    uint64_t bit = (uint64_t) 1 << c;
+    if (((tile->rows[r] & bit) != 0) == (alive != 0))
+        return 1;
+
+    tile->changed = 1;
+    if (alive) {
+        tile->rows[r] |= bit;
+        struct TileSummary *summary = &tile->summary;
+        ++summary->population;
+        summary->cols |= bit;
+        summary->first_row = r < summary->first_row ? (int) r : summary->first_row;
+        summary->last_row = r > summary->last_row ? (int) r : summary->last_row;
+    } else {
+        // A cleared cell may shrink the bounds, so the rows are read again
+        tile->rows[r] &= ~bit;
+        tile->summary = summariseRows(tile->rows);
+        if (!tile->summary.population)
+            removeTile(self, tile);
+    }
+    return 1;
+}
+
+int tileMapToggleCell(struct TileMap *self, int64_t x, int64_t y) {
+    return tileMapSetCell(self, x, y, !tileMapCell(self, x, y));
+}
+
+/// Replaces the tiles with rows x cols cells, one byte per cell and stride
+/// bytes per row, whose top left cell is at (tl_x, tl_y) in world coords.
+int tileMapSetCells(struct TileMap *self, const unsigned char *cells, unsigned int rows, unsigned int cols,
+                    unsigned int stride, int64_t tl_x, int64_t tl_y) {
+    tileMapClear(self);
+
+    for (unsigned int r = 0; r < rows; ++r) {
+        const unsigned char *row = &cells[(size_t) r * stride];
+        for (unsigned int c = 0; c < cols; ++c) {
+            if (row[c] && !tileMapSetCell(self, tl_x + c, tl_y + r, 1))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/// Writes the rows x cols cells whose top left cell is at (tl_x, tl_y) in
+/// world coords, one byte per cell and stride bytes per row.
+void tileMapGetCells(struct TileMap *self, unsigned char *cells, unsigned int rows, unsigned int cols,
+                     unsigned int stride, int64_t tl_x, int64_t tl_y) {
+    for (unsigned int r = 0; r < rows; ++r)
+        memset(&cells[(size_t) r * stride], 0, cols);
+
+    for (unsigned int i = 0; i < self->num_tiles; ++i) {
+        struct Tile *tile = self->tiles[i];
+        int64_t x0 = (int64_t) tile->tx * TILE_SIZE;
+        int64_t y0 = (int64_t) tile->ty * TILE_SIZE;
+        for (int r = 0; r < TILE_SIZE; ++r) {
+            int64_t y = y0 + r;
+            uint64_t word = tile->rows[r];
+            if (!word || y < tl_y || y >= tl_y + rows)
+                continue;
+
+            while (word) {
+                int c = __builtin_ctzll(word);
+                word &= word - 1;
+                int64_t x = x0 + c;
+                if (x >= tl_x && x < tl_x + cols)
+                    cells[(size_t) (y - tl_y) * stride + (x - tl_x)] = 1;
+            }
+        }
+    }
+}
+
+/// Bounding box of the live cells in world coords, inclusive, from the
+/// summaries of the tiles. Returns 0 if there are no live cells.
+int tileMapBounds(struct TileMap *self, int64_t *min_x, int64_t *min_y, int64_t *max_x, int64_t *max_y) {
+    int found = 0;
+    for (unsigned int i = 0; i < self->num_tiles; ++i) {
+        struct Tile *tile = self->tiles[i];
+        uint64_t cols = tile->summary.cols;
+        int first_row = tile->summary.first_row;
+        int last_row = tile->summary.last_row;
+        if (!cols)
+            continue;
+
+        int64_t x0 = (int64_t) tile->tx * TILE_SIZE;
+        int64_t y0 = (int64_t) tile->ty * TILE_SIZE;
+        int64_t tile_min_x = x0 + __builtin_ctzll(cols);
+        int64_t tile_max_x = x0 + 63 - __builtin_clzll(cols);
+        if (!found || tile_min_x < *min_x)
+            *min_x = tile_min_x;
+        if (!found || tile_max_x > *max_x)
+            *max_x = tile_max_x;
+        if (!found || y0 + first_row < *min_y)
+            *min_y = y0 + first_row;
+        if (!found || y0 + last_row > *max_y)
+            *max_y = y0 + last_row;
+        found = 1;
+    }
+    return found;
+}
+
+/// Edges and corners of a tile with live cells, as EDGE_ bits. Only the
+/// first and last rows are read, the cols come from the summary.
+static unsigned int findEdges(const struct Tile *tile) {
+    uint64_t cols = tile->summary.cols;
+    uint64_t top = tile->rows[0];
+    uint64_t bottom = tile->rows[TILE_SIZE - 1];
+    return (top ? EDGE_TOP : 0) | (bottom ? EDGE_BOTTOM : 0) |
+           ((cols & 1) ? EDGE_LEFT : 0) | ((cols >> 63) ? EDGE_RIGHT : 0) |
+           ((top & 1) ? EDGE_TOP_LEFT : 0) | ((top >> 63) ? EDGE_TOP_RIGHT : 0) |
+           ((bottom & 1) ? EDGE_BOTTOM_LEFT : 0) | ((bottom >> 63) ? EDGE_BOTTOM_RIGHT : 0);
+}
+
+/// True if a tile next to (tx, ty) changed in the last generation.
+static int isNeighbourChanged(struct TileMap *self, int tx, int ty) {
+    for (int dy = -1; dy <= 1; ++dy) {
+        for (int dx = -1; dx <= 1; ++dx) {
+            struct Tile *tile = (dx || dy) ? findTile(self, tx + dx, ty + dy) : NULL;
+            if (tile && tile->changed)
+                return 1;
+        }
+    }
+    return 0;
+}
+
+/// Allocates the empty neighbours a live tile could give birth into. A
+/// missing tile none of whose neighbours changed stays empty, so the edges
+/// of tiles that did not change are kept from before rather than read.
+static int addBirthTiles(struct TileMap *self) {
+    unsigned int num_tiles = self->num_tiles;
+    for (unsigned int i = 0; i < num_tiles; ++i) {
+        struct Tile *tile = self->tiles[i];
+        if (tile->changed)
+            tile->edges = findEdges(tile);
+
+        for (int d = 0; d < 8; ++d) {
+            if (!(tile->edges & (1u << d)))
+                continue;
+            int tx = tile->tx + edge_dx[d];
+            int ty = tile->ty + edge_dy[d];
+            if (findTile(self, tx, ty) || (!tile->changed && !isNeighbourChanged(self, tx, ty)))
+                continue;
+            if (!addTile(self, tx, ty))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+static uint64_t rowOf(const struct Tile *tile, int r) {
+    return tile ? tile->rows[r] : 0;
+}
+
+/// Computes rows_next of one tile from it and its eight neighbours.
+static void stepTile(struct TileMap *self, struct Tile *tile) {
+    int tx = tile->tx;
+    int ty = tile->ty;
+    struct Tile *n = findTile(self, tx, ty - 1);
+    struct Tile *s = findTile(self, tx, ty + 1);
+    struct Tile *w = findTile(self, tx - 1, ty);
+    struct Tile *e = findTile(self, tx + 1, ty);
+    struct Tile *nw = findTile(self, tx - 1, ty - 1);
+    struct Tile *ne = findTile(self, tx + 1, ty - 1);
+    struct Tile *sw = findTile(self, tx - 1, ty + 1);
+    struct Tile *se = findTile(self, tx + 1, ty + 1);
+
+    struct Tile *neighbours[8] = {n, s, w, e, nw, ne, sw, se};
+    int active = tile->changed;
+    for (int i = 0; i < 8 && !active; ++i)
+        active = neighbours[i] && neighbours[i]->changed;
+
+    tile->stepped = active;
+    if (!active)
+        return;
+
+    struct TileSummary summary = empty_summary;
+    for (int r = 0; r < TILE_SIZE; ++r) {
+        uint64_t a, a_prev, a_next;
+        if (r > 0) {
+            a = tile->rows[r - 1];
+            a_prev = rowOf(w, r - 1);
+            a_next = rowOf(e, r - 1);
+        } else {
+            a = rowOf(n, TILE_SIZE - 1);
+            a_prev = rowOf(nw, TILE_SIZE - 1);
+            a_next = rowOf(ne, TILE_SIZE - 1);
+        }
+
+        uint64_t b, b_prev, b_next;
+        if (r + 1 < TILE_SIZE) {
+            b = tile->rows[r + 1];
+            b_prev = rowOf(w, r + 1);
+            b_next = rowOf(e, r + 1);
+        } else {
+            b = rowOf(s, 0);
+            b_prev = rowOf(sw, 0);
+            b_next = rowOf(se, 0);
+        }
+
+        uint64_t m = tile->rows[r];
+        uint64_t m_prev = rowOf(w, r);
+        uint64_t m_next = rowOf(e, r);
+
+        uint64_t next = lifeWordNextRule(shiftInLeft(a, a_prev), a, shiftInRight(a, a_next),
+                                         shiftInLeft(m, m_prev), m, shiftInRight(m, m_next),
+                                         shiftInLeft(b, b_prev), b, shiftInRight(b, b_next),
+                                         &self->rule);
+        tile->rows_next[r] = next;
+        if (next) {
+            summary.population += __builtin_popcountll(next);
+            summary.cols |= next;
+            if (summary.first_row == TILE_SIZE)
+                summary.first_row = r;
+            summary.last_row = r;
+        }
+    }
+    tile->summary_next = summary;
+}
+
+/// Tiles [begin, end) of the map stepped by one task.
+struct TileTask {
+    struct TileMap *map;
+    unsigned int begin;
+    unsigned int end;
+};
+
+static void stepTileTask(void *arg, unsigned int i) {
+    struct TileTask *task = (struct TileTask *) arg + i;
+    for (unsigned int t = task->begin; t < task->end; ++t)
+        stepTile(task->map, task->map->tiles[t]);
+}
+
+/// Advances the tiles by one generation. Tiles are stepped in parallel on
+/// the pool when one is given.
+int tileMapStep(struct TileMap *self, struct ThreadPool *pool) {
+    if (!addBirthTiles(self))
+        return 0;
+
+    unsigned int num_tasks = (self->num_tiles + TILES_PER_TASK - 1) / TILES_PER_TASK;
+    struct TileTask *tasks = malloc(sizeof(struct TileTask) * (num_tasks ? num_tasks : 1));
+    if (!tasks) {
+        fprintf(stderr, "tile_map::tileMapStep: Error! Failed to allocate tasks.\n");
+        return 0;
+    }
+    for (unsigned int i = 0; i < num_tasks; ++i) {
+        tasks[i].map = self;
+        tasks[i].begin = i * TILES_PER_TASK;
+        tasks[i].end = i * TILES_PER_TASK + TILES_PER_TASK < self->num_tiles ?
+                       i * TILES_PER_TASK + TILES_PER_TASK : self->num_tiles;
+    }
+    threadPoolRun(pool, stepTileTask, tasks, num_tasks);
+    free(tasks);
+
+    // Tiles that were not stepped are left as they are
+    for (unsigned int i = 0; i < self->num_tiles; ++i) {
+        struct Tile *tile = self->tiles[i];
+        tile->changed = tile->stepped && memcmp(tile->rows, tile->rows_next, TILE_ROW_BYTES) != 0;
+        if (tile->changed) {
+            memcpy(tile->rows, tile->rows_next, TILE_ROW_BYTES);
+            tile->summary = tile->summary_next;
+        }
+    }
+
+    // Drop tiles that died out. Iterate backwards since removing a tile
+    // moves the last tile into its slot.
+    for (unsigned int i = self->num_tiles; i-- > 0;) {
+        struct Tile *tile = self->tiles[i];
+        if (tile->stepped && !tile->summary.population)
+            removeTile(self, tile);
+    }
+    ++self->generation;
+    return 1;
+}
+
+/// Live cells of the map, from the summaries of the tiles.
+uint64_t tileMapPopulation(struct TileMap *self) {
+    uint64_t population = 0;
+    for (unsigned int i = 0; i < self->num_tiles; ++i)
+        population += self->tiles[i]->summary.population;
+    return population;
+}
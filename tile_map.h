@@ -0,0 +1,118 @@
+#ifndef __GAME_OF_LIFE_TILE_MAP_H__
+#define __GAME_OF_LIFE_TILE_MAP_H__
+
+#include "thread_pool.h"
+#include "life_rule.h"
+
+#include <stdint.h>
+
+#define TILE_SIZE 64
+
+// Tiles of a backing file are mapped this many at a time
+#define TILE_FILE_CHUNK_SLOTS 4096
+
+/// Live cells of a tile, the OR of its rows and its first and last rows
+/// with live cells, TILE_SIZE and -1 when empty.
+struct TileSummary {
+    uint32_t population;
+    int first_row;
+    int last_row;
+    uint64_t cols;
+};
+
+/// 64x64 cells. Row r is a word, bit c of the word is the cell at col c.
+/// The rows are stored after the tile on the heap, or in a slot of the
+/// backing file of the map, so stepping only reads the rows of tiles whose
+/// neighbourhood changed.
+struct Tile {
+    int tx;
+    int ty;
+    uint64_t *rows;
+    uint64_t *rows_next;
+
+    // Set if the tile changed in the last generation. A tile whose
+    // neighbourhood did not change is carried over without being stepped,
+    // and stepped is cleared.
+    int changed;
+    int stepped;
+
+    // Edges of the tile with live cells, see addBirthTiles. Only found
+    // again after the tile changes.
+    unsigned int edges;
+
+    // Kept up to date as the tile changes, so the population and bounds of
+    // the map are found without reading the rows. summary_next is that of
+    // rows_next once the tile is stepped.
+    struct TileSummary summary;
+    struct TileSummary summary_next;
+
+    // Position in TileMap tiles and next tile in the same hash bucket
+    unsigned int index;
+    struct Tile *next;
+
+    // Slot of the backing file holding the rows, TILE_NO_SLOT on the heap
+    unsigned int slot;
+};
+
+#define TILE_NO_SLOT 0xFFFFFFFFu
+
+/// Rows of one tile in a backing file, with the tile coords so the file
+/// can be opened again. used is cleared when the tile is freed.
+struct TileSlot {
+    int32_t tx;
+    int32_t ty;
+    uint32_t used;
+    uint32_t reserved;
+    uint64_t rows[TILE_SIZE];
+    uint64_t rows_next[TILE_SIZE];
+};
+
+/// Sparse world of tiles keyed by tile coords. A tile holds the cells in
+/// world coords [64*tx, 64*tx + 64) x [64*ty, 64*ty + 64). Tiles are only
+/// allocated while they have live cells, so memory scales with the live
+/// area rather than the bounding box.
+struct TileMap {
+    struct Tile **buckets;
+    unsigned int num_buckets;
+
+    // Every allocated tile, in no particular order
+    struct Tile **tiles;
+    unsigned int num_tiles;
+    unsigned int tiles_capacity;
+
+    // Emptied tiles kept for reuse
+    struct Tile *free_tiles;
+
+    // Rule the tiles are stepped with, B3/S23 unless set
+    struct LifeRule rule;
+
+    // Generations stepped, kept in the backing file
+    uint64_t generation;
+
+    // Backing file of a mapped map, see tileMapCreateMapped, -1 otherwise.
+    // The slots are mapped TILE_FILE_CHUNK_SLOTS at a time after a page
+    // holding the header, and the OS pages the rows of cold tiles out to
+    // the file.
+    int file;
+    struct TileSlot **chunks;
+    unsigned int num_chunks;
+    unsigned int num_slots;
+};
+
+struct TileMap *tileMapCreate();
+struct TileMap *tileMapCreateMapped(const char *file_name);
+int tileMapSync(struct TileMap *self);
+void tileMapDestroy(struct TileMap *self);
+void tileMapClear(struct TileMap *self);
+int tileMapCell(struct TileMap *self, int64_t x, int64_t y);
+int tileMapSetCell(struct TileMap *self, int64_t x, int64_t y, int alive);
+int tileMapToggleCell(struct TileMap *self, int64_t x, int64_t y);
+int tileMapSetCells(struct TileMap *self, const unsigned char *cells, unsigned int rows, unsigned int cols,
+                    unsigned int stride, int64_t tl_x, int64_t tl_y);
+void tileMapGetCells(struct TileMap *self, unsigned char *cells, unsigned int rows, unsigned int cols,
+                     unsigned int stride, int64_t tl_x, int64_t tl_y);
+int tileMapBounds(struct TileMap *self, int64_t *min_x, int64_t *min_y, int64_t *max_x, int64_t *max_y);
+int tileMapStep(struct TileMap *self, struct ThreadPool *pool);
+uint64_t tileMapPopulation(struct TileMap *self);
+
+#endif // __GAME_OF_LIFE_TILE_MAP_H__
@@ -1,4 +1,6 @@
 #include "window.h"
+#include "simulation.h"
+#include "render_thread.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -7,8 +9,8 @@
 // Global window
 struct Window window;
 
+/// The render thread sets the viewport to match, see rendererDrawFrame.
 static void framebufferSizeCallback(GLFWwindow *handle, int width, int height) {
-    glViewport(0, 0, width, height);
     window.size_x = width;
     window.size_y = height;
 }
@@ -143,22 +145,58 @@ void windowProcessInput() {
         glfwSetWindowShouldClose(window.handle, 1);
 }
 
+/// Handles input and builds frames at the window's fps, while the world is
+/// updated on the simulation thread and the frames are drawn on the render
+/// thread. Both are stopped once the window closes.
 void windowLoop(struct Renderer *renderer, struct World *world) {
+    struct Simulation *simulation = simulationCreate(world);
+    if (!simulation)
+        return;
+
+    // GLFW events stay on this thread, the GL context moves to the render
+    // thread
+    struct RenderThread *render_thread = renderThreadCreate(renderer, window.handle);
+    if (!render_thread) {
+        simulationDestroy(simulation);
+        return;
+    }
+
     while (!glfwWindowShouldClose(window.handle)) {
         
         windowProcessInput();
-        renderClear(renderer);
-        renderWorld(renderer, world);
-        glfwSwapBuffers(window.handle);
-        rendererGrowWorldToFillView(renderer, world);
-
-        if (hasNextTickPassed(&world->update_rate))
-            worldUpdate(world);
+        rendererHandleViewInput(renderer);
+
+        // Edited cells are queued for the simulation thread, other input
+        // that changes the world waits for the generation in progress
+        rendererHandleEditInput(renderer, world, simulation->edits);
+        if (rendererWorldInputPending()) {
+            simulationLock(simulation);
+            if (rendererHandleWorldInput(renderer, world, simulation->rewind) && !simulationPublish(simulation)) {
+                simulationUnlock(simulation);
+                break;
+            }
+            simulationUnlock(simulation);
+        }
+
+        // The next frame is built from the latest generation while the
+        // render thread presents the last one. If it has not started on the
+        // last one yet, this frame is skipped.
+        struct RenderFrame *frame = renderThreadBeginFrame(render_thread);
+        if (frame) {
+            struct WorldSnapshot *snapshot = snapshotAcquire(simulation->snapshots);
+            int built = rendererBuildFrame(renderer, snapshot, frame);
+            snapshotRelease(snapshot);
+            if (!built)
+                break;
+            renderThreadSubmitFrame(render_thread, frame);
+        }
 
         sleepTillNextTick(&window.fps);
         glfwPollEvents();
     }
 
+    renderThreadDestroy(render_thread);
+    simulationDestroy(simulation);
 }
 
 
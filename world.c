@@ -1,12 +1,338 @@
 #include "world.h"
 #include "fileio.h"
+#include "life_word.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <math.h>
 
 #define MAX_WORLD_FILE_BYTES 16384
 
+// Bands per thread, so uneven bands still balance across the pool.
+#define BANDS_PER_THREAD 4
+#define MAX_WORLD_BANDS 1024
+
+// Nodes the HashLife pattern does not use are freed once the universe
+// holds this many, see hashLifeCollect.
+#define MAX_HASHLIFE_NODES (1 << 22)
+
+// Largest number of dense cells a world may have, also when the cells of
+// another engine are written back into them.
+#define MAX_WORLD_CELLS (1ull << 31)
+
+// Compaction leaves COMPACT_MARGIN_BLOCKS dead blocks around the live cells,
+// but only trims an edge once it has more than COMPACT_SLACK_BLOCKS dead
+// blocks, so a world does not shrink and regrow every few generations.
+#define DEFAULT_COMPACT_INTERVAL 64
+#define COMPACT_MARGIN_BLOCKS 1
+#define COMPACT_SLACK_BLOCKS 4
+
+// Generations worldStep runs between growing the world. Each batch grows the
+// world by a margin of one cell per generation, which costs more to update
+// than it saves in growth checks for longer batches.
+#define STEP_BATCH_GENERATIONS 4
+
+// Tiles of packed cells that worldStep advances several generations at a
+// time, sized so a tile and its halo stay in the L2 cache. The halo is one
+// word wide, so a tile is advanced at most 64 generations per pass.
+#define TILE_ROWS 128
+#define TILE_WORDS 16
+#define DEFAULT_TILE_GENERATIONS 16
+#define MAX_TILE_GENERATIONS 64
+
+#define DEFAULT_REWIND_GENERATIONS 1024
+
+// Odd multipliers of the hash of the live cells, see World hash. The
+// HashLife nodes are hashed with the same ones.
+#define HASH_P HASHLIFE_HASH_P
+#define HASH_Q HASHLIFE_HASH_Q
+
+static void markAllBlocksChanged(struct World *self) {
+    unsigned int count = self->block_grid_rows * self->block_grid_cols;
+    for (unsigned int i = 0; i < count; ++i)
+        self->block_changed[i] = 1;
+}
+
+/// Marks the block holding cell (c, r) as changed.
+static void markBlockChanged(struct World *self, int c, int r) {
+    unsigned int br = (unsigned int) r / self->block_rows;
+    unsigned int bc = (unsigned int) c / self->block_cols;
+    self->block_changed[br * self->block_grid_cols + bc] = 1;
+}
+
+/// Odd multiplier raised to the power x, for any x, modulo 2^64.
+static uint64_t hashPower(uint64_t base, int64_t exponent) {
+    if (exponent < 0) {
+        // Inverse of an odd number modulo 2^64 by Newton's iteration, each
+        // step doubles the number of correct bits.
+        uint64_t inverse = base;
+        for (int i = 0; i < 5; ++i)
+            inverse *= 2 - base * inverse;
+        base = inverse;
+        exponent = -exponent;
+    }
+
+    uint64_t result = 1;
+    while (exponent) {
+        if (exponent & 1)
+            result *= base;
+        base *= base;
+        exponent >>= 1;
+    }
+    return result;
+}
+
+/// Recomputes the hash powers of each col and row from tl_cell_pos.
+static int updateHashPowers(struct World *self) {
+    uint64_t *hash_x = realloc(self->hash_x, sizeof(uint64_t) * self->cols);
+    uint64_t *hash_y = realloc(self->hash_y, sizeof(uint64_t) * self->rows);
+    if (hash_x)
+        self->hash_x = hash_x;
+    if (hash_y)
+        self->hash_y = hash_y;
+    if (!hash_x || !hash_y) {
+        fprintf(stderr, "world::updateHashPowers: Error! Failed to allocate memory for the hash powers.\n");
+        return 0;
+    }
+
+    uint64_t power = hashPower(HASH_P, self->tl_cell_pos_x);
+    for (unsigned int c = 0; c < self->cols; ++c, power *= HASH_P)
+        hash_x[c] = power;
+    power = hashPower(HASH_Q, self->tl_cell_pos_y);
+    for (unsigned int r = 0; r < self->rows; ++r, power *= HASH_Q)
+        hash_y[r] = power;
+    return 1;
+}
+
+/// Resizes the block flags, block populations and hash powers to cover the
+/// cells, marking every block as changed. The populations of the old
+/// blocks move by (block_row_shift, block_col_shift) blocks, new blocks
+/// are empty.
+static int resizeBlocks(struct World *self, int block_row_shift, int block_col_shift) {
+    unsigned int old_grid_rows = self->block_grid_rows;
+    unsigned int old_grid_cols = self->block_grid_cols;
+    self->block_grid_rows = (self->rows + self->block_rows - 1) / self->block_rows;
+    self->block_grid_cols = (self->cols + self->block_cols - 1) / self->block_cols;
+    unsigned int count = self->block_grid_rows * self->block_grid_cols;
+
+    unsigned char *block_changed = realloc(self->block_changed, count);
+    if (!block_changed) {
+        fprintf(stderr, "world::resizeBlocks: Error! Failed to allocate memory for block flags.\n");
+        return 0;
+    }
+    self->block_changed = block_changed;
+
+    unsigned char *block_changed_next = realloc(self->block_changed_next, count);
+    if (!block_changed_next) {
+        fprintf(stderr, "world::resizeBlocks: Error! Failed to allocate memory for block flags.\n");
+        return 0;
+    }
+    self->block_changed_next = block_changed_next;
+
+    uint32_t *block_population = calloc(count, sizeof(uint32_t));
+    if (!block_population) {
+        fprintf(stderr, "world::resizeBlocks: Error! Failed to allocate memory for block populations.\n");
+        return 0;
+    }
+    for (unsigned int br = 0; self->block_population && br < old_grid_rows; ++br) {
+        for (unsigned int bc = 0; bc < old_grid_cols; ++bc) {
+            int nr = (int) br + block_row_shift;
+            int nc = (int) bc + block_col_shift;
+            if (nr >= 0 && nc >= 0 && nr < (int) self->block_grid_rows && nc < (int) self->block_grid_cols)
+                block_population[nr * self->block_grid_cols + nc] = self->block_population[br * old_grid_cols + bc];
+        }
+    }
+    free(self->block_population);
+    self->block_population = block_population;
+
+    markAllBlocksChanged(self);
+    return updateHashPowers(self);
+}
+
+/// Recounts the block populations, population and hash from the cells.
+static void recountCells(struct World *self) {
+    self->live_bounds_valid = 0;
+    memset(self->block_population, 0, sizeof(uint32_t) * self->block_grid_rows * self->block_grid_cols);
+    self->population = 0;
+    self->hash = 0;
+    for (unsigned int r = 0; r < self->rows; ++r) {
+        const unsigned char *row = &self->cells[(size_t) r * self->stride];
+        uint32_t *block_row = &self->block_population[(r / self->block_rows) * self->block_grid_cols];
+        for (unsigned int c = 0; c < self->cols; ++c) {
+            if (!row[c])
+                continue;
+            ++block_row[c / self->block_cols];
+            ++self->population;
+            self->hash += self->hash_x[c] * self->hash_y[r];
+        }
+    }
+}
+
+/// Forgets the history and any period found, after the cells were edited.
+static void resetPeriod(struct World *self) {
+    self->history_len = 0;
+    self->history_next = 0;
+    self->period_found = 0;
+}
+
+/// Points cells and cells_next at the origin of their buffers, or at NULL
+/// while the dense cells are freed.
+static void updateCellPointers(struct World *self) {
+    if (!self->cells_buffer) {
+        self->cells = NULL;
+        self->cells_next = NULL;
+        return;
+    }
+    size_t offset = (size_t) self->origin_row * self->stride + self->origin_col;
+    self->cells = self->cells_buffer + offset;
+    self->cells_next = self->cells_next_buffer + offset;
+}
+
+/// Makes keep, which holds the current cells, the only current cells and
+/// frees the others, so the cells only take the memory of one engine.
+static void releaseCells(struct World *self, unsigned int keep) {
+    if (!(keep & CellsDense) && self->cells_buffer) {
+        free(self->cells_buffer);
+        free(self->cells_next_buffer);
+        self->cells_buffer = NULL;
+        self->cells_next_buffer = NULL;
+        updateCellPointers(self);
+    }
+    if (!(keep & CellsPacked) && self->packed) {
+        free(self->packed);
+        free(self->packed_next);
+        self->packed = NULL;
+        self->packed_next = NULL;
+        self->packed_words = 0;
+        self->packed_rows = 0;
+    }
+    if (!(keep & CellsTiles) && (self->current & CellsTiles))
+        tileMapClear(self->tiles);
+    if (!(keep & CellsHashLife) && (self->current & CellsHashLife))
+        hashLifeClear(self->hashlife);
+    self->current = keep;
+}
+
+/// Number of bands the rows of a world with block_grid_rows rows of blocks
+/// are split into, see splitBands.
+static unsigned int countBands(struct World *self, unsigned int block_grid_rows) {
+    unsigned int num_bands = self->num_threads > 1 ? self->num_threads * BANDS_PER_THREAD : 1;
+    if (num_bands > MAX_WORLD_BANDS)
+        num_bands = MAX_WORLD_BANDS;
+    if (num_bands > block_grid_rows)
+        num_bands = block_grid_rows;
+    return num_bands;
+}
+
+/// Rows [row_begin, row_end) of band i of num_bands bands of whole blocks
+/// over rows rows of cells.
+static void bandRows(struct World *self, unsigned int rows, unsigned int num_bands, unsigned int i,
+                     unsigned int *row_begin, unsigned int *row_end) {
+    unsigned int block_grid_rows = (rows + self->block_rows - 1) / self->block_rows;
+    unsigned int br_begin = block_grid_rows * i / num_bands;
+    unsigned int br_end = block_grid_rows * (i + 1) / num_bands;
+    *row_begin = br_begin * self->block_rows;
+    *row_end = br_end * self->block_rows < rows ? br_end * self->block_rows : rows;
+}
+
+/// New cell buffers being cleared and filled with the old cells by the
+/// threads that will update them, see touchBandTask.
+struct WorldTouch {
+    struct World *world;
+    unsigned char *cells_buffer;
+    unsigned char *cells_next_buffer;
+    unsigned int rows;
+    unsigned int capacity_rows;
+    unsigned int stride;
+    unsigned int origin_row;
+    unsigned int origin_col;
+    unsigned int row_shift;
+    unsigned int col_shift;
+    unsigned int copy_rows;
+    unsigned int copy_cols;
+    unsigned int num_bands;
+};
+
+/// Clears the buffer rows of band i of the new cells and copies the old
+/// cells that land in them. The first and last bands also take the margins
+/// above and below the cells. Linux places a page on the NUMA node of the
+/// thread that first writes it, so run on a pool with owned_tasks the rows
+/// of each band end up on the node of the thread that updates the band.
+static void touchBandTask(void *arg, unsigned int i) {
+    struct WorldTouch *touch = arg;
+    struct World *self = touch->world;
+
+    unsigned int row_begin, row_end;
+    bandRows(self, touch->rows, touch->num_bands, i, &row_begin, &row_end);
+    unsigned int buffer_begin = i == 0 ? 0 : touch->origin_row + row_begin;
+    unsigned int buffer_end = i + 1 == touch->num_bands ? touch->capacity_rows : touch->origin_row + row_end;
+
+    size_t offset = (size_t) buffer_begin * touch->stride;
+    size_t bytes = (size_t) (buffer_end - buffer_begin) * touch->stride;
+    memset(touch->cells_buffer + offset, 0, bytes);
+    memset(touch->cells_next_buffer + offset, 0, bytes);
+
+    unsigned int first_row = touch->origin_row + touch->row_shift;
+    for (unsigned int r = buffer_begin; r < buffer_end; ++r) {
+        if (r < first_row || r >= first_row + touch->copy_rows)
+            continue;
+        unsigned char *dst = &touch->cells_buffer[(size_t) r * touch->stride + touch->origin_col + touch->col_shift];
+        memcpy(dst, &self->cells[(size_t) (r - first_row) * self->stride], touch->copy_cols);
+    }
+}
+
+/// Moves the cells into new buffers with margins of half their size, so
+/// that growing again is amortised O(1). The top left cell moves to
+/// (row_shift, col_shift) of the new cells, cells that do not fit are lost.
+/// With first_touch set the buffers are filled band by band on the pool.
+static int reallocCells(struct World *self, unsigned int rows, unsigned int cols,
+                        unsigned int row_shift, unsigned int col_shift) {
+    unsigned int capacity_rows = rows + rows / 2 + 2 * self->block_rows;
+    unsigned int stride = cols + cols / 2 + 2 * self->block_cols;
+    unsigned int origin_row = (capacity_rows - rows) / 2;
+    unsigned int origin_col = (stride - cols) / 2;
+
+    // Large buffers come straight from the kernel and are not on any node
+    // until written, so they are left for the bands to clear
+    int touch_bands = self->first_touch && self->pool;
+    size_t bytes = (size_t) capacity_rows * stride;
+    unsigned char *cells_buffer = touch_bands ? malloc(bytes) : calloc(bytes, sizeof(unsigned char));
+    unsigned char *cells_next_buffer = touch_bands ? malloc(bytes) : calloc(bytes, sizeof(unsigned char));
+    if (!cells_buffer || !cells_next_buffer) {
+        fprintf(stderr, "world::reallocCells: Error! Failed to allocate memory for %u x %u cells.\n", rows, cols);
+        free(cells_buffer);
+        free(cells_next_buffer);
+        return 0;
+    }
+
+    // Freed dense cells have nothing to copy, see worldSyncCells
+    unsigned int copy_rows = !self->cells ? 0 : self->rows < rows - row_shift ? self->rows : rows - row_shift;
+    unsigned int copy_cols = self->cols < cols - col_shift ? self->cols : cols - col_shift;
+    if (touch_bands) {
+        struct WorldTouch touch = {self, cells_buffer, cells_next_buffer, rows, capacity_rows, stride,
+                                   origin_row, origin_col, row_shift, col_shift, copy_rows, copy_cols,
+                                   countBands(self, (rows + self->block_rows - 1) / self->block_rows)};
+        threadPoolRun(self->pool, touchBandTask, &touch, touch.num_bands);
+    } else {
+        for (unsigned int r = 0; r < copy_rows; ++r) {
+            unsigned char *dst = &cells_buffer[(size_t) (origin_row + row_shift + r) * stride + origin_col + col_shift];
+            memcpy(dst, &self->cells[(size_t) r * self->stride], copy_cols);
+        }
+    }
+
+    free(self->cells_buffer);
+    free(self->cells_next_buffer);
+    self->cells_buffer = cells_buffer;
+    self->cells_next_buffer = cells_next_buffer;
+    self->capacity_rows = capacity_rows;
+    self->stride = stride;
+    self->origin_row = origin_row;
+    self->origin_col = origin_col;
+    return 1;
+}
+
 struct World *worldCreate() {
 
     struct World *self = malloc(sizeof(struct World));
@@ -21,72 +347,1416 @@ struct World *worldCreate() {
     self->update_rate.last_tick = timeNow();
     self->updates_paused = 0;
     self->edit_mode = 0;
+    self->rewind_generations = DEFAULT_REWIND_GENERATIONS;
     self->tl_cell_pos_x = 0;
     self->tl_cell_pos_y = 0;
+    self->engine = EngineDense;
+    lifeRuleConway(&self->rule);
+    self->packed = NULL;
+    self->packed_next = NULL;
+    self->packed_words = 0;
+    self->packed_rows = 0;
+    self->tile_generations = DEFAULT_TILE_GENERATIONS;
+    self->lookup_table = NULL;
+    self->hashlife = NULL;
+    self->tiles = NULL;
+    self->current = CellsDense;
+    self->generation = 0;
+    self->compact_interval = DEFAULT_COMPACT_INTERVAL;
+    self->block_changed = NULL;
+    self->block_changed_next = NULL;
+    self->block_grid_rows = 0;
+    self->block_grid_cols = 0;
+    self->topology = TopologyUnbounded;
+    self->first_touch = numaNodeCount() > 1;
+    self->pin_threads = 0;
+    self->pool = NULL;
+    self->num_threads = 1;
+    self->cells = NULL;
+    self->cells_next = NULL;
+    self->cells_buffer = NULL;
+    self->cells_next_buffer = NULL;
+    self->rows = 0;
+    self->cols = 0;
+    if (!reallocCells(self, self->block_rows, self->block_cols, 0, 0)) {
+        free(self);
+        return NULL;
+    }
     self->rows = self->block_rows;
     self->cols = self->block_cols;
-    self->cells = calloc(self->rows * self->cols, sizeof(unsigned char));
-    if (!self->cells) {
-        fprintf(stderr, "Failed to allocate memory for the world cells.\n");
-        free(self);
+    updateCellPointers(self);
+
+    self->block_population = NULL;
+    self->population = 0;
+    self->hash = 0;
+    self->hash_x = NULL;
+    self->hash_y = NULL;
+    self->live_bounds_valid = 0;
+    self->detect_period = 0;
+    self->fast_forward = 0;
+    resetPeriod(self);
+
+    if (!resizeBlocks(self, 0, 0)) {
+        worldDestroy(self);
         return NULL;
     }
 
-    self->cn_rows = self->rows;
-    self->cn_cols = self->cols;
-    self->cells_next = calloc(self->rows * self->cols, sizeof(unsigned char));
-    if (!self->cells_next) {
-        fprintf(stderr, "Failed to allocate memory for the world cells_next.\n");
-        free(self->cells);
-        free(self);
-        return NULL;
+    return self;
+}
+
+void worldDestroy(struct World *self) {
+    if (!self)
+        return;
+    
+    free(self->cells_buffer);
+    free(self->cells_next_buffer);
+    free(self->packed);
+    free(self->packed_next);
+    free(self->lookup_table);
+    free(self->block_changed);
+    free(self->block_changed_next);
+    free(self->block_population);
+    free(self->hash_x);
+    free(self->hash_y);
+    hashLifeDestroy(self->hashlife);
+    tileMapDestroy(self->tiles);
+    threadPoolDestroy(self->pool);
+    free(self);
+}
+
+/// Sets the number of threads used by worldUpdate, replacing the worker pool.
+/// A new world is updated serially, without a pool.
+int worldSetThreads(struct World *self, unsigned int num_threads) {
+    if (num_threads == 0)
+        num_threads = 1;
+
+    threadPoolDestroy(self->pool);
+    self->pool = NULL;
+    self->num_threads = 1;
+
+    if (num_threads == 1)
+        return 1;
+
+    self->pool = threadPoolCreate(num_threads);
+    if (!self->pool) {
+        fprintf(stderr, "world::worldSetThreads: Error! Failed to create a pool of %u threads.\n", num_threads);
+        return 0;
+    }
+    self->num_threads = self->pool->num_threads;
+    self->pool->owned_tasks = self->first_touch;
+    if (self->pin_threads && !threadPoolPin(self->pool))
+        return 0;
+    return 1;
+}
+
+/// Sets how the cells are placed in memory on a machine with several NUMA
+/// nodes. With first_touch set each band of rows is always updated by the
+/// same thread of the pool, which also clears the band's rows when the
+/// cells move to new buffers, so the rows are on that thread's node. On by
+/// default when there is more than one node. With pin_threads set the
+/// threads are bound to one processor each, so they stay on their node.
+int worldSetPlacement(struct World *self, int first_touch, int pin_threads) {
+    self->first_touch = first_touch;
+    self->pin_threads = pin_threads;
+    if (self->pool) {
+        self->pool->owned_tasks = first_touch;
+        if (pin_threads && !self->pool->pinned && !threadPoolPin(self->pool))
+            return 0;
+    }
+
+    // Fresh buffers are first touched by the band owners
+    if (first_touch && self->pool && self->cells_buffer && !reallocCells(self, self->rows, self->cols, 0, 0))
+        return 0;
+    updateCellPointers(self);
+    return 1;
+}
+
+/// Counts the pages of the current cells by NUMA node.
+int worldCountPages(struct World *self, struct NumaPages *pages) {
+    numaResetPages(pages);
+    if (self->current & CellsDense) {
+        size_t bytes = (size_t) self->capacity_rows * self->stride;
+        if (!numaCountPages(pages, self->cells_buffer, bytes) ||
+            !numaCountPages(pages, self->cells_next_buffer, bytes))
+            return 0;
+    }
+    if (self->current & CellsPacked) {
+        size_t bytes = sizeof(uint64_t) * self->packed_words * self->packed_rows;
+        if (!numaCountPages(pages, self->packed, bytes) || !numaCountPages(pages, self->packed_next, bytes))
+            return 0;
+    }
+    return 1;
+}
+
+/// Sets the rule from B/S notation, such as B36/S23.
+int worldSetRule(struct World *self, const char *rule) {
+    if (!lifeRuleParse(&self->rule, rule)) {
+        fprintf(stderr, "world::worldSetRule: Error! Failed to set the rule %s.\n", rule);
+        return 0;
+    }
+    markAllBlocksChanged(self);
+    resetPeriod(self);
+    return 1;
+}
+
+static int isWithinDomain(struct World *self, int c, int r) {
+    return r >= 0 && c >= 0 && r < (int) self->rows && c < (int) self->cols;
+}
+
+/// Copies the cells on each edge of a torus into the margin past the
+/// opposite edge, so the kernels read wrapped neighbours without branching.
+static void wrapTorusMargin(struct World *self) {
+    const size_t stride = self->stride;
+    for (unsigned int r = 0; r < self->rows; ++r) {
+        unsigned char *row = &self->cells[r * stride];
+        row[-1] = row[self->cols - 1];
+        row[self->cols] = row[0];
+    }
+
+    // The rows include the wrapped corners copied above
+    unsigned char *first = self->cells - 1;
+    unsigned char *last = first + (self->rows - 1) * stride;
+    memcpy(first - stride, last, self->cols + 2);
+    memcpy(last + stride, first, self->cols + 2);
+}
+
+/// Sets the topology. A torus or bounded world keeps a fixed size of cols x
+/// rows cells, 0 keeps the current size, and is never grown or compacted.
+/// The cells keep their state, cells that do not fit are lost.
+int worldSetTopology(struct World *self, enum WorldTopology topology, unsigned int cols, unsigned int rows) {
+    if (topology != TopologyUnbounded && (self->engine == EngineHashLife || self->engine == EngineSparse)) {
+        fprintf(stderr, "world::worldSetTopology: Error! The hashlife and sparse engines need an unbounded world.\n");
+        return 0;
+    }
+
+    if (!cols)
+        cols = self->cols;
+    if (!rows)
+        rows = self->rows;
+    if (!worldSyncCells(self))
+        return 0;
+
+    // Fresh buffers also clear any wrapped cells left in the margin
+    if (!reallocCells(self, rows, cols, 0, 0))
+        return 0;
+    self->rows = rows;
+    self->cols = cols;
+    self->topology = topology;
+    releaseCells(self, CellsDense);
+    updateCellPointers(self);
+    if (!resizeBlocks(self, 0, 0))
+        return 0;
+
+    recountCells(self);
+    resetPeriod(self);
+    return 1;
+}
+
+/// 64 cells of a packed row of words words starting at col, which may lie
+/// partly or wholly outside the row. Cells outside the row are dead.
+static uint64_t packedBits(const uint64_t *row, unsigned int words, int64_t col) {
+    int64_t w = col >= 0 ? col / 64 : -((63 - col) / 64);
+    unsigned int bit = (unsigned int) (col - w * 64);
+    uint64_t low = w >= 0 && w < words ? row[w] : 0;
+    uint64_t high = w + 1 >= 0 && w + 1 < words ? row[w + 1] : 0;
+    return bit ? low >> bit | high << (64 - bit) : low;
+}
+
+/// Moves the packed cells into buffers sized for rows x cols cells, once
+/// the cells grew or were trimmed. The cell at (c, r) moves to (c +
+/// col_shift, r + row_shift), cells that do not fit are lost.
+static int shiftPacked(struct World *self, int row_shift, int col_shift) {
+    unsigned int words = (self->cols + 63) / 64;
+    size_t count = (size_t) words * self->rows;
+    uint64_t *packed = malloc(sizeof(uint64_t) * count);
+    uint64_t *packed_next = malloc(sizeof(uint64_t) * count);
+    if (!packed || !packed_next) {
+        fprintf(stderr, "world::shiftPacked: Error! Failed to allocate memory for packed cells.\n");
+        free(packed);
+        free(packed_next);
+        return 0;
+    }
+
+    unsigned int last_bits = self->cols - (words - 1) * 64;
+    const uint64_t last_mask = last_bits == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << last_bits) - 1;
+    for (unsigned int r = 0; r < self->rows; ++r) {
+        uint64_t *row = &packed[(size_t) r * words];
+        int64_t old_r = (int64_t) r - row_shift;
+        if (old_r < 0 || old_r >= self->packed_rows) {
+            memset(row, 0, sizeof(uint64_t) * words);
+            continue;
+        }
+        const uint64_t *old_row = &self->packed[(size_t) old_r * self->packed_words];
+        for (unsigned int w = 0; w < words; ++w)
+            row[w] = packedBits(old_row, self->packed_words, (int64_t) w * 64 - col_shift);
+        row[words - 1] &= last_mask;
+    }
+
+    free(self->packed);
+    free(self->packed_next);
+    self->packed = packed;
+    self->packed_next = packed_next;
+    self->packed_words = words;
+    self->packed_rows = self->rows;
+    return 1;
+}
+
+/// Grows the cells by the given number of blocks in each direction, keeping
+/// their state. The cells grow into the dead margins by moving the origin,
+/// and are only moved to larger buffers once a margin runs out. Only an
+/// unbounded world can grow.
+int worldIncreaseCells(struct World *self, int grow_top, int grow_bottom, int grow_left, int grow_right) {
+    if (self->topology != TopologyUnbounded) {
+        fprintf(stderr, "world::worldIncreaseCells: Error! A torus or bounded world cannot grow.\n");
+        return 0;
+    }
+
+    unsigned int top = (unsigned int) grow_top * self->block_rows;
+    unsigned int bottom = (unsigned int) grow_bottom * self->block_rows;
+    unsigned int left = (unsigned int) grow_left * self->block_cols;
+    unsigned int right = (unsigned int) grow_right * self->block_cols;
+    unsigned int rows = self->rows + top + bottom;
+    unsigned int cols = self->cols + left + right;
+
+    // A margin of at least one cell is kept on every side
+    if (self->cells_buffer) {
+        int fits = top < self->origin_row && left < self->origin_col &&
+                   self->origin_row - top + rows < self->capacity_rows &&
+                   self->origin_col - left + cols < self->stride;
+        if (fits) {
+            self->origin_row -= top;
+            self->origin_col -= left;
+        } else if (!reallocCells(self, rows, cols, top, left)) {
+            return 0;
+        }
+    }
+
+    self->rows = rows;
+    self->cols = cols;
+    self->tl_cell_pos_x -= (int) left;
+    self->tl_cell_pos_y -= (int) top;
+    updateCellPointers(self);
+    if ((self->current & CellsPacked) && !shiftPacked(self, (int) top, (int) left))
+        return 0;
+
+    return resizeBlocks(self, grow_top, grow_left);
+}
+
+/// Dead blocks to trim off an edge that has dead_blocks dead blocks.
+static unsigned int blocksToTrim(int dead_blocks) {
+    if (dead_blocks <= COMPACT_SLACK_BLOCKS)
+        return 0;
+    return (unsigned int) (dead_blocks - COMPACT_MARGIN_BLOCKS);
+}
+
+/// Trims dead blocks off the edges of the cells, keeping their state. The
+/// dense cells shrink by moving the origin, and are moved to smaller
+/// buffers once the buffers are more than twice the size growth would
+/// allocate. The packed cells are moved to buffers of the new size.
+int worldCompact(struct World *self) {
+
+    // Live blocks, from the block populations
+    int min_br = (int) self->block_grid_rows;
+    int max_br = -1;
+    int min_bc = (int) self->block_grid_cols;
+    int max_bc = -1;
+    for (unsigned int br = 0; br < self->block_grid_rows; ++br) {
+        for (unsigned int bc = 0; bc < self->block_grid_cols; ++bc) {
+            if (!self->block_population[br * self->block_grid_cols + bc])
+                continue;
+            min_br = (int) br < min_br ? (int) br : min_br;
+            max_br = (int) br;
+            min_bc = (int) bc < min_bc ? (int) bc : min_bc;
+            max_bc = (int) bc > max_bc ? (int) bc : max_bc;
+        }
+    }
+
+    unsigned int top, bottom, left, right;
+    if (max_br < 0) {
+        // Nothing is alive, keep a single block
+        top = 0;
+        left = 0;
+        bottom = self->block_grid_rows - 1;
+        right = self->block_grid_cols - 1;
+    } else {
+        top = blocksToTrim(min_br);
+        left = blocksToTrim(min_bc);
+        bottom = blocksToTrim((int) self->block_grid_rows - 1 - max_br);
+        right = blocksToTrim((int) self->block_grid_cols - 1 - max_bc);
+    }
+
+    if (!top && !bottom && !left && !right)
+        return 1;
+
+    unsigned int row_begin = top * self->block_rows;
+    unsigned int col_begin = left * self->block_cols;
+    unsigned int row_end = (self->block_grid_rows - bottom) * self->block_rows;
+    unsigned int col_end = (self->block_grid_cols - right) * self->block_cols;
+    if (row_end > self->rows)
+        row_end = self->rows;
+    if (col_end > self->cols)
+        col_end = self->cols;
+
+    // The trimmed cells become margin, which must be dead in both buffers.
+    // cells is already dead there, cells_next may still hold the previous
+    // generation.
+    for (unsigned int r = 0; self->cells_next && r < self->rows; ++r) {
+        unsigned char *row = &self->cells_next[(size_t) r * self->stride];
+        if (r < row_begin || r >= row_end) {
+            memset(row, 0, self->cols);
+        } else {
+            memset(row, 0, col_begin);
+            memset(row + col_end, 0, self->cols - col_end);
+        }
+    }
+
+    self->origin_row += row_begin;
+    self->origin_col += col_begin;
+    self->rows = row_end - row_begin;
+    self->cols = col_end - col_begin;
+    self->tl_cell_pos_x += (int) col_begin;
+    self->tl_cell_pos_y += (int) row_begin;
+    updateCellPointers(self);
+
+    size_t wanted = (size_t) (self->rows + self->rows / 2 + 2 * self->block_rows) *
+                    (self->cols + self->cols / 2 + 2 * self->block_cols);
+    if (self->cells_buffer && (size_t) self->capacity_rows * self->stride > 2 * wanted) {
+        if (!reallocCells(self, self->rows, self->cols, 0, 0))
+            return 0;
+        updateCellPointers(self);
+    }
+    if ((self->current & CellsPacked) && !shiftPacked(self, -(int) row_begin, -(int) col_begin))
+        return 0;
+
+    return resizeBlocks(self, -(int) top, -(int) left);
+}
+
+/// Compacts the world if it passed a multiple of compact_interval since
+/// generation previous_generation.
+static int compactOnInterval(struct World *self, uint64_t previous_generation) {
+    uint64_t interval = self->compact_interval;
+    if (!interval || self->topology != TopologyUnbounded || !(self->current & (CellsDense | CellsPacked)) ||
+        previous_generation / interval == self->generation / interval)
+        return 1;
+    return worldCompact(self);
+}
+
+/// True if any cell in cols [col_begin, col_end) of row r is alive, read
+/// from packed if given and otherwise from cells.
+static int isRowAlive(struct World *self, const unsigned char *cells, const uint64_t *packed, unsigned int r,
+                      unsigned int col_begin, unsigned int col_end) {
+    if (packed) {
+        const uint64_t *packed_row = &packed[(size_t) r * self->packed_words];
+        unsigned int w_begin = col_begin / 64;
+        unsigned int w_last = (col_end - 1) / 64;
+        for (unsigned int w = w_begin; w <= w_last; ++w) {
+            uint64_t word = packed_row[w];
+            if (w == w_begin)
+                word &= ~(uint64_t) 0 << (col_begin % 64);
+            if (w == w_last && col_end % 64)
+                word &= ((uint64_t) 1 << (col_end % 64)) - 1;
+            if (word)
+                return 1;
+        }
+        return 0;
+    }
+
+    const unsigned char *row = &cells[(size_t) r * self->stride];
+    for (unsigned int c = col_begin; c < col_end; ++c) {
+        if (row[c])
+            return 1;
+    }
+    return 0;
+}
+
+/// True if any cell in rows [row_begin, row_end) of col c is alive, read
+/// from packed if given and otherwise from cells.
+static int isColAlive(struct World *self, const unsigned char *cells, const uint64_t *packed, unsigned int c,
+                      unsigned int row_begin, unsigned int row_end) {
+    for (unsigned int r = row_begin; r < row_end; ++r) {
+        if (packed ? (packed[(size_t) r * self->packed_words + c / 64] >> (c % 64)) & 1
+                   : cells[(size_t) r * self->stride + c])
+            return 1;
+    }
+    return 0;
+}
+
+/// Bounds in world coords of the live cells of cells, which is cells or
+/// cells_next, or with packed given of packed, which is packed or
+/// packed_next, in rows [row_begin, row_end). row_begin must be the first
+/// row of a block. The block populations give the blocks on the edge, only
+/// those are scanned. Returns 0 if no cell is alive.
+static int liveBoundsInRows(struct World *self, const unsigned char *cells, const uint64_t *packed,
+                            unsigned int row_begin, unsigned int row_end,
+                            int *min_x, int *min_y, int *max_x, int *max_y) {
+    unsigned int br_end = (row_end + self->block_rows - 1) / self->block_rows;
+    unsigned int min_br = br_end, max_br = 0;
+    unsigned int min_bc = self->block_grid_cols, max_bc = 0;
+    for (unsigned int br = row_begin / self->block_rows; br < br_end; ++br) {
+        for (unsigned int bc = 0; bc < self->block_grid_cols; ++bc) {
+            if (!self->block_population[br * self->block_grid_cols + bc])
+                continue;
+            min_br = br < min_br ? br : min_br;
+            max_br = br > max_br ? br : max_br;
+            min_bc = bc < min_bc ? bc : min_bc;
+            max_bc = bc > max_bc ? bc : max_bc;
+        }
+    }
+    if (min_br == br_end)
+        return 0;
+
+    unsigned int block_row_end = (max_br + 1) * self->block_rows;
+    unsigned int col_begin = min_bc * self->block_cols;
+    unsigned int col_end = (max_bc + 1) * self->block_cols < self->cols ? (max_bc + 1) * self->block_cols : self->cols;
+
+    unsigned int top = min_br * self->block_rows;
+    while (!isRowAlive(self, cells, packed, top, col_begin, col_end))
+        ++top;
+    unsigned int bottom = (block_row_end < row_end ? block_row_end : row_end) - 1;
+    while (!isRowAlive(self, cells, packed, bottom, col_begin, col_end))
+        --bottom;
+    unsigned int left = col_begin;
+    while (!isColAlive(self, cells, packed, left, top, bottom + 1))
+        ++left;
+    unsigned int right = col_end - 1;
+    while (!isColAlive(self, cells, packed, right, top, bottom + 1))
+        --right;
+
+    *min_x = self->tl_cell_pos_x + (int) left;
+    *max_x = self->tl_cell_pos_x + (int) right;
+    *min_y = self->tl_cell_pos_y + (int) top;
+    *max_y = self->tl_cell_pos_y + (int) bottom;
+    return 1;
+}
+
+/// Gets the bounds of the live cells in world coords. They are kept from
+/// the last generation, and only found from the block populations or the
+/// tiles or the quadtree after other edits. Returns 0 if no cell is alive.
+int worldLiveBounds(struct World *self, int *min_x, int *min_y, int *max_x, int *max_y) {
+    if (!self->population)
+        return 0;
+
+    if (!self->live_bounds_valid && !(self->current & (CellsDense | CellsPacked))) {
+        int64_t engine_min_x, engine_min_y, engine_max_x, engine_max_y;
+        int live = self->current & CellsTiles ?
+                   tileMapBounds(self->tiles, &engine_min_x, &engine_min_y, &engine_max_x, &engine_max_y) :
+                   hashLifeBounds(self->hashlife, &engine_min_x, &engine_min_y, &engine_max_x, &engine_max_y);
+        if (!live)
+            return 0;
+        self->live_min_x = (int) engine_min_x;
+        self->live_min_y = (int) engine_min_y;
+        self->live_max_x = (int) engine_max_x;
+        self->live_max_y = (int) engine_max_y;
+        self->live_bounds_valid = 1;
+    } else if (!self->live_bounds_valid) {
+        const uint64_t *packed = self->current & CellsDense ? NULL : self->packed;
+        if (!liveBoundsInRows(self, self->cells, packed, 0, self->rows, &self->live_min_x, &self->live_min_y,
+                              &self->live_max_x, &self->live_max_y))
+            return 0;
+        self->live_bounds_valid = 1;
+    }
+
+    *min_x = self->live_min_x;
+    *min_y = self->live_min_y;
+    *max_x = self->live_max_x;
+    *max_y = self->live_max_y;
+    return 1;
+}
+
+uint64_t worldPopulation(struct World *self) {
+    return self->population;
+}
+
+/// Hash of the live cells as if moved so their bounds start at (0, 0), so
+/// the same pattern hashes the same wherever it is. Zero for no live cells.
+uint64_t worldHashAtOrigin(struct World *self) {
+    int min_x, min_y, max_x, max_y;
+    if (!worldLiveBounds(self, &min_x, &min_y, &max_x, &max_y))
+        return 0;
+    return self->hash * hashPower(HASH_P, -(int64_t) min_x) * hashPower(HASH_Q, -(int64_t) min_y);
+}
+
+/// Adds the current generation to the history, and looks for an earlier
+/// generation with the same live cells. An unbounded world may repeat
+/// anywhere, so the hash is taken relative to the live bounds. On a torus
+/// or in a bounded world the cells must repeat in place. generations is
+/// the number of generations since the last call, the history only holds
+/// consecutive generations.
+static void trackPeriod(struct World *self, uint64_t generations) {
+    if (!self->detect_period || self->period_found)
+        return;
+    if (generations != 1)
+        self->history_len = 0;
+
+    struct WorldHistoryEntry entry = {self->hash, self->population, self->generation, 0, 0, 0, 0};
+    int unbounded = self->topology == TopologyUnbounded;
+    if (worldLiveBounds(self, &entry.min_x, &entry.min_y, &entry.max_x, &entry.max_y) && unbounded)
+        entry.hash = worldHashAtOrigin(self);
+
+    // Newest first, so the shortest period is found
+    for (unsigned int i = 1; i <= self->history_len; ++i) {
+        struct WorldHistoryEntry *past = &self->history[(self->history_next + WORLD_HISTORY_LEN - i) % WORLD_HISTORY_LEN];
+        int dx = entry.min_x - past->min_x;
+        int dy = entry.min_y - past->min_y;
+        if (past->hash != entry.hash || past->population != entry.population ||
+            past->max_x - past->min_x != entry.max_x - entry.min_x ||
+            past->max_y - past->min_y != entry.max_y - entry.min_y ||
+            (!unbounded && (dx || dy)))
+            continue;
+
+        self->period.period = entry.generation - past->generation;
+        self->period.dx = dx;
+        self->period.dy = dy;
+        self->period.since = past->generation;
+        self->period_found = 1;
+        return;
+    }
+
+    self->history[self->history_next] = entry;
+    self->history_next = (self->history_next + 1) % WORLD_HISTORY_LEN;
+    if (self->history_len < WORLD_HISTORY_LEN)
+        ++self->history_len;
+}
+
+/// Edges of the world that a live cell touched during an update.
+struct WorldGrowth {
+    int top;
+    int bottom;
+    int left;
+    int right;
+};
+
+/// Rows [row_begin, row_end) of the world updated by one task. The band
+/// sums the changes to the population and hash of its cells.
+struct WorldBand {
+    struct World *world;
+    unsigned int row_begin;
+    unsigned int row_end;
+    struct WorldGrowth grow;
+    unsigned int generations;
+    int64_t population_delta;
+    uint64_t hash_delta;
+
+    // Bounds in world coords of the live cells of the band once updated
+    int live;
+    int min_x;
+    int min_y;
+    int max_x;
+    int max_y;
+};
+
+/// Finds the bounds of the live cells of the band in cells_next, or in
+/// packed_next for the bit packed engine, once the band is updated and its
+/// block populations are up to date.
+static void findBandBounds(struct WorldBand *band) {
+    struct World *self = band->world;
+    const uint64_t *packed_next = self->engine == EngineBitPacked ? self->packed_next : NULL;
+    band->live = liveBoundsInRows(self, self->cells_next, packed_next, band->row_begin, band->row_end,
+                                  &band->min_x, &band->min_y, &band->max_x, &band->max_y);
+}
+
+/// Takes the bounds of the live cells from the bands of a generation.
+static void mergeBandBounds(struct World *self, struct WorldBand *bands, unsigned int num_bands) {
+    int live = 0;
+    for (unsigned int i = 0; i < num_bands; ++i) {
+        if (!bands[i].live)
+            continue;
+        if (!live || bands[i].min_x < self->live_min_x)
+            self->live_min_x = bands[i].min_x;
+        if (!live || bands[i].max_x > self->live_max_x)
+            self->live_max_x = bands[i].max_x;
+        if (!live || bands[i].min_y < self->live_min_y)
+            self->live_min_y = bands[i].min_y;
+        if (!live || bands[i].max_y > self->live_max_y)
+            self->live_max_y = bands[i].max_y;
+        live = 1;
+    }
+    self->live_bounds_valid = live;
+}
+
+/// Computes the next generation of the cells in rows [row_begin, row_end)
+/// and cols [col_begin, col_end), which lie in one block, one byte per cell
+/// into cells_next. Neighbours past the edges are read from the margin,
+/// which is dead or on a torus holds the wrapped cells. Returns 1 if any of
+/// the cells changed.
+static int updateDenseCells(struct World *self, int row_begin, int row_end, int col_begin, int col_end,
+                            uint32_t *block_population, struct WorldBand *band) {
+
+    // The rule table gives the next state of a cell from its state and its
+    // number of live neighbours. For B3/S23:
+    // 1. Any live cell with two or three live neighbours survives.
+    // 2. Any dead cell with three live neighbours becomes a live cell.
+    // 3. All other live cells die in the next generation.
+    const unsigned char *table = self->rule.table;
+    const size_t stride = self->stride;
+    struct WorldGrowth *grow = &band->grow;
+
+    int changed = 0;
+    int population_delta = 0;
+    uint64_t hash_delta = 0;
+    for (int r = row_begin; r < row_end; ++r) {
+        const unsigned char *mid = &self->cells[(size_t) r * stride];
+        const unsigned char *above = mid - stride;
+        const unsigned char *below = mid + stride;
+        unsigned char *out = &self->cells_next[(size_t) r * stride];
+        unsigned char row_bits = 0;
+
+        for (int c = col_begin; c < col_end; ++c) {
+            int live_neighbours = above[c-1] + above[c] + above[c+1] +
+                                  mid[c-1] + mid[c+1] +
+                                  below[c-1] + below[c] + below[c+1];
+            unsigned char cell = mid[c];
+            unsigned char cell_next = table[9 * cell + live_neighbours];
+            out[c] = cell_next;
+            row_bits |= cell_next;
+            if (cell_next != cell) {
+                int delta = (int) cell_next - (int) cell;
+                changed = 1;
+                population_delta += delta;
+                hash_delta += (uint64_t) (int64_t) delta * self->hash_x[c] * self->hash_y[r];
+            }
+        }
+
+        if (row_bits) {
+            if (r == 0)
+                grow->top = 1;
+            if (r == (int) self->rows - 1)
+                grow->bottom = 1;
+            if (col_begin == 0 && out[0])
+                grow->left = 1;
+            if (col_end == (int) self->cols && out[self->cols - 1])
+                grow->right = 1;
+        }
+    }
+
+    *block_population += population_delta;
+    band->population_delta += population_delta;
+    band->hash_delta += hash_delta;
+    return changed;
+}
+
+/// True if the block or any of its neighbours changed in the last generation.
+/// On a torus the blocks on opposite edges are neighbours.
+static int isBlockActive(struct World *self, int br, int bc) {
+    int grid_rows = (int) self->block_grid_rows;
+    int grid_cols = (int) self->block_grid_cols;
+    int torus = self->topology == TopologyTorus;
+
+    for (int dr = -1; dr <= 1; ++dr) {
+        for (int dc = -1; dc <= 1; ++dc) {
+            int nr = br + dr;
+            int nc = bc + dc;
+            if (torus) {
+                nr = (nr + grid_rows) % grid_rows;
+                nc = (nc + grid_cols) % grid_cols;
+            } else if (nr < 0 || nc < 0 || nr >= grid_rows || nc >= grid_cols) {
+                continue;
+            }
+            if (self->block_changed[nr * self->block_grid_cols + nc])
+                return 1;
+        }
+    }
+    return 0;
+}
+
+/// Builds lookup_table for the rule if it is not built already. Entry k is
+/// the next state of the middle 2x2 cells of the 4x4 cells packed in k: bits
+/// 15..12 are the top row, 3..0 the bottom row, and the high bit of each
+/// row is its left col. The result has bit 3 for the top left cell, 2 for
+/// the top right, 1 for the bottom left and 0 for the bottom right.
+static int reserveLookupTable(struct World *self) {
+    if (self->lookup_table && lifeRuleEqual(&self->lookup_rule, &self->rule))
+        return 1;
+
+    if (!self->lookup_table) {
+        self->lookup_table = malloc(1 << 16);
+        if (!self->lookup_table) {
+            fprintf(stderr, "world::reserveLookupTable: Error! Failed to allocate memory for the lookup table.\n");
+            return 0;
+        }
+    }
+
+    for (unsigned int key = 0; key < (1 << 16); ++key) {
+        unsigned char result = 0;
+        for (int r = 1; r <= 2; ++r) {
+            for (int c = 1; c <= 2; ++c) {
+                int live_neighbours = 0;
+                for (int dr = -1; dr <= 1; ++dr) {
+                    for (int dc = -1; dc <= 1; ++dc) {
+                        if (dr || dc)
+                            live_neighbours += (key >> (15 - 4 * (r + dr) - (c + dc))) & 1;
+                    }
+                }
+                int alive = (key >> (15 - 4 * r - c)) & 1;
+                result |= self->rule.table[9 * alive + live_neighbours] << (3 - 2 * (r - 1) - (c - 1));
+            }
+        }
+        self->lookup_table[key] = result;
+    }
+
+    self->lookup_rule = self->rule;
+    return 1;
+}
+
+/// Four cells of a row as a nibble, the first cell in the high bit. The
+/// cells are read as one little endian word, and the multiply gathers the
+/// low bit of each byte into the top byte of the product without carries.
+static inline unsigned int cellNibble(const unsigned char *cells) {
+    uint32_t word;
+    memcpy(&word, cells, sizeof(word));
+    return ((word * 0x08040201u) >> 24) & 0xF;
+}
+
+/// Computes the next generation of the cells in rows [row_begin, row_end)
+/// and cols [col_begin, col_end), which lie in one block, into cells_next.
+/// Each 2x2 cells are looked up in lookup_table from the 4x4 cells around
+/// them, read as a nibble per row. Neighbours past the edges are read from the margin, as in
+/// updateDenseCells, which updates any odd row or col left over. Returns 1
+/// if any of the cells changed.
+static int updateLookupCells(struct World *self, int row_begin, int row_end, int col_begin, int col_end,
+                             uint32_t *block_population, struct WorldBand *band) {
+
+    const unsigned char *table = self->lookup_table;
+    const size_t stride = self->stride;
+    struct WorldGrowth *grow = &band->grow;
+    int pair_row_end = row_begin + ((row_end - row_begin) & ~1);
+    int pair_col_end = col_begin + ((col_end - col_begin) & ~1);
+    if (pair_col_end == col_begin)
+        pair_row_end = row_begin;
+
+    uint32_t changed = 0;
+    int population_delta = 0;
+    uint64_t hash_delta = 0;
+    for (int r = row_begin; r < pair_row_end; r += 2) {
+        const unsigned char *row0 = &self->cells[(size_t) (r - 1) * stride];
+        const unsigned char *row1 = row0 + stride;
+        const unsigned char *row2 = row1 + stride;
+        const unsigned char *row3 = row2 + stride;
+        unsigned char *out0 = &self->cells_next[(size_t) r * stride];
+        unsigned char *out1 = out0 + stride;
+        unsigned char row_bits = 0;
+
+        // Bit i is the cell at col col_begin + i of the top or bottom row.
+        // Branching on each change is slow on soups, so the changed cells
+        // are collected and counted once the row pair is done. Blocks are
+        // at most 32 cols wide.
+        uint32_t top_alive = 0, top_changed = 0;
+        uint32_t bottom_alive = 0, bottom_changed = 0;
+
+        for (int c = col_begin; c < pair_col_end; c += 2) {
+            unsigned int n0 = cellNibble(&row0[c-1]);
+            unsigned int n1 = cellNibble(&row1[c-1]);
+            unsigned int n2 = cellNibble(&row2[c-1]);
+            unsigned int n3 = cellNibble(&row3[c-1]);
+            unsigned int next = table[(n0 << 12) | (n1 << 8) | (n2 << 4) | n3];
+            unsigned int prev = ((n1 & 0x6) << 1) | ((n2 & 0x6) >> 1);
+            out0[c] = (next >> 3) & 1;
+            out0[c+1] = (next >> 2) & 1;
+            out1[c] = (next >> 1) & 1;
+            out1[c+1] = next & 1;
+            row_bits |= next;
+
+            unsigned int shift = c - col_begin;
+            unsigned int diff = next ^ prev;
+            top_alive |= ((next >> 3) & 1) << shift | ((next >> 2) & 1) << (shift + 1);
+            top_changed |= ((diff >> 3) & 1) << shift | ((diff >> 2) & 1) << (shift + 1);
+            bottom_alive |= ((next >> 1) & 1) << shift | (next & 1) << (shift + 1);
+            bottom_changed |= ((diff >> 1) & 1) << shift | (diff & 1) << (shift + 1);
+        }
+
+        changed |= top_changed | bottom_changed;
+        for (int half = 0; half < 2; ++half) {
+            uint32_t alive = half ? bottom_alive : top_alive;
+            uint32_t cells_changed = half ? bottom_changed : top_changed;
+            uint64_t row_hash_delta = 0;
+            while (cells_changed) {
+                unsigned int bit = __builtin_ctz(cells_changed);
+                int delta = (alive >> bit) & 1 ? 1 : -1;
+                population_delta += delta;
+                row_hash_delta += (uint64_t) (int64_t) delta * self->hash_x[col_begin + bit];
+                cells_changed &= cells_changed - 1;
+            }
+            hash_delta += row_hash_delta * self->hash_y[r + half];
+        }
+
+        if (row_bits & 0xC && r == 0)
+            grow->top = 1;
+        if (row_bits & 0x3 && r + 2 == (int) self->rows)
+            grow->bottom = 1;
+        if (col_begin == 0 && (out0[0] || out1[0]))
+            grow->left = 1;
+        if (pair_col_end == (int) self->cols && (out0[self->cols - 1] || out1[self->cols - 1]))
+            grow->right = 1;
+    }
+
+    *block_population += population_delta;
+    band->population_delta += population_delta;
+    band->hash_delta += hash_delta;
+
+    // Odd row and col left over
+    if (pair_col_end < col_end && pair_row_end > row_begin)
+        changed |= updateDenseCells(self, row_begin, pair_row_end, pair_col_end, col_end, block_population, band);
+    if (pair_row_end < row_end)
+        changed |= updateDenseCells(self, pair_row_end, row_end, col_begin, col_end, block_population, band);
+    return changed != 0;
+}
+
+/// Computes the next generation of rows [row_begin, row_end) one byte per
+/// cell into cells_next, with updateDenseCells or with updateLookupCells
+/// for EngineLookupTable. row_begin must be the first row of a block. Only
+/// active blocks are evaluated. An inactive block did not change in the
+/// last generation, so cells_next already holds its state from the swap.
+static void updateDense(struct World *self, struct WorldBand *band) {
+    int row_begin = band->row_begin;
+    int row_end = band->row_end;
+    int block_rows = self->block_rows;
+    int block_cols = self->block_cols;
+
+    for (int r0 = row_begin; r0 < row_end; r0 += block_rows) {
+        int r1 = r0 + block_rows < row_end ? r0 + block_rows : row_end;
+        int br = r0 / block_rows;
+
+        for (int c0 = 0; c0 < (int) self->cols; c0 += block_cols) {
+            int c1 = c0 + block_cols < (int) self->cols ? c0 + block_cols : (int) self->cols;
+            int bc = c0 / block_cols;
+            int b = br * self->block_grid_cols + bc;
+
+            if (!isBlockActive(self, br, bc))
+                self->block_changed_next[b] = 0;
+            else if (self->engine == EngineLookupTable)
+                self->block_changed_next[b] = updateLookupCells(self, r0, r1, c0, c1, &self->block_population[b], band);
+            else
+                self->block_changed_next[b] = updateDenseCells(self, r0, r1, c0, c1, &self->block_population[b], band);
+        }
+    }
+}
+
+/// Resizes the packed buffers to match the size of cells.
+static int reservePacked(struct World *self) {
+    unsigned int words = (self->cols + 63) / 64;
+    if (self->packed && words == self->packed_words && self->rows == self->packed_rows)
+        return 1;
+
+    size_t count = (size_t) words * self->rows;
+    uint64_t *packed = realloc(self->packed, sizeof(uint64_t) * count);
+    if (!packed) {
+        fprintf(stderr, "world::reservePacked: Error! Failed to allocate memory for packed cells.\n");
+        return 0;
+    }
+    self->packed = packed;
+
+    uint64_t *packed_next = realloc(self->packed_next, sizeof(uint64_t) * count);
+    if (!packed_next) {
+        fprintf(stderr, "world::reservePacked: Error! Failed to allocate memory for packed_next cells.\n");
+        return 0;
+    }
+    self->packed_next = packed_next;
+
+    self->packed_words = words;
+    self->packed_rows = self->rows;
+    return 1;
+}
+
+/// Packs rows [row_begin, row_end) of cells into 64 cell words. Bits past
+/// the last col are left clear.
+static void packCells(struct World *self, unsigned int row_begin, unsigned int row_end) {
+    for (unsigned int r = row_begin; r < row_end; ++r) {
+        const unsigned char *row = &self->cells[(size_t) r * self->stride];
+        uint64_t *packed_row = &self->packed[(size_t) r * self->packed_words];
+        for (unsigned int w = 0; w < self->packed_words; ++w) {
+            unsigned int c_begin = w * 64;
+            unsigned int c_end = c_begin + 64 < self->cols ? c_begin + 64 : self->cols;
+            uint64_t word = 0;
+            for (unsigned int c = c_begin; c < c_end; ++c)
+                word |= (uint64_t) (row[c] != 0) << (c - c_begin);
+            packed_row[w] = word;
+        }
+    }
+}
+
+/// Unpacks rows [row_begin, row_end) of packed into cells.
+static void unpackCells(struct World *self, unsigned int row_begin, unsigned int row_end) {
+    for (unsigned int r = row_begin; r < row_end; ++r) {
+        unsigned char *row = &self->cells[(size_t) r * self->stride];
+        const uint64_t *packed_row = &self->packed[(size_t) r * self->packed_words];
+        for (unsigned int c = 0; c < self->cols; ++c)
+            row[c] = (packed_row[c / 64] >> (c % 64)) & 1;
+    }
+}
+
+/// Word w of a packed row with its cells moved one col right, so bit i
+/// holds col 64 * w + i - 1. On a torus col -1 is the last col.
+static inline uint64_t rowShiftedRight(const uint64_t *row, unsigned int w, unsigned int words,
+                                       unsigned int last_bits, int torus) {
+    if (w > 0)
+        return shiftInLeft(row[w], row[w-1]);
+    uint64_t wrap = torus ? (row[words-1] >> (last_bits - 1)) << 63 : 0;
+    return shiftInLeft(row[0], wrap);
+}
+
+/// Word w of a packed row with its cells moved one col left, so bit i
+/// holds col 64 * w + i + 1. On a torus the col past the last is col 0.
+static inline uint64_t rowShiftedLeft(const uint64_t *row, unsigned int w, unsigned int words,
+                                      unsigned int last_bits, int torus) {
+    if (w + 1 < words)
+        return shiftInRight(row[w], row[w+1]);
+    uint64_t shifted = row[w] >> 1;
+    if (torus)
+        shifted |= (row[0] & 1) << (last_bits - 1);
+    return shifted;
+}
+
+/// Computes the next generation of rows [row_begin, row_end) of packed into
+/// packed_next, 64 cells at a time.
+static void stepPacked(struct World *self, struct WorldBand *band) {
+
+    const unsigned int row_begin = band->row_begin;
+    const unsigned int row_end = band->row_end;
+    struct WorldGrowth *grow = &band->grow;
+
+    const unsigned int words = self->packed_words;
+    const unsigned int rows = self->rows;
+    unsigned int last_bits = self->cols - (words - 1) * 64;
+    const uint64_t last_mask = last_bits == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << last_bits) - 1;
+    const uint64_t right_edge = (uint64_t) 1 << (last_bits - 1);
+
+    const int torus = self->topology == TopologyTorus;
+    const uint64_t *first_row = self->packed;
+    const uint64_t *last_row = &self->packed[(size_t) (rows - 1) * words];
+
+    uint64_t left_edge_bits = 0;
+    uint64_t right_edge_bits = 0;
+
+    for (unsigned int r = row_begin; r < row_end; ++r) {
+        const uint64_t *mid = &self->packed[(size_t) r * words];
+        const uint64_t *above = r > 0 ? mid - words : (torus ? last_row : NULL);
+        const uint64_t *below = r + 1 < rows ? mid + words : (torus ? first_row : NULL);
+        uint64_t *out = &self->packed_next[(size_t) r * words];
+        uint64_t row_bits = 0;
+
+        for (unsigned int w = 0; w < words; ++w) {
+
+            // Each row contributes the word itself plus the words shifted by
+            // one cell, borrowing the edge bit from the neighbouring words.
+            uint64_t a = 0, al = 0, ar = 0;
+            if (above) {
+                a = above[w];
+                al = rowShiftedRight(above, w, words, last_bits, torus);
+                ar = rowShiftedLeft(above, w, words, last_bits, torus);
+            }
+            uint64_t m = mid[w];
+            uint64_t ml = rowShiftedRight(mid, w, words, last_bits, torus);
+            uint64_t mr = rowShiftedLeft(mid, w, words, last_bits, torus);
+            uint64_t b = 0, bl = 0, br = 0;
+            if (below) {
+                b = below[w];
+                bl = rowShiftedRight(below, w, words, last_bits, torus);
+                br = rowShiftedLeft(below, w, words, last_bits, torus);
+            }
+
+            uint64_t next = lifeWordNextRule(al, a, ar, ml, m, mr, bl, b, br, &self->rule);
+            if (w + 1 == words)
+                next &= last_mask;
+
+            out[w] = next;
+            row_bits |= next;
+            if (w == 0)
+                left_edge_bits |= next;
+
+            // Cells that changed, one bit at a time
+            uint64_t changed = next ^ m;
+            while (changed) {
+                unsigned int bit = __builtin_ctzll(changed);
+                unsigned int c = w * 64 + bit;
+                int delta = (next >> bit) & 1 ? 1 : -1;
+                self->block_population[(r / self->block_rows) * self->block_grid_cols + c / self->block_cols] += delta;
+                band->population_delta += delta;
+                band->hash_delta += (uint64_t) (int64_t) delta * self->hash_x[c] * self->hash_y[r];
+                changed &= changed - 1;
+            }
+            if (w + 1 == words)
+                right_edge_bits |= next;
+        }
+
+        if (row_bits) {
+            if (r == 0)
+                grow->top = 1;
+            if (r + 1 == rows)
+                grow->bottom = 1;
+        }
+    }
+
+    if (left_edge_bits & 1)
+        grow->left = 1;
+    if (right_edge_bits & right_edge)
+        grow->right = 1;
+}
+
+/// Advances one tile of packed, rows [row_begin, row_end) and words
+/// [word_begin, word_end), by band->generations generations into
+/// packed_next. The tile is copied into scratch with a halo of one row per
+/// generation above and below and one word to each side, and stepped in
+/// place, so the world is read and written once rather than once per
+/// generation. Wrong cells spread in from the edges of the halo by one cell
+/// per generation and never reach the tile. Cells outside the world are
+/// never stepped and stay dead, the caller has grown the world so that no
+/// live cell reaches its edges.
+static void stepTile(struct World *self, struct WorldBand *band, uint64_t *scratch,
+                     unsigned int row_begin, unsigned int row_end,
+                     unsigned int word_begin, unsigned int word_end) {
+
+    const int k = (int) band->generations;
+    const int words = (int) self->packed_words;
+    const int rows = (int) self->rows;
+    unsigned int last_bits = self->cols - (words - 1) * 64;
+    const uint64_t last_mask = last_bits == 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << last_bits) - 1;
+
+    // Scratch row i and word j hold row top + i and word left + j. The
+    // first and last row and word of scratch are always dead, so the
+    // kernel needs no edge checks.
+    const int top = (int) row_begin - k - 1;
+    const int left = (int) word_begin - 2;
+    const int scratch_rows = (int) (row_end - row_begin) + 2 * k + 2;
+    const int scratch_words = (int) (word_end - word_begin) + 4;
+    const size_t scratch_size = (size_t) scratch_rows * scratch_words;
+    uint64_t *cur = scratch;
+    uint64_t *next = scratch + scratch_size;
+
+    // Rows and words of scratch that lie in the world
+    const int i_begin = top < 0 ? -top : 1;
+    const int i_end = top + scratch_rows - 1 > rows ? rows - top : scratch_rows - 1;
+    const int j_begin = left < 0 ? -left : 1;
+    const int j_end = left + scratch_words - 1 > words ? words - left : scratch_words - 1;
+
+    memset(cur, 0, sizeof(uint64_t) * scratch_size);
+    memset(next, 0, sizeof(uint64_t) * scratch_size);
+    for (int i = i_begin; i < i_end; ++i)
+        memcpy(&cur[(size_t) i * scratch_words + j_begin],
+               &self->packed[(size_t) (top + i) * words + left + j_begin],
+               sizeof(uint64_t) * (j_end - j_begin));
+
+    for (int g = 1; g <= k; ++g) {
+
+        // Rows within g of the edge of scratch are wrong after g steps
+        int i0 = g > i_begin ? g : i_begin;
+        int i1 = scratch_rows - g < i_end ? scratch_rows - g : i_end;
+        for (int i = i0; i < i1; ++i) {
+            const uint64_t *mid = &cur[(size_t) i * scratch_words];
+            const uint64_t *above = mid - scratch_words;
+            const uint64_t *below = mid + scratch_words;
+            uint64_t *out = &next[(size_t) i * scratch_words];
+
+            for (int j = j_begin; j < j_end; ++j) {
+                uint64_t word = lifeWordNextRule(shiftInLeft(above[j], above[j-1]), above[j], shiftInRight(above[j], above[j+1]),
+                                                 shiftInLeft(mid[j], mid[j-1]), mid[j], shiftInRight(mid[j], mid[j+1]),
+                                                 shiftInLeft(below[j], below[j-1]), below[j], shiftInRight(below[j], below[j+1]),
+                                                 &self->rule);
+                out[j] = left + j == words - 1 ? word & last_mask : word;
+            }
+        }
+
+        uint64_t *swap = cur;
+        cur = next;
+        next = swap;
+    }
+
+    // Write the tile back, counting the cells that changed over the pass
+    for (unsigned int r = row_begin; r < row_end; ++r) {
+        const uint64_t *stepped = &cur[(size_t) ((int) r - top) * scratch_words];
+        const uint64_t *prev = &self->packed[(size_t) r * words];
+        uint64_t *out = &self->packed_next[(size_t) r * words];
+
+        for (unsigned int w = word_begin; w < word_end; ++w) {
+            uint64_t word = stepped[(int) w - left];
+            out[w] = word;
+            uint64_t changed = word ^ prev[w];
+            while (changed) {
+                unsigned int bit = __builtin_ctzll(changed);
+                unsigned int c = w * 64 + bit;
+                int delta = (word >> bit) & 1 ? 1 : -1;
+                self->block_population[(r / self->block_rows) * self->block_grid_cols + c / self->block_cols] += delta;
+                band->population_delta += delta;
+                band->hash_delta += (uint64_t) (int64_t) delta * self->hash_x[c] * self->hash_y[r];
+                changed &= changed - 1;
+            }
+        }
+    }
+}
+
+/// Advances the rows of the band by band->generations generations, tile by
+/// tile, into packed_next.
+static void stepTilesBandTask(void *arg, unsigned int i) {
+    struct WorldBand *band = (struct WorldBand *) arg + i;
+    struct World *self = band->world;
+
+    size_t scratch_size = (size_t) (TILE_ROWS + 2 * band->generations + 2) * (TILE_WORDS + 4);
+    uint64_t *scratch = malloc(sizeof(uint64_t) * 2 * scratch_size);
+    if (!scratch) {
+        // Reported by the caller, which sees the band has not finished
+        band->generations = 0;
+        return;
+    }
+
+    for (unsigned int r = band->row_begin; r < band->row_end; r += TILE_ROWS) {
+        unsigned int r1 = r + TILE_ROWS < band->row_end ? r + TILE_ROWS : band->row_end;
+        for (unsigned int w = 0; w < self->packed_words; w += TILE_WORDS) {
+            unsigned int w1 = w + TILE_WORDS < self->packed_words ? w + TILE_WORDS : self->packed_words;
+            stepTile(self, band, scratch, r, r1, w, w1);
+        }
     }
 
-    return self;
+    free(scratch);
+    findBandBounds(band);
 }
 
-void worldDestroy(struct World *self) {
-    if (!self)
-        return;
-    
-    free(self->cells);
-    free(self->cells_next);
-    free(self);
+static void denseBandTask(void *arg, unsigned int i) {
+    struct WorldBand *band = (struct WorldBand *) arg + i;
+    updateDense(band->world, band);
+    findBandBounds(band);
 }
 
-static int isWithinDomain(struct World *self, int c, int r) {
-    return r >= 0 && c >= 0 && r < (int) self->rows && c < (int) self->cols;
+static void packBandTask(void *arg, unsigned int i) {
+    struct WorldBand *band = (struct WorldBand *) arg + i;
+    packCells(band->world, band->row_begin, band->row_end);
 }
 
-/// Grows the size of the cells in the specified directions.
-int worldIncreaseCells(struct World *self, int grow_top, int grow_bottom, int grow_left, int grow_right) {
-    self->rows = self->rows + (unsigned int) (grow_top + grow_bottom) * self->block_rows;
-    self->cols = self->cols + (unsigned int) (grow_left + grow_right) * self->block_cols;
-    self->cells = realloc(self->cells, sizeof(unsigned char) * self->rows * self->cols);
-    
-    if (!self->cells) {
-        fprintf(stderr, "world::worldIncreaseCells: Error! Failed to allocate memory to increase cells.\n");
-        return 0;            
+static void unpackBandTask(void *arg, unsigned int i) {
+    struct WorldBand *band = (struct WorldBand *) arg + i;
+    unpackCells(band->world, band->row_begin, band->row_end);
+}
+
+static void stepPackedBandTask(void *arg, unsigned int i) {
+    struct WorldBand *band = (struct WorldBand *) arg + i;
+    stepPacked(band->world, band);
+    findBandBounds(band);
+}
+
+/// Splits the rows of the world into bands of whole blocks, of roughly
+/// equal height. Returns the number of bands.
+static unsigned int splitBands(struct World *self, struct WorldBand bands[MAX_WORLD_BANDS]) {
+    unsigned int num_bands = countBands(self, self->block_grid_rows);
+    for (unsigned int i = 0; i < num_bands; ++i) {
+        bands[i].world = self;
+        bandRows(self, self->rows, num_bands, i, &bands[i].row_begin, &bands[i].row_end);
+        bands[i].grow = (struct WorldGrowth) {0, 0, 0, 0};
+        bands[i].generations = 1;
+        bands[i].population_delta = 0;
+        bands[i].hash_delta = 0;
+        bands[i].live = 0;
+    }
+    return num_bands;
+}
+
+/// Makes the cells the engine steps current, before it steps them. The
+/// dense cells are packed once when the bit packed engine takes over and
+/// copied into tiles or a quadtree once when the sparse or hashlife engine
+/// does, and brought up to date once when another engine takes over again.
+/// Only the cells of the engine are current after the step. bands are only
+/// used to pack cells.
+static int useEngineCells(struct World *self, struct WorldBand *bands, unsigned int num_bands) {
+    switch (self->engine) {
+        case EngineBitPacked:
+            if (!(self->current & CellsPacked)) {
+                if (!reservePacked(self))
+                    return 0;
+                threadPoolRun(self->pool, packBandTask, bands, num_bands);
+            }
+            releaseCells(self, CellsPacked);
+            return 1;
+        case EngineSparse:
+            if (!(self->current & CellsTiles)) {
+                if (!self->tiles) {
+                    self->tiles = tileMapCreate();
+                    if (!self->tiles)
+                        return 0;
+                }
+                if (!worldSyncCells(self) ||
+                    !tileMapSetCells(self->tiles, self->cells, self->rows, self->cols, self->stride,
+                                     self->tl_cell_pos_x, self->tl_cell_pos_y))
+                    return 0;
+            }
+            releaseCells(self, CellsTiles);
+            return 1;
+        case EngineHashLife:
+            if (!(self->current & CellsHashLife)) {
+                if (!self->hashlife) {
+                    self->hashlife = hashLifeCreate();
+                    if (!self->hashlife)
+                        return 0;
+                }
+                if (!worldSyncCells(self) ||
+                    !hashLifeSetCells(self->hashlife, self->cells, self->rows, self->cols, self->stride,
+                                      self->tl_cell_pos_x, self->tl_cell_pos_y))
+                    return 0;
+            }
+            releaseCells(self, CellsHashLife);
+            return 1;
+        default:
+            if (!worldSyncCells(self))
+                return 0;
+            releaseCells(self, CellsDense);
+            return 1;
+    }
+}
+
+/// Makes the next generation of the packed cells the current one.
+static void swapPacked(struct World *self) {
+    uint64_t *packed = self->packed;
+    self->packed = self->packed_next;
+    self->packed_next = packed;
+}
+
+/// Brings the dense cells up to date once another engine has stepped its
+/// own cells, for readers of cells such as the census and the tests. The
+/// packed cells are unpacked into cells of the same size. The tiles and
+/// the quadtree are written into cells covering their live cells, rounded
+/// out to blocks, which fails if the live cells are too far apart. The
+/// dense cells stay current until the next step. Does nothing if they are current.
+int worldSyncCells(struct World *self) {
+    if (self->current & CellsDense)
+        return 1;
+
+    if (self->current & CellsPacked) {
+        if (!reallocCells(self, self->rows, self->cols, 0, 0))
+            return 0;
+        updateCellPointers(self);
+
+        struct WorldBand bands[MAX_WORLD_BANDS];
+        unsigned int num_bands = splitBands(self, bands);
+        threadPoolRun(self->pool, unpackBandTask, bands, num_bands);
+        markAllBlocksChanged(self);
+        self->current |= CellsDense;
+        return 1;
+    }
+
+    int min_x = self->tl_cell_pos_x, min_y = self->tl_cell_pos_y;
+    int max_x = min_x, max_y = min_y;
+    worldLiveBounds(self, &min_x, &min_y, &max_x, &max_y);
+    uint64_t rows = ((uint64_t) ((int64_t) max_y - min_y) / self->block_rows + 1) * self->block_rows;
+    uint64_t cols = ((uint64_t) ((int64_t) max_x - min_x) / self->block_cols + 1) * self->block_cols;
+    if (rows * cols > MAX_WORLD_CELLS) {
+        fprintf(stderr, "world::worldSyncCells: Error! The live cells are too far apart to hold in dense cells.\n");
+        return 0;
+    }
+
+    if (!reallocCells(self, (unsigned int) rows, (unsigned int) cols, 0, 0))
+        return 0;
+    self->rows = (unsigned int) rows;
+    self->cols = (unsigned int) cols;
+    self->tl_cell_pos_x = min_x;
+    self->tl_cell_pos_y = min_y;
+    updateCellPointers(self);
+    if (!resizeBlocks(self, 0, 0))
+        return 0;
+
+    worldGetCells(self, self->cells, self->rows, self->cols, self->stride, min_x, min_y);
+    recountCells(self);
+    self->current |= CellsDense;
+    return 1;
+}
+
+/// Computes the next generation with the dense or bit packed engine and
+/// makes it the current one. With allow_growth set the world grows if a
+/// live cell reached an edge, otherwise the caller has made room.
+static int stepGeneration(struct World *self, int allow_growth) {
+
+    struct WorldBand bands[MAX_WORLD_BANDS];
+    unsigned int num_bands = splitBands(self, bands);
+    if (!useEngineCells(self, bands, num_bands))
+        return 0;
+
+    if (self->topology == TopologyTorus && self->engine != EngineBitPacked)
+        wrapTorusMargin(self);
+
+    switch (self->engine) {
+        case EngineBitPacked:
+            threadPoolRun(self->pool, stepPackedBandTask, bands, num_bands);
+            break;
+        case EngineLookupTable:
+            if (!reserveLookupTable(self))
+                return 0;
+            threadPoolRun(self->pool, denseBandTask, bands, num_bands);
+            break;
+        case EngineDense:
+        default:
+            threadPoolRun(self->pool, denseBandTask, bands, num_bands);
+            break;
+    }
+
+    if (self->engine == EngineDense || self->engine == EngineLookupTable) {
+        unsigned char *block_changed = self->block_changed;
+        self->block_changed = self->block_changed_next;
+        self->block_changed_next = block_changed;
+    } else {
+        markAllBlocksChanged(self);
+    }
+
+    struct WorldGrowth grow = {0, 0, 0, 0};
+    for (unsigned int i = 0; i < num_bands; ++i) {
+        self->population += bands[i].population_delta;
+        self->hash += bands[i].hash_delta;
+        grow.top |= bands[i].grow.top;
+        grow.bottom |= bands[i].grow.bottom;
+        grow.left |= bands[i].grow.left;
+        grow.right |= bands[i].grow.right;
+    }
+    mergeBandBounds(self, bands, num_bands);
+
+    // The next generation becomes the current one
+    if (self->engine == EngineBitPacked) {
+        swapPacked(self);
+    } else {
+        unsigned char *cells = self->cells;
+        unsigned char *cells_buffer = self->cells_buffer;
+        self->cells = self->cells_next;
+        self->cells_buffer = self->cells_next_buffer;
+        self->cells_next = cells;
+        self->cells_next_buffer = cells_buffer;
     }
 
-    for (int i = 0; i < self->rows * self->cols; ++i)
-        self->cells[i] = 0;
+    // Increase the size of the domain if necessary
+    int unbounded = self->topology == TopologyUnbounded;
+    if (allow_growth && unbounded && (grow.left || grow.right || grow.top || grow.bottom)) {
+        if (!worldIncreaseCells(self, grow.top, grow.bottom, grow.left, grow.right))
+            return 0;
+    }
 
-    if (grow_left)
-        self->tl_cell_pos_x = self->tl_cell_pos_x - self->block_cols;
-    if (grow_top)
-        self->tl_cell_pos_y = self->tl_cell_pos_y - self->block_rows;
+    ++self->generation;
+    return 1;
 }
 
-/// Grows cellsNext to match the size of cells. Call after copying cells next into cells.
-int worldIncreaseCellsNext(struct World *self) {
-    self->cn_rows = self->rows;
-    self->cn_cols = self->cols;
-    self->cells_next = realloc(self->cells_next, sizeof(unsigned char) * self->rows * self->cols);
-    if (!self->cells_next) {
-        fprintf(stderr, "world::worldIncreaseCellsNext: Error! Failed to allocate memory to increase cells_next.\n");
-        return 0;            
+/// Advances the bit packed engine by generations generations, at most
+/// MAX_TILE_GENERATIONS, with one pass over the world, see stepTile. The
+/// caller has made room for the live cells to grow. Not used on a torus,
+/// whose halos would have to wrap.
+static int stepGenerationsTiled(struct World *self, unsigned int generations) {
+
+    struct WorldBand bands[MAX_WORLD_BANDS];
+    unsigned int num_bands = splitBands(self, bands);
+    for (unsigned int i = 0; i < num_bands; ++i)
+        bands[i].generations = generations;
+
+    if (!useEngineCells(self, bands, num_bands))
+        return 0;
+    threadPoolRun(self->pool, stepTilesBandTask, bands, num_bands);
+
+    for (unsigned int i = 0; i < num_bands; ++i) {
+        if (bands[i].generations != generations) {
+            fprintf(stderr, "world::stepGenerationsTiled: Error! Failed to allocate memory for a tile.\n");
+            return 0;
+        }
+    }
+
+    markAllBlocksChanged(self);
+    for (unsigned int i = 0; i < num_bands; ++i) {
+        self->population += bands[i].population_delta;
+        self->hash += bands[i].hash_delta;
     }
+    mergeBandBounds(self, bands, num_bands);
+    swapPacked(self);
+
+    self->generation += generations;
+    return 1;
 }
 
 int worldUpdate(struct World *self) {
@@ -94,120 +1764,567 @@ int worldUpdate(struct World *self) {
     if (self->updates_paused)
         return 1;
 
-    // 1. Any live cell with two or three live neighbours survives.
-    // 2. Any dead cell with three live neighbours becomes a live cell.
-    // 3. All other live cells die in the next generation.
+    if (self->engine == EngineHashLife || self->engine == EngineSparse)
+        return worldAdvance(self, 1);
 
-    int grow_left = 0;
-    int grow_right = 0;
-    int grow_top = 0;
-    int grow_bottom = 0;
-
-    for (int r = 0; r < (int) self->rows; ++r) {
-        for (int c = 0; c < (int) self->cols; ++c) {
-
-            // Current state of the cell
-            unsigned char cell = 0;
-            if (isWithinDomain(self, c, r))
-                cell = *worldCell(self, c, r);
- 
-            int live_neighbours = 0;
-            for (int dr = -1; dr <= 1; ++dr) {
-                for (int dc = -1; dc <= 1; ++dc) {
-                    if (!isWithinDomain(self, c+dc, r+dr) || (dc == 0 && dr == 0))
-                        continue;
-                    
-                    if (*worldCell(self, c+dc, r+dr))
-                        ++live_neighbours;
-                }
-            }
+    if (!stepGeneration(self, 1))
+        return 0;
+    if (!compactOnInterval(self, self->generation - 1))
+        return 0;
 
-            if (!cell && live_neighbours == 3 ||
-                (cell && (live_neighbours == 2 || live_neighbours == 3))) {
-                unsigned char *cell_next = worldCellNext(self, c, r);
-                *cell_next = 1;
-                
-                if (!grow_top && r == 0)
-                    grow_top = 1;
-                if (!grow_bottom && r == self->rows-1)
-                    grow_bottom = 1;
-                if (!grow_left && c == 0)
-                    grow_left = 1;
-                if (!grow_right && c == self->cols-1)
-                    grow_right = 1;
+    trackPeriod(self, 1);
+    return 1;
+}
 
-            } else {
-                unsigned char *cell_next = worldCellNext(self, c, r);
-                *cell_next = 0;
+/// Blocks of size block needed to move an edge at edge_pos past pos, so
+/// that pos is no longer on the edge. dir is -1 for top/left, 1 otherwise.
+static int blocksToUncover(int64_t edge_pos, int64_t pos, int dir, unsigned int block) {
+    int64_t overlap = (pos - edge_pos) * dir;
+    if (overlap < 0)
+        return 0;
+    return (int) (overlap / block + 1);
+}
+
+/// Grows the cells by whole blocks until no live cell within the bounds,
+/// given in world coords, is on or past an edge. Tiles have no edges.
+static int growToBounds(struct World *self, int64_t min_x, int64_t min_y, int64_t max_x, int64_t max_y) {
+    if (!(self->current & (CellsDense | CellsPacked)))
+        return 1;
+
+    struct WorldGrowth grow;
+    grow.left = blocksToUncover(self->tl_cell_pos_x, min_x, -1, self->block_cols);
+    grow.right = blocksToUncover(self->tl_cell_pos_x + (int64_t) self->cols - 1, max_x, 1, self->block_cols);
+    grow.top = blocksToUncover(self->tl_cell_pos_y, min_y, -1, self->block_rows);
+    grow.bottom = blocksToUncover(self->tl_cell_pos_y + (int64_t) self->rows - 1, max_y, 1, self->block_rows);
+
+    uint64_t rows = self->rows + (uint64_t) (grow.top + grow.bottom) * self->block_rows;
+    uint64_t cols = self->cols + (uint64_t) (grow.left + grow.right) * self->block_cols;
+    if (rows * cols > MAX_WORLD_CELLS) {
+        fprintf(stderr, "world::growToBounds: Error! Pattern is too large to hold in the world cells.\n");
+        return 0;
+    }
+
+    if (grow.top || grow.bottom || grow.left || grow.right) {
+        if (!worldIncreaseCells(self, grow.top, grow.bottom, grow.left, grow.right))
+            return 0;
+    }
+    return 1;
+}
+
+/// Hash of the live cells of the tiles, see World hash.
+static uint64_t hashTiles(struct TileMap *tiles) {
+    uint64_t col_powers[TILE_SIZE];
+    col_powers[0] = 1;
+    for (int c = 1; c < TILE_SIZE; ++c)
+        col_powers[c] = col_powers[c - 1] * HASH_P;
+
+    uint64_t hash = 0;
+    for (unsigned int i = 0; i < tiles->num_tiles; ++i) {
+        struct Tile *tile = tiles->tiles[i];
+        const struct TileSummary *summary = &tile->summary;
+        uint64_t tile_power = hashPower(HASH_P, (int64_t) tile->tx * TILE_SIZE);
+        uint64_t row_power = hashPower(HASH_Q, (int64_t) tile->ty * TILE_SIZE + summary->first_row);
+        for (int r = summary->first_row; r <= summary->last_row; ++r, row_power *= HASH_Q) {
+            uint64_t row_hash = 0;
+            for (uint64_t word = tile->rows[r]; word; word &= word - 1)
+                row_hash += col_powers[__builtin_ctzll(word)];
+            hash += tile_power * row_hash * row_power;
+        }
+    }
+    return hash;
+}
+
+/// Takes the population, live bounds and hash from the tiles or the
+/// quadtree, once the sparse or hashlife engine stepped them.
+static void countEngineCells(struct World *self) {
+    int64_t min_x = 0, min_y = 0, max_x = 0, max_y = 0;
+    if (self->current & CellsTiles) {
+        self->population = tileMapPopulation(self->tiles);
+        self->live_bounds_valid = tileMapBounds(self->tiles, &min_x, &min_y, &max_x, &max_y);
+        self->hash = hashTiles(self->tiles);
+    } else {
+        struct HashLife *hashlife = self->hashlife;
+        self->population = hashLifePopulation(hashlife);
+        self->live_bounds_valid = hashLifeBounds(hashlife, &min_x, &min_y, &max_x, &max_y);
+        self->hash = hashlife->root->hash * hashPower(HASH_P, hashlife->origin_x) *
+                     hashPower(HASH_Q, hashlife->origin_y);
+    }
+    self->live_min_x = (int) min_x;
+    self->live_min_y = (int) min_y;
+    self->live_max_x = (int) max_x;
+    self->live_max_y = (int) max_y;
+}
+
+/// Advances the world with the HashLife engine. The quadtree is the state
+/// of the world while the engine runs, so the results memoised for it are
+/// reused from call to call and the cells are only written for readers
+/// that need them, see worldSyncCells.
+static int advanceHashLife(struct World *self, uint64_t generations) {
+    if (!useEngineCells(self, NULL, 0))
+        return 0;
+
+    struct HashLife *hashlife = self->hashlife;
+    if (hashlife->num_nodes > MAX_HASHLIFE_NODES && !hashLifeCollect(hashlife))
+        return 0;
+    hashLifeSetRule(hashlife, &self->rule);
+    if (!hashLifeAdvance(hashlife, generations))
+        return 0;
+
+    countEngineCells(self);
+    self->generation += generations;
+    trackPeriod(self, generations);
+    return 1;
+}
+
+/// Advances the world with the sparse tile engine. The tiles are the state
+/// of the world while the engine runs: only the tiles holding live cells
+/// are stored and stepped, and the dense cells are only written for
+/// readers that need them, see worldSyncCells.
+static int advanceSparse(struct World *self, uint64_t generations) {
+    if (!useEngineCells(self, NULL, 0))
+        return 0;
+
+    struct TileMap *tiles = self->tiles;
+    tiles->rule = self->rule;
+    for (uint64_t i = 0; i < generations; ++i) {
+        if (!tileMapStep(tiles, self->pool))
+            return 0;
+    }
+
+    countEngineCells(self);
+    self->generation += generations;
+    trackPeriod(self, generations);
+    return 1;
+}
+
+/// Moves the live cells of the tiles by (dx, dy), into a new map.
+static int shiftTiles(struct World *self, int64_t dx, int64_t dy) {
+    struct TileMap *tiles = tileMapCreate();
+    if (!tiles)
+        return 0;
+    tiles->rule = self->tiles->rule;
+
+    for (unsigned int i = 0; i < self->tiles->num_tiles; ++i) {
+        struct Tile *tile = self->tiles->tiles[i];
+        for (int r = tile->summary.first_row; r <= tile->summary.last_row; ++r) {
+            int64_t y = (int64_t) tile->ty * TILE_SIZE + r + dy;
+            for (uint64_t word = tile->rows[r]; word; word &= word - 1) {
+                int64_t x = (int64_t) tile->tx * TILE_SIZE + __builtin_ctzll(word) + dx;
+                if (!tileMapSetCell(tiles, x, y, 1)) {
+                    tileMapDestroy(tiles);
+                    return 0;
+                }
             }
         }
     }
 
-    int prev_tl_cell_pos_x = self->tl_cell_pos_x;
-    int prev_tl_cell_pos_y = self->tl_cell_pos_y;
+    tileMapDestroy(self->tiles);
+    self->tiles = tiles;
+    return 1;
+}
 
-    // Increase the size of the domain if necessary
-    int increase_size = grow_left || grow_right || grow_top || grow_bottom;
-    if (increase_size) {
-        if (!worldIncreaseCells(self, grow_top, grow_bottom, grow_left, grow_right))
+/// Skips as many whole periods of a periodic world as fit in generations,
+/// by moving the cells by the displacement of each period. Returns 0 if the
+/// cells would move past the range of world coords.
+static int skipPeriods(struct World *self, uint64_t *generations) {
+    uint64_t cycles = *generations / self->period.period;
+    if (!cycles)
+        return 1;
+
+    int64_t dx = self->period.dx;
+    int64_t dy = self->period.dy;
+    int64_t limit = INT_MAX - (int64_t) (self->rows > self->cols ? self->rows : self->cols);
+    int64_t x = self->tl_cell_pos_x;
+    int64_t y = self->tl_cell_pos_y;
+    if ((dx && cycles > (uint64_t) ((limit - (x < 0 ? -x : x)) / (dx < 0 ? -dx : dx))) ||
+        (dy && cycles > (uint64_t) ((limit - (y < 0 ? -y : y)) / (dy < 0 ? -dy : dy)))) {
+        fprintf(stderr, "world::skipPeriods: Error! The pattern would move past the range of world coords.\n");
+        return 0;
+    }
+
+    if ((self->current & CellsTiles) && !shiftTiles(self, (int64_t) cycles * dx, (int64_t) cycles * dy))
+        return 0;
+    if (self->current & CellsHashLife) {
+        self->hashlife->origin_x += (int64_t) cycles * dx;
+        self->hashlife->origin_y += (int64_t) cycles * dy;
+    }
+    self->tl_cell_pos_x = (int) (x + (int64_t) cycles * dx);
+    self->tl_cell_pos_y = (int) (y + (int64_t) cycles * dy);
+    self->live_bounds_valid = 0;
+    self->hash *= hashPower(HASH_P, (int64_t) cycles * dx) * hashPower(HASH_Q, (int64_t) cycles * dy);
+    if (!updateHashPowers(self))
+        return 0;
+
+    self->generation += cycles * self->period.period;
+    *generations -= cycles * self->period.period;
+    return 1;
+}
+
+/// Advances the world with the HashLife or sparse engine. While detect_period
+/// looks for a repeat the engine advances one generation at a time, since
+/// the history only holds consecutive generations, and the rest of the
+/// generations advance in one call. With stop_on_period the world stops at
+/// the generation the period is found, otherwise a world with fast_forward
+/// set skips whole periods of the rest.
+static int advanceInfinite(struct World *self, uint64_t generations, int stop_on_period) {
+    int (*advance)(struct World *, uint64_t) = self->engine == EngineHashLife ? advanceHashLife : advanceSparse;
+    while (generations && self->detect_period && !self->period_found) {
+        if (!advance(self, 1))
+            return 0;
+        --generations;
+        if (stop_on_period && self->period_found)
+            return 1;
+    }
+
+    if (self->fast_forward && self->period_found && !skipPeriods(self, &generations))
+        return 0;
+    if (!generations)
+        return 1;
+    return advance(self, generations);
+}
+
+/// Gets the period of the world. Returns 0 if the world has not been seen
+/// to repeat, which needs detect_period to be set.
+int worldPeriod(struct World *self, struct WorldPeriod *period) {
+    if (!self->period_found)
+        return 0;
+
+    *period = self->period;
+    return 1;
+}
+
+/// Advances the world by a number of generations. The HashLife engine
+/// advances in powers of two and the sparse engine keeps its tiles for the
+/// whole run, the other engines update once per generation. detect_period
+/// needs every generation until a period is found. A periodic
+/// world with fast_forward set skips whole periods at once.
+int worldAdvance(struct World *self, uint64_t generations) {
+    if (self->updates_paused)
+        return 1;
+
+    int is_infinite_engine = self->engine == EngineHashLife || self->engine == EngineSparse;
+    if (is_infinite_engine && self->topology != TopologyUnbounded) {
+        fprintf(stderr, "world::worldAdvance: Error! The hashlife and sparse engines need an unbounded world.\n");
+        return 0;
+    }
+
+    if (self->fast_forward && self->period_found && !skipPeriods(self, &generations))
+        return 0;
+    if (!generations)
+        return 1;
+
+    if (is_infinite_engine)
+        return advanceInfinite(self, generations, 0);
+
+    for (uint64_t i = 0; i < generations; ++i) {
+        if (!worldUpdate(self))
             return 0;
     }
+    return 1;
+}
 
-    // Copy the next cells to the current cells
-    int col_offset = prev_tl_cell_pos_x - self->tl_cell_pos_x;
-    int row_offset = prev_tl_cell_pos_y - self->tl_cell_pos_y;
+/// Advances the world by n generations, ignoring updates_paused. The
+/// generations run in batches: the world grows once per batch to hold the
+/// live cells plus a margin of one cell per generation, since no live cell
+/// moves faster than that, and is compacted between batches. The bit packed
+/// engine advances each batch of tile_generations generations in one pass
+/// over the world, unless the world is a torus or detect_period needs every
+/// generation. With detect_period set the world stops at the generation a
+/// period is found, unless fast_forward is set too. generation holds the
+/// final generation.
+int worldStep(struct World *self, uint64_t n) {
+    if (self->fast_forward && self->period_found && !skipPeriods(self, &n))
+        return 0;
 
-    for (int r = 0; r < self->cn_rows; ++r) {
-        for (int c = 0; c < self->cn_cols; ++c) {
-            unsigned char *cell = worldCell(self, c + col_offset, r + row_offset);
-            unsigned char *cell_next = worldCellNext(self, c, r);
-            *cell = *cell_next;
-            *cell_next = 0;
+    if (self->engine == EngineHashLife || self->engine == EngineSparse) {
+        if (self->topology != TopologyUnbounded) {
+            fprintf(stderr, "world::worldStep: Error! The hashlife and sparse engines need an unbounded world.\n");
+            return 0;
         }
+        if (!n)
+            return 1;
+        return advanceInfinite(self, n, self->detect_period && !self->fast_forward);
     }
 
+    int stop_on_period = self->detect_period && !self->fast_forward;
+    unsigned int tile_generations = self->tile_generations < MAX_TILE_GENERATIONS ?
+                                    self->tile_generations : MAX_TILE_GENERATIONS;
+    int tiled = self->engine == EngineBitPacked && tile_generations > 1 &&
+                self->topology != TopologyTorus && !self->detect_period;
+    int64_t max_batch = tiled ? tile_generations : STEP_BATCH_GENERATIONS;
+
+    while (n > 0) {
+        // Nothing is ever born next to no live cells
+        if (!self->population) {
+            self->generation += n;
+            break;
+        }
+
+        uint64_t batch_generation = self->generation;
+        int64_t batch = n < (uint64_t) max_batch ? (int64_t) n : max_batch;
+        int min_x, min_y, max_x, max_y;
+        if (self->topology == TopologyUnbounded && worldLiveBounds(self, &min_x, &min_y, &max_x, &max_y) &&
+            !growToBounds(self, min_x - batch, min_y - batch, max_x + batch, max_y + batch))
+            return 0;
+
+        if (tiled) {
+            if (!stepGenerationsTiled(self, (unsigned int) batch) || !compactOnInterval(self, batch_generation))
+                return 0;
+            n -= (uint64_t) batch;
+            continue;
+        }
 
-    if (increase_size) {
-        if (!worldIncreaseCellsNext(self))
+        for (int64_t i = 0; i < batch; ++i) {
+            if (!stepGeneration(self, 0))
+                return 0;
+            trackPeriod(self, 1);
+            if (stop_on_period && self->period_found)
+                return compactOnInterval(self, batch_generation);
+        }
+        if (!compactOnInterval(self, batch_generation))
             return 0;
+        n -= (uint64_t) batch;
+    }
+
+    return 1;
+}
+
+/// Toggles the cell at world coords (x, y) in each of the current cells.
+/// The cell must lie within the dense or packed cells while they are
+/// current.
+static int toggleCell(struct World *self, int x, int y) {
+    int c = x - self->tl_cell_pos_x;
+    int r = y - self->tl_cell_pos_y;
+    int delta = worldCellAlive(self, x, y) ? -1 : 1;
+    if (self->current & CellsDense)
+        self->cells[(size_t) self->stride * r + c] = delta > 0;
+    if (self->current & CellsPacked)
+        self->packed[(size_t) r * self->packed_words + c / 64] ^= (uint64_t) 1 << (c % 64);
+    if ((self->current & CellsTiles) && !tileMapSetCell(self->tiles, x, y, delta > 0))
+        return 0;
+    if ((self->current & CellsHashLife) && !hashLifeSetCell(self->hashlife, x, y, delta > 0))
+        return 0;
+
+    if (self->current & (CellsDense | CellsPacked)) {
+        markBlockChanged(self, c, r);
+        self->block_population[(r / self->block_rows) * self->block_grid_cols + c / self->block_cols] += delta;
+        self->hash += (uint64_t) (int64_t) delta * self->hash_x[c] * self->hash_y[r];
+    } else {
+        self->hash += (uint64_t) (int64_t) delta * hashPower(HASH_P, x) * hashPower(HASH_Q, y);
     }
+    self->population += delta;
+    resetPeriod(self);
 
+    // A new cell widens the bounds, a dead one may only narrow them if it
+    // was on their edge
+    if (delta > 0 && self->population == 1) {
+        self->live_min_x = self->live_max_x = x;
+        self->live_min_y = self->live_max_y = y;
+        self->live_bounds_valid = 1;
+    } else if (delta > 0 && self->live_bounds_valid) {
+        self->live_min_x = x < self->live_min_x ? x : self->live_min_x;
+        self->live_max_x = x > self->live_max_x ? x : self->live_max_x;
+        self->live_min_y = y < self->live_min_y ? y : self->live_min_y;
+        self->live_max_y = y > self->live_max_y ? y : self->live_max_y;
+    } else if (delta < 0 && (x == self->live_min_x || x == self->live_max_x ||
+                             y == self->live_min_y || y == self->live_max_y)) {
+        self->live_bounds_valid = 0;
+    }
     return 1;
 }
 
+/// Toggles the cell at (c, r) of the cells, at world coords
+/// (tl_cell_pos_x + c, tl_cell_pos_y + r), in each of the current cells.
 void worldToggleCell(struct World *self, int c, int r) {
     
-    unsigned char *cell = worldCell(self, c, r);
-    if (!cell)
+    if ((self->current & (CellsDense | CellsPacked)) && !isWithinDomain(self, c, r)) {
+        fprintf(stderr, "world::worldToggleCell: Error! Tried to toggle a cell that does not exist.\n");
+        fprintf(stderr, "    (c = %d, r = %d), (total cols = %d, total rows = %d)\n", c, r, self->cols, self->rows);
         return;
+    }
+
+    toggleCell(self, self->tl_cell_pos_x + c, self->tl_cell_pos_y + r);
+}
 
-    if (*cell)
-        *cell = 0;
-    else
-        *cell = 1;
+/// Kills every cell and restarts the generation count. The size, topology,
+/// rule and buffers of the world are kept, so a world can be reused for
+/// many patterns without allocating.
+void worldClear(struct World *self) {
+    for (unsigned int r = 0; (self->current & CellsDense) && r < self->rows; ++r)
+        memset(&self->cells[(size_t) r * self->stride], 0, self->cols);
+    if (self->current & CellsPacked)
+        memset(self->packed, 0, sizeof(uint64_t) * self->packed_words * self->packed_rows);
+    if (self->current & CellsTiles)
+        tileMapClear(self->tiles);
+    if (self->current & CellsHashLife)
+        hashLifeClear(self->hashlife);
 
-    return;
+    memset(self->block_population, 0, sizeof(uint32_t) * self->block_grid_rows * self->block_grid_cols);
+    markAllBlocksChanged(self);
+    self->population = 0;
+    self->hash = 0;
+    self->live_bounds_valid = 0;
+    self->generation = 0;
+    resetPeriod(self);
+}
+
+/// Toggles the cell at world coords (x, y), growing the cells to hold it.
+/// On a torus the coords wrap, a bounded world ignores cells outside it.
+int worldToggleCellAt(struct World *self, int x, int y) {
+    if (self->topology == TopologyTorus) {
+        x = self->tl_cell_pos_x + ((x - self->tl_cell_pos_x) % (int) self->cols + (int) self->cols) % (int) self->cols;
+        y = self->tl_cell_pos_y + ((y - self->tl_cell_pos_y) % (int) self->rows + (int) self->rows) % (int) self->rows;
+    } else if (self->topology == TopologyBounded) {
+        if (!isWithinDomain(self, x - self->tl_cell_pos_x, y - self->tl_cell_pos_y))
+            return 0;
+    } else if (!growToBounds(self, x, y, x, y)) {
+        return 0;
+    }
+
+    return toggleCell(self, x, y);
+}
+
+/// Sets the cell at world coords (x, y) alive or dead, growing the cells
+/// to hold a live one. On a torus the coords wrap, a bounded world ignores
+/// cells outside it.
+int worldSetCellAt(struct World *self, int x, int y, int alive) {
+    if (self->topology == TopologyTorus) {
+        x = self->tl_cell_pos_x + ((x - self->tl_cell_pos_x) % (int) self->cols + (int) self->cols) % (int) self->cols;
+        y = self->tl_cell_pos_y + ((y - self->tl_cell_pos_y) % (int) self->rows + (int) self->rows) % (int) self->rows;
+    } else if (self->topology == TopologyBounded &&
+               !isWithinDomain(self, x - self->tl_cell_pos_x, y - self->tl_cell_pos_y)) {
+        return 1;
+    }
+
+    if (worldCellAlive(self, x, y) == (alive != 0))
+        return 1;
+    return worldToggleCellAt(self, x, y);
+}
+
+/// Kills the cols x rows cells with the top left cell at world coords
+/// (x, y). On a torus the region wraps, but covers each cell at most once.
+int worldClearRegion(struct World *self, int x, int y, unsigned int cols, unsigned int rows) {
+    if (self->topology == TopologyTorus) {
+        cols = cols < self->cols ? cols : self->cols;
+        rows = rows < self->rows ? rows : self->rows;
+        for (unsigned int r = 0; r < rows; ++r) {
+            for (unsigned int c = 0; c < cols; ++c)
+                worldSetCellAt(self, x + (int) c, y + (int) r, 0);
+        }
+        return 1;
+    }
+
+    // Cells past the live bounds are already dead
+    int min_x, min_y, max_x, max_y;
+    if (!worldLiveBounds(self, &min_x, &min_y, &max_x, &max_y))
+        return 1;
+    int64_t x0 = x > min_x ? x : min_x;
+    int64_t y0 = y > min_y ? y : min_y;
+    int64_t x1 = (int64_t) x + cols - 1 < max_x ? (int64_t) x + cols - 1 : max_x;
+    int64_t y1 = (int64_t) y + rows - 1 < max_y ? (int64_t) y + rows - 1 : max_y;
+    for (int64_t r = y0; r <= y1; ++r) {
+        for (int64_t c = x0; c <= x1; ++c) {
+            if (worldCellAlive(self, (int) c, (int) r))
+                worldToggleCell(self, (int) c - self->tl_cell_pos_x, (int) r - self->tl_cell_pos_y);
+        }
+    }
+    return 1;
+}
+
+/// Copies a pattern of cols x rows cells, one byte per cell and nonzero if
+/// alive, over the cells with the top left cell at world coords (x, y).
+/// Dead cells of the pattern kill the cells under them.
+int worldStampAt(struct World *self, int x, int y, unsigned int cols, unsigned int rows,
+                 const unsigned char *cells) {
+    if (cols == 0 || rows == 0)
+        return 1;
+
+    // Grown once for the whole pattern rather than cell by cell
+    if (self->topology == TopologyUnbounded &&
+        !growToBounds(self, x, y, (int64_t) x + cols - 1, (int64_t) y + rows - 1))
+        return 0;
+
+    for (unsigned int r = 0; r < rows; ++r) {
+        for (unsigned int c = 0; c < cols; ++c) {
+            if (!worldSetCellAt(self, x + (int) c, y + (int) r, cells[(size_t) r * cols + c]))
+                return 0;
+        }
+    }
+    return 1;
+}
+
+/// True if the cell at world coords (x, y) is alive. Cells outside the
+/// world are dead.
+int worldCellAlive(struct World *self, int x, int y) {
+    int c = x - self->tl_cell_pos_x;
+    int r = y - self->tl_cell_pos_y;
+    if (!(self->current & (CellsDense | CellsPacked)))
+        return self->current & CellsTiles ? tileMapCell(self->tiles, x, y) : hashLifeCell(self->hashlife, x, y);
+    if (!isWithinDomain(self, c, r))
+        return 0;
+    if (self->current & CellsDense)
+        return self->cells[(size_t) self->stride * r + c] != 0;
+    return (self->packed[(size_t) r * self->packed_words + c / 64] >> (c % 64)) & 1;
+}
+
+/// Copies the rows x cols cells with the top left cell at world coords
+/// (x, y) into cells, one byte per cell and stride bytes per row, from
+/// whichever cells are current. Cells outside the world are dead.
+void worldGetCells(struct World *self, unsigned char *cells, unsigned int rows, unsigned int cols,
+                   unsigned int stride, int x, int y) {
+    if (!(self->current & (CellsDense | CellsPacked))) {
+        if (self->current & CellsTiles)
+            tileMapGetCells(self->tiles, cells, rows, cols, stride, x, y);
+        else
+            hashLifeGetCells(self->hashlife, cells, rows, cols, stride, x, y);
+        return;
+    }
+
+    int64_t first_col = (int64_t) x - self->tl_cell_pos_x;
+    int64_t c_begin = first_col > 0 ? first_col : 0;
+    int64_t c_end = first_col + cols < self->cols ? first_col + cols : self->cols;
+    for (unsigned int i = 0; i < rows; ++i) {
+        unsigned char *out = &cells[(size_t) i * stride];
+        memset(out, 0, cols);
+        int64_t r = (int64_t) y + i - self->tl_cell_pos_y;
+        if (r < 0 || r >= self->rows || c_begin >= c_end)
+            continue;
 
+        out += c_begin - first_col;
+        if (self->current & CellsDense) {
+            memcpy(out, &self->cells[(size_t) r * self->stride + c_begin], c_end - c_begin);
+            continue;
+        }
+        const uint64_t *packed_row = &self->packed[(size_t) r * self->packed_words];
+        for (int64_t c = c_begin; c < c_end; ++c)
+            out[c - c_begin] = (packed_row[c / 64] >> (c % 64)) & 1;
+    }
 }
 
+/// Pointer to the dense cell at (c, r), which needs the dense cells to be
+/// current, see worldSyncCells.
 unsigned char *worldCell(struct World *self, int c, int r) {
     if (!isWithinDomain(self, c, r)) {
         fprintf(stderr, "world::worldCell: Error! Tried to access a cell that does not exist.\n");
         fprintf(stderr, "    (c = %d, r = %d), (total cols = %d, total rows = %d)\n", c, r, self->cols, self->rows);
         return NULL;
     }
+    if (!self->cells) {
+        fprintf(stderr, "world::worldCell: Error! The dense cells are not current.\n");
+        return NULL;
+    }
 
-    int i = ((int) self->cols) * r + c;
+    size_t i = (size_t) self->stride * r + c;
     return &self->cells[i];
 }
 
 unsigned char *worldCellNext(struct World *self, int c, int r) {
-    if (!isWithinDomain(self, c, r)) {
+    if (!isWithinDomain(self, c, r) || !self->cells_next) {
         fprintf(stderr, "world::worldCellNext: Error! Tried to access a cell that does not exist.\n");
         return NULL;
     }
 
-    int i = ((int) self->cn_cols) * r + c;
+    size_t i = (size_t) self->stride * r + c;
     return &self->cells_next[i];
 }
 
@@ -220,8 +2337,30 @@ int worldLoadFromFile(struct World *self, const char *file_name) {
         return 0;
     }
 
+    // Header lines start with #. "#rule B36/S23" sets the rule, files
+    // without one keep the current rule.
+    unsigned int header_bytes = 0;
+    while (header_bytes < bytes && contents[header_bytes] == '#') {
+        unsigned int line_end = header_bytes;
+        while (line_end < bytes && contents[line_end] != '\n')
+            ++line_end;
+
+        if (line_end < bytes)
+            contents[line_end] = '\0';
+        if (strncmp(&contents[header_bytes], "#rule ", 6) == 0 &&
+            !worldSetRule(self, &contents[header_bytes + 6])) {
+            fprintf(stderr, "world::worldLoadFromFile: Error! Invalid rule in %s\n", file_name);
+            return 0;
+        }
+        header_bytes = line_end + 1;
+    }
+    if (header_bytes >= bytes) {
+        fprintf(stderr, "world::worldLoadFromFile: Error! No cells in %s\n", file_name);
+        return 0;
+    }
+
     // Determine the size of the world in the file.
-    unsigned int cell_index = 0;
+    unsigned int cell_index = header_bytes;
     int is_first_row = 1;
     int num_rows = 1; // The last row may not have a new line character
     int num_cols = 0;
@@ -239,6 +2378,11 @@ int worldLoadFromFile(struct World *self, const char *file_name) {
             ++num_cols;
     }
 
+    // The file is read into the dense cells
+    if (!worldSyncCells(self))
+        return 0;
+    releaseCells(self, CellsDense);
+
     // Increase the size of the world if necessary. Deliberate truncate.
     int grow_right = ceil((num_cols - (float) self->cols) / (float) self->block_cols);
     int grow_bottom = ceil((num_rows - (float) self->rows) / (float) self->block_rows);
@@ -250,17 +2394,18 @@ int worldLoadFromFile(struct World *self, const char *file_name) {
 
         if (!worldIncreaseCells(self, 0, grow_bottom, 0, grow_right))
             return 0;
-
-        if (!worldIncreaseCellsNext(self))
-            return 0;
     }
 
+    // The file replaces the current state of the world
+    for (unsigned int r = 0; r < self->rows; ++r)
+        memset(&self->cells[(size_t) r * self->stride], 0, self->cols);
+
     // Copy the state of the world into memory.
     int cols_per_row = 0;
     int r = 0;
     int c = 0;
     is_first_row = 1;
-    cell_index = 0;
+    cell_index = header_bytes;
     while (cell_index != bytes -1) {
         char cell_char = contents[cell_index];
         ++cell_index;
@@ -301,13 +2446,29 @@ int worldLoadFromFile(struct World *self, const char *file_name) {
         ++c;
     }
 
+    markAllBlocksChanged(self);
+    recountCells(self);
+    resetPeriod(self);
+    self->generation = 0;
     return 1;
 }
 
 int worldSaveToFile(struct World *self, const char *file_name) {
 
-    // +1 for the new line characters at the end of each row
-    unsigned int size_in_bytes = (self->rows + 1) * self->cols;
+    // Conway's rule is left implicit, so the files still load in older builds
+    char header[LIFE_RULE_MAX_CHARS + 8] = "";
+    if (!self->rule.is_conway) {
+        char rule[LIFE_RULE_MAX_CHARS];
+        lifeRuleToString(&self->rule, rule);
+        snprintf(header, sizeof(header), "#rule %s\n", rule);
+    }
+    unsigned int header_bytes = strlen(header);
+    if (!worldSyncCells(self))
+        return 0;
+
+    // +1 for the new line characters at the end of each row, and +1 for the
+    // null terminator
+    unsigned int size_in_bytes = header_bytes + (self->cols + 1) * self->rows + 1;
     if (size_in_bytes > 10e6) {
         fprintf(stderr, "world::worldSaveToFile: World size exceeds file limit.");
         return 0;
@@ -319,7 +2480,8 @@ int worldSaveToFile(struct World *self, const char *file_name) {
         return 0;
     }
 
-    int fc_inx = 0;
+    memcpy(file_contents, header, header_bytes);
+    int fc_inx = header_bytes;
     for (int r = 0; r < self->rows; ++r) {
         for (int c = 0; c < self->cols; ++c) {
             unsigned char *cell = worldCell(self, c, r);
@@ -347,6 +2509,8 @@ int worldSaveToFile(struct World *self, const char *file_name) {
 }
 
 void worldPrint(struct World *self) {
+    if (!worldSyncCells(self))
+        return;
     for (int r = 0; r < self->rows; ++r) {
         for (int c = 0; c < self->cols; ++c) {
             unsigned char *cell = worldCell(self, c, r);
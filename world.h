@@ -2,18 +2,90 @@
 #define __GAME_OF_LIFE_WORLD_H__
 
 #include "time_control.h"
+#include "thread_pool.h"
+#include "hashlife.h"
+#include "tile_map.h"
+#include "life_rule.h"
+#include "numa.h"
+
+#include <stdint.h>
+
+/// Kernel used by worldUpdate to compute the next generation.
+enum WorldEngine {
+    EngineDense = 0,    // One byte per cell, neighbours counted cell by cell.
+    EngineBitPacked,    // 64 cells per word, neighbours counted with bitwise adders.
+    EngineHashLife,     // Memoised quadtree, see hashlife.h.
+    EngineSparse,       // Hash map of 64x64 tiles with live cells, see tile_map.h.
+    EngineLookupTable   // One byte per cell, 2x2 cells at a time from a table of 4x4 cells.
+};
+
+/// Shape of the world the cells live in.
+enum WorldTopology {
+    TopologyUnbounded = 0,  // The cells grow by blocks as live cells reach an edge.
+    TopologyTorus,          // Fixed size, cells on opposite edges are neighbours.
+    TopologyBounded         // Fixed size, surrounded by dead cells.
+};
+
+/// Generations after which the live cells repeat, moved by (dx, dy).
+struct WorldPeriod {
+    uint64_t period;
+    int dx;
+    int dy;
+
+    // First generation of the cycle found
+    uint64_t since;
+};
+
+/// Live cells of one past generation, compared by hash.
+struct WorldHistoryEntry {
+    uint64_t hash;
+    uint64_t population;
+    uint64_t generation;
+    int min_x;
+    int min_y;
+    int max_x;
+    int max_y;
+};
+
+#define WORLD_HISTORY_LEN 64
+
+/// Representations of the cells of a world, see World current.
+enum WorldCells {
+    CellsDense = 1 << 0,    // cells, one byte per cell.
+    CellsPacked = 1 << 1,   // packed, 64 cells per word.
+    CellsTiles = 1 << 2,    // tiles, 64x64 cells per tile with live cells.
+    CellsHashLife = 1 << 3  // hashlife, the root of a quadtree.
+};
 
 /// Stores the game state.
 struct World {
 
+    // Rule every engine updates the cells with, B3/S23 unless set
+    struct LifeRule rule;
+
+    // A torus or bounded world keeps its size, see worldSetTopology
+    enum WorldTopology topology;
+
     unsigned char *cells;
     unsigned int rows;
     unsigned int cols;
 
-    // State of cells on the next time step.
+    // State of cells on the next time step. Has the same layout as cells,
+    // the two are swapped at the end of each update.
     unsigned char *cells_next;
-    unsigned int cn_rows;
-    unsigned int cn_cols;
+
+    // cells and cells_next point into buffers of capacity_rows rows of
+    // stride bytes. The rows x cols cells start at (origin_row, origin_col)
+    // and the margins around them are always dead, so the cells can grow
+    // into the margins by moving the origin. The margins are at least one
+    // cell wide, so neighbours can be read without checking the edges. On a
+    // torus the one cell ring around the cells holds the wrapped cells.
+    unsigned char *cells_buffer;
+    unsigned char *cells_next_buffer;
+    unsigned int stride;
+    unsigned int capacity_rows;
+    unsigned int origin_row;
+    unsigned int origin_col;
 
     // Position of the top left cell in world coords
     int tl_cell_pos_x;
@@ -23,6 +95,101 @@ struct World {
     unsigned int block_rows;
     unsigned int block_cols;
 
+    // Blocks whose cells changed in the last generation. A block with no
+    // changed neighbours cannot change, so the dense engine skips it.
+    unsigned char *block_changed;
+    unsigned char *block_changed_next;
+    unsigned int block_grid_rows;
+    unsigned int block_grid_cols;
+
+    // Cells of EngineBitPacked, which steps them in place of cells. Each
+    // row is packed_words words long, bit i of word w is the cell at col
+    // 64*w + i.
+    enum WorldEngine engine;
+    uint64_t *packed;
+    uint64_t *packed_next;
+    unsigned int packed_words;
+    unsigned int packed_rows;
+
+    // worldStep advances the bit packed engine tile_generations generations
+    // per pass over the world, one cache sized tile at a time. 0 or 1 steps
+    // the whole world once per generation.
+    unsigned int tile_generations;
+
+    // Next state of the middle 2x2 cells of every 4x4 cells, used by
+    // EngineLookupTable and built for lookup_rule when first needed.
+    unsigned char *lookup_table;
+    struct LifeRule lookup_rule;
+
+    // Quadtree of EngineHashLife, which steps it in place of cells. Kept
+    // between updates so the memoised results of earlier generations are
+    // reused. Like the tiles, only population, hash and the live bounds are
+    // kept while only the quadtree is current.
+    struct HashLife *hashlife;
+
+    // Tiles of EngineSparse, which steps them in place of cells. rows,
+    // cols and the block counts are left as they were while only the tiles
+    // are current, and only population, hash and the live bounds are kept.
+    struct TileMap *tiles;
+
+    // Representations holding the current cells, a mask of WorldCells.
+    // Each engine steps its own and the others are only brought up to date
+    // for readers that need them, see worldSyncCells. The dense cells are
+    // freed while they are not current, and cells is NULL.
+    unsigned int current;
+
+    // Number of generations since the world was created or loaded
+    uint64_t generation;
+
+    // Live cells per block, their total and a hash of the live cells, kept
+    // up to date as cells change. The hash is the sum of P^x * Q^y over the
+    // live cells at world coords (x, y), so moving the cells by (dx, dy)
+    // multiplies it by P^dx * Q^dy. hash_x and hash_y hold P^x of each col
+    // and Q^y of each row.
+    uint32_t *block_population;
+    uint64_t population;
+    uint64_t hash;
+    uint64_t *hash_x;
+    uint64_t *hash_y;
+
+    // Bounds of the live cells in world coords, found by the bands of each
+    // generation. Other edits clear live_bounds_valid and the bounds are
+    // found again when next needed, see worldLiveBounds.
+    int live_bounds_valid;
+    int live_min_x;
+    int live_min_y;
+    int live_max_x;
+    int live_max_y;
+
+    // With detect_period set, the hash of each generation relative to its
+    // live bounds is kept in a ring of the last WORLD_HISTORY_LEN
+    // generations. A repeat sets period, see worldPeriod. With fast_forward
+    // also set, worldAdvance skips whole periods by moving the cells.
+    int detect_period;
+    int fast_forward;
+    int period_found;
+    struct WorldPeriod period;
+    struct WorldHistoryEntry history[WORLD_HISTORY_LEN];
+    unsigned int history_len;
+    unsigned int history_next;
+
+    // Dead blocks are trimmed off the edges every compact_interval
+    // generations, see worldCompact. Zero never trims.
+    unsigned int compact_interval;
+
+    // Rows are split into bands that are updated in parallel on the pool.
+    // A single thread, the default, updates the world serially.
+    struct ThreadPool *pool;
+    unsigned int num_threads;
+
+    // Placement of the bands on NUMA nodes, see worldSetPlacement
+    int first_touch;
+    int pin_threads;
+
+    // Generations kept by the window to rewind to, see rewind.h. Zero keeps
+    // none.
+    unsigned int rewind_generations;
+
     struct TimeControl update_rate;
     int updates_paused;
     int edit_mode;
@@ -30,14 +197,35 @@ struct World {
 
 struct World *worldCreate();
 void worldDestroy(struct World *self);
+int worldSetThreads(struct World *self, unsigned int num_threads);
+int worldSetPlacement(struct World *self, int first_touch, int pin_threads);
+int worldCountPages(struct World *self, struct NumaPages *pages);
+int worldSetRule(struct World *self, const char *rule);
+int worldSetTopology(struct World *self, enum WorldTopology topology, unsigned int cols, unsigned int rows);
 int worldUpdate(struct World *self);
+int worldAdvance(struct World *self, uint64_t generations);
+int worldStep(struct World *self, uint64_t n);
+int worldPeriod(struct World *self, struct WorldPeriod *period);
+uint64_t worldPopulation(struct World *self);
+int worldLiveBounds(struct World *self, int *min_x, int *min_y, int *max_x, int *max_y);
+uint64_t worldHashAtOrigin(struct World *self);
 void worldToggleCell(struct World *self, int c, int r);
+void worldClear(struct World *self);
+int worldToggleCellAt(struct World *self, int x, int y);
+int worldSetCellAt(struct World *self, int x, int y, int alive);
+int worldClearRegion(struct World *self, int x, int y, unsigned int cols, unsigned int rows);
+int worldStampAt(struct World *self, int x, int y, unsigned int cols, unsigned int rows,
+                 const unsigned char *cells);
+int worldCellAlive(struct World *self, int x, int y);
+void worldGetCells(struct World *self, unsigned char *cells, unsigned int rows, unsigned int cols,
+                   unsigned int stride, int x, int y);
+int worldSyncCells(struct World *self);
 unsigned char *worldCell(struct World *self, int c, int r);
 unsigned char *worldCellNext(struct World *self, int c, int r);
 int worldLoadFromFile(struct World *self, const char *file_name);
 int worldSaveToFile(struct World *self, const char *file_name);
 void worldPrint(struct World *self);
 int worldIncreaseCells(struct World *self, int grow_top, int grow_bottom, int grow_left, int grow_right);
-int worldIncreaseCellsNext(struct World *self);
+int worldCompact(struct World *self);
 
 #endif // __GAME_OF_LIFE_WORLD_H__